@@ -0,0 +1,423 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "imagefoldermodel.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QMimeDatabase>
+
+#include <algorithm>
+
+/*
+Lists the images in a folder. The folder is scanned on a thread of its
+own, and the files are added in batches as they are found, so that a
+folder with tens of thousands of photos neither blocks the user interface
+nor waits until the whole folder has been read. Each batch is merged in
+by file name, so the rows are sorted whatever order the directory lists
+them in. The size of each image is read from its header while scanning,
+so that it can be laid out before any of it is decoded. The folder is
+watched, and rescanned when it changes.
+*/
+
+// Flush found files at least this often, in entries and milliseconds
+static const int MaximumBatchSize = 256;
+static const int MaximumBatchInterval = 50;
+// Changes tend to come in bursts, as when copying many files
+static const int RescanDelay = 250;
+
+// Ignores case, but still orders names that only differ in case
+static bool fileNameLessThan(const QString &a, const QString &b)
+{
+    const int result = a.compare(b, Qt::CaseInsensitive);
+    return result != 0 ? result < 0 : a < b;
+}
+
+/*
+Lives on the model's scanner thread. Keeps the image sizes it has read,
+so that rescans only read the headers of files that changed.
+*/
+class ImageFolderScanner : public QObject
+{
+public:
+    ImageFolderScanner(ImageFolderModel *model) : m_model(model)
+    {
+    }
+
+    void scan(int generation, const QString &path, const QStringList &nameFilters)
+    {
+        QList<ImageFolderEntry> batch;
+        QElapsedTimer sinceFlush;
+        sinceFlush.start();
+        QDirIterator it(path, nameFilters, QDir::Files | QDir::Readable);
+        while (it.hasNext()) {
+            // Superseded by another scan, or the model is going away
+            if (m_model->m_generation.loadRelaxed() != generation)
+                return;
+            it.next();
+            batch.append(entry(it.fileInfo()));
+            if (batch.size() >= MaximumBatchSize || sinceFlush.elapsed() >= MaximumBatchInterval) {
+                flush(generation, &batch);
+                sinceFlush.restart();
+            }
+        }
+        flush(generation, &batch);
+
+        const bool exists = QDir(path).exists();
+        ImageFolderModel *model = m_model;
+        QMetaObject::invokeMethod(model, [model, generation, exists]() {
+            model->scanFinished(generation, exists);
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    struct CachedSize
+    {
+        QDateTime lastModified;
+        qint64 fileSize;
+        QSize imageSize;
+    };
+
+    ImageFolderEntry entry(const QFileInfo &info)
+    {
+        ImageFolderEntry entry;
+        entry.fileName = info.fileName();
+        entry.lastModified = info.lastModified();
+        entry.fileSize = info.size();
+
+        const QString filePath = info.absoluteFilePath();
+        const auto cached = m_sizes.constFind(filePath);
+        if (cached != m_sizes.constEnd() && cached->lastModified == entry.lastModified
+                && cached->fileSize == entry.fileSize) {
+            entry.imageSize = cached->imageSize;
+            return entry;
+        }
+
+        QImageReader reader(filePath);
+        entry.imageSize = reader.size();
+        if (reader.transformation() & QImageIOHandler::TransformationRotate90)
+            entry.imageSize.transpose();
+        m_sizes.insert(filePath, { entry.lastModified, entry.fileSize, entry.imageSize });
+        return entry;
+    }
+
+    void flush(int generation, QList<ImageFolderEntry> *batch)
+    {
+        if (batch->isEmpty())
+            return;
+        ImageFolderModel *model = m_model;
+        QMetaObject::invokeMethod(model, [model, generation, entries = *batch]() {
+            model->entriesFound(generation, entries);
+        }, Qt::QueuedConnection);
+        batch->clear();
+    }
+
+    ImageFolderModel *m_model;
+    QHash<QString, CachedSize> m_sizes;
+};
+
+ImageFolderModel::ImageFolderModel(QObject *parent) : QAbstractListModel(parent)
+    , m_nameFilters(imageNameFilters()), m_status(Null), m_isComponentComplete(true)
+    , m_scanner(new ImageFolderScanner(this))
+{
+    m_scanner->moveToThread(&m_scannerThread);
+    connect(&m_scannerThread, &QThread::finished, m_scanner, &QObject::deleteLater);
+    m_scannerThread.setObjectName(QStringLiteral("ImageFolderModel scanner"));
+    m_scannerThread.start();
+
+    m_rescanTimer.setSingleShot(true);
+    m_rescanTimer.setInterval(RescanDelay);
+    connect(&m_rescanTimer, &QTimer::timeout, this, [this]() { scan(false); });
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, &m_rescanTimer, qOverload<>(&QTimer::start));
+}
+
+ImageFolderModel::~ImageFolderModel()
+{
+    // Stops a scan in progress
+    m_generation.fetchAndAddRelaxed(1);
+    m_scannerThread.quit();
+    m_scannerThread.wait();
+}
+
+QUrl ImageFolderModel::folder() const
+{
+    return m_folder;
+}
+
+void ImageFolderModel::setFolder(const QUrl &folder)
+{
+    if (m_folder == folder)
+        return;
+    m_folder = folder;
+    emit folderChanged();
+    if (m_isComponentComplete)
+        scan(true);
+}
+
+QStringList ImageFolderModel::nameFilters() const
+{
+    return m_nameFilters;
+}
+
+void ImageFolderModel::setNameFilters(const QStringList &nameFilters)
+{
+    if (m_nameFilters == nameFilters)
+        return;
+    m_nameFilters = nameFilters;
+    emit nameFiltersChanged();
+    if (m_isComponentComplete)
+        scan(true);
+}
+
+ImageFolderModel::Status ImageFolderModel::status() const
+{
+    return m_status;
+}
+
+int ImageFolderModel::count() const
+{
+    return m_entries.size();
+}
+
+int ImageFolderModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant ImageFolderModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size())
+        return QVariant();
+
+    const ImageFolderEntry &entry = m_entries.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case FileNameRole:
+        return entry.fileName;
+    case FileUrlRole:
+        return QUrl::fromLocalFile(QDir(m_folder.toLocalFile()).filePath(entry.fileName));
+    case FileModifiedRole:
+        return entry.lastModified;
+    case ImageSizeRole:
+        return entry.imageSize;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> ImageFolderModel::roleNames() const
+{
+    return {
+        { FileNameRole, "fileName" },
+        { FileUrlRole, "fileUrl" },
+        { FileModifiedRole, "fileModified" },
+        { ImageSizeRole, "imageSize" }
+    };
+}
+
+void ImageFolderModel::classBegin()
+{
+    m_isComponentComplete = false;
+}
+
+void ImageFolderModel::componentComplete()
+{
+    m_isComponentComplete = true;
+    scan(true);
+}
+
+/*
+Returns name filters for all the image formats that can be read.
+*/
+QStringList ImageFolderModel::imageNameFilters()
+{
+    QStringList result;
+    QMimeDatabase mimeDatabase;
+    const auto supportedMimeTypes = QImageReader::supportedMimeTypes();
+    for (const QByteArray &m : supportedMimeTypes) {
+        const auto suffixes = mimeDatabase.mimeTypeForName(m).suffixes();
+        for (const QString &suffix : suffixes)
+            result.append(QLatin1String("*.") + suffix);
+    }
+    return result;
+}
+
+/*
+Starts scanning the folder, abandoning any scan in progress. A reset scan
+clears the model first; a rescan keeps the files listed and reports what
+changed once it has seen the whole folder.
+*/
+void ImageFolderModel::scan(bool reset)
+{
+    const int generation = m_generation.fetchAndAddRelaxed(1) + 1;
+    m_rescanTimer.stop();
+    m_seen.clear();
+
+    const QString path = m_folder.toLocalFile();
+    if (reset) {
+        const bool wasEmpty = m_entries.isEmpty();
+        beginResetModel();
+        m_entries.clear();
+        endResetModel();
+        if (!wasEmpty)
+            emit countChanged();
+
+        const QStringList watched = m_watcher.directories();
+        if (!watched.isEmpty())
+            m_watcher.removePaths(watched);
+        if (QFileInfo(path).isDir())
+            m_watcher.addPath(path);
+    }
+    if (path.isEmpty()) {
+        setStatus(Null);
+        return;
+    }
+    if (reset)
+        setStatus(Loading);
+
+    QMetaObject::invokeMethod(m_scanner, [scanner = m_scanner, generation, path, filters = m_nameFilters]() {
+        scanner->scan(generation, path, filters);
+    }, Qt::QueuedConnection);
+}
+
+void ImageFolderModel::entriesFound(int generation, const QList<ImageFolderEntry> &entries)
+{
+    if (generation != m_generation.loadRelaxed())
+        return;
+
+    QList<ImageFolderEntry> added;
+    for (const ImageFolderEntry &entry : entries) {
+        m_seen.insert(entry.fileName);
+        const int row = rowOf(entry.fileName);
+        if (row == m_entries.size() || m_entries.at(row).fileName != entry.fileName) {
+            added.append(entry);
+            continue;
+        }
+        ImageFolderEntry &existing = m_entries[row];
+        if (existing.lastModified != entry.lastModified || existing.imageSize != entry.imageSize) {
+            existing = entry;
+            const QModelIndex changed = index(row);
+            emit dataChanged(changed, changed, { FileModifiedRole, ImageSizeRole });
+        }
+    }
+    if (added.isEmpty())
+        return;
+
+    // New files that fall between the same two rows are inserted together
+    std::sort(added.begin(), added.end(), [](const ImageFolderEntry &a, const ImageFolderEntry &b) {
+        return fileNameLessThan(a.fileName, b.fileName);
+    });
+    for (int first = 0; first < added.size(); ) {
+        const int row = rowOf(added.at(first).fileName);
+        int last = first;
+        while (last + 1 < added.size() && (row == m_entries.size()
+                || fileNameLessThan(added.at(last + 1).fileName, m_entries.at(row).fileName))) {
+            ++last;
+        }
+        beginInsertRows(QModelIndex(), row, row + last - first);
+        for (int i = first; i <= last; ++i)
+            m_entries.insert(row + i - first, added.at(i));
+        endInsertRows();
+        first = last + 1;
+    }
+    emit countChanged();
+}
+
+void ImageFolderModel::scanFinished(int generation, bool exists)
+{
+    if (generation != m_generation.loadRelaxed())
+        return;
+
+    // Remove the files the scan did not see, as runs of rows from the end
+    bool removed = false;
+    for (int last = m_entries.size() - 1; last >= 0; --last) {
+        if (m_seen.contains(m_entries.at(last).fileName))
+            continue;
+        int first = last;
+        while (first > 0 && !m_seen.contains(m_entries.at(first - 1).fileName))
+            --first;
+        beginRemoveRows(QModelIndex(), first, last);
+        m_entries.remove(first, last - first + 1);
+        endRemoveRows();
+        removed = true;
+        last = first;
+    }
+    if (removed)
+        emit countChanged();
+    m_seen.clear();
+
+    // A folder that did not exist yet when it was set can be watched now
+    const QString path = m_folder.toLocalFile();
+    if (exists && m_watcher.directories().isEmpty())
+        m_watcher.addPath(path);
+    setStatus(exists ? Ready : Error);
+}
+
+/*
+Returns the row of the file, or the row it would be inserted at.
+*/
+int ImageFolderModel::rowOf(const QString &fileName) const
+{
+    const auto it = std::lower_bound(m_entries.cbegin(), m_entries.cend(), fileName,
+                                     [](const ImageFolderEntry &entry, const QString &name) {
+        return fileNameLessThan(entry.fileName, name);
+    });
+    return int(it - m_entries.cbegin());
+}
+
+void ImageFolderModel::setStatus(Status status)
+{
+    if (m_status == status)
+        return;
+    m_status = status;
+    emit statusChanged();
+}
@@ -0,0 +1,153 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef IMAGEFOLDERMODEL_H
+#define IMAGEFOLDERMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QQmlParserStatus>
+#include <QSet>
+#include <QSize>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QtQml>
+
+class ImageFolderScanner;
+
+struct ImageFolderEntry
+{
+    QString fileName;
+    QDateTime lastModified;
+    qint64 fileSize = 0;
+    // Read from the file header, with the orientation stored in it applied
+    QSize imageSize;
+};
+
+class ImageFolderModel : public QAbstractListModel, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+
+    Q_PROPERTY(QUrl folder READ folder WRITE setFolder NOTIFY folderChanged)
+    Q_PROPERTY(QStringList nameFilters READ nameFilters WRITE setNameFilters NOTIFY nameFiltersChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    QML_ELEMENT
+
+public:
+    enum Status { Null, Loading, Ready, Error };
+    Q_ENUM(Status)
+
+    enum Roles {
+        FileNameRole = Qt::UserRole + 1,
+        FileUrlRole,
+        FileModifiedRole,
+        ImageSizeRole
+    };
+
+    ImageFolderModel(QObject *parent = nullptr);
+    ~ImageFolderModel() override;
+
+    QUrl folder() const;
+    void setFolder(const QUrl &folder);
+
+    QStringList nameFilters() const;
+    void setNameFilters(const QStringList &nameFilters);
+
+    Status status() const;
+    int count() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void classBegin() override;
+    void componentComplete() override;
+
+    static QStringList imageNameFilters();
+
+Q_SIGNALS:
+    void folderChanged();
+    void nameFiltersChanged();
+    void statusChanged();
+    void countChanged();
+
+private:
+    friend class ImageFolderScanner;
+
+    void scan(bool reset);
+    void entriesFound(int generation, const QList<ImageFolderEntry> &entries);
+    void scanFinished(int generation, bool exists);
+    int rowOf(const QString &fileName) const;
+    void setStatus(Status status);
+
+    QUrl m_folder;
+    QStringList m_nameFilters;
+    Status m_status;
+    bool m_isComponentComplete;
+
+    // Sorted by file name
+    QList<ImageFolderEntry> m_entries;
+    // Files the current scan has reported so far
+    QSet<QString> m_seen;
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_rescanTimer;
+    QAtomicInt m_generation;
+    QThread m_scannerThread;
+    ImageFolderScanner *m_scanner;
+};
+
+#endif // IMAGEFOLDERMODEL_H
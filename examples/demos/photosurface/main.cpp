@@ -56,12 +56,10 @@
 #include <QtQml/QQmlApplicationEngine>
 #include <QtQml/QQmlContext>
 #include <QtQuick/QQuickWindow>
-#include <QtGui/QImageReader>
 #include <QtCore/QCommandLineParser>
 #include <QtCore/QCommandLineOption>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
-#include <QtCore/QMimeDatabase>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QUrl>
 #ifdef REQUEST_PERMISSIONS_ON_ANDROID
@@ -81,19 +79,6 @@ bool requestStoragePermission() {
 }
 #endif
 
-static QStringList imageNameFilters()
-{
-    QStringList result;
-    QMimeDatabase mimeDatabase;
-    const auto supportedMimeTypes = QImageReader::supportedMimeTypes();
-    for (const QByteArray &m : supportedMimeTypes) {
-        const auto suffixes = mimeDatabase.mimeTypeForName(m).suffixes();
-        for (const QString &suffix : suffixes)
-            result.append(QLatin1String("*.") + suffix);
-    }
-    return result;
-}
-
 int main(int argc, char* argv[])
 {
     // The reason to use QApplication is that QWidget-based dialogs
@@ -132,8 +117,6 @@ int main(int argc, char* argv[])
         }
     }
 
-    const QStringList nameFilters = imageNameFilters();
-
     QQmlApplicationEngine engine;
     QQmlContext *context = engine.rootContext();
 
@@ -141,15 +124,13 @@ int main(int argc, char* argv[])
     const QStringList picturesLocations = QStandardPaths::standardLocations(QStandardPaths::PicturesLocation);
     if (!picturesLocations.isEmpty()) {
         picturesLocationUrl = QUrl::fromLocalFile(picturesLocations.first());
-        if (initialUrl.isEmpty()
-            && !QDir(picturesLocations.first()).entryInfoList(nameFilters, QDir::Files).isEmpty()) {
+        // Whether it has any images is found out by scanning it in the background
+        if (initialUrl.isEmpty() && QDir(picturesLocations.first()).exists())
             initialUrl = picturesLocationUrl;
-        }
     }
 
     context->setContextProperty(QStringLiteral("contextPicturesLocation"), picturesLocationUrl);
     context->setContextProperty(QStringLiteral("contextInitialUrl"), initialUrl);
-    context->setContextProperty(QStringLiteral("contextImageNameFilters"), nameFilters);
 
     engine.load(QUrl("qrc:///photosurface.qml"));
     if (engine.rootObjects().isEmpty())
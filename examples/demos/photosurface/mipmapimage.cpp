@@ -0,0 +1,414 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "mipmapimage.h"
+
+#include <QImageReader>
+#include <QLineF>
+#include <QMutex>
+#include <QQmlFile>
+#include <QQuickWindow>
+#include <QSGImageNode>
+#include <QThreadPool>
+
+#include <cmath>
+
+/*
+Shows an image at a resolution matched to how large it currently is on
+the screen, taking the scale of the item and of its ancestors into
+account. Level 0 is the image at its full size, and every level halves
+the size of the previous one. Only the coarsest level that still covers
+every on-screen pixel is decoded, with QImageReader::setScaledSize() so
+that JPEG images are scaled while they are decoded, and uploaded as a
+mipmapped texture, which takes care of the scales in between levels.
+
+The level is checked with every frame. A finer level is loaded as soon as
+the item is zoomed in, while the current one stays on screen until it is
+ready. A coarser one only replaces it after the item has stayed zoomed out
+for a while, so that pinching back and forth does not decode the same
+levels over and over. Each item keeps only the level it shows, and drops
+it when it leaves the window.
+
+Images are always loaded asynchronously, with the orientation stored in
+them applied, and fit into the item keeping their aspect ratio.
+*/
+
+// How long an item has to stay zoomed out before a coarser level replaces its current one
+static const int CoarsenDelay = 500;
+
+/*
+Shared between an item and the thread pool job decoding a level for it.
+The job only delivers to the item while it still wants the result.
+*/
+struct MipmapImageJob : public QEnableSharedFromThis<MipmapImageJob>
+{
+    // The level asked for, or -1 to pick one once the size of the image is known
+    int level = -1;
+
+    QMutex mutex;
+    MipmapImage *item = nullptr;
+
+    void deliver(const QImage &image, int level, const QSize &sourceSize, const QString &errorString)
+    {
+        QMutexLocker locker(&mutex);
+        if (!item)
+            return;
+        MipmapImage *target = item;
+        // Held until the call is made, so that no later job can take its address
+        const QSharedPointer<MipmapImageJob> job = sharedFromThis();
+        QMetaObject::invokeMethod(target, [target, job, image, level, sourceSize, errorString]() {
+            // Superseded by another load after this one was queued
+            if (target->m_job != job)
+                return;
+            target->loaded(image, level, sourceSize, errorString);
+        }, Qt::QueuedConnection);
+    }
+};
+
+MipmapImage::MipmapImage(QQuickItem *parent) : QQuickItem(parent)
+    , m_level(-1), m_status(Null), m_imageChanged(false)
+{
+    setFlag(ItemHasContents);
+
+    m_coarsenTimer.setSingleShot(true);
+    m_coarsenTimer.setInterval(CoarsenDelay);
+    connect(&m_coarsenTimer, &QTimer::timeout, this, [this]() {
+        const QSizeF displaySize = this->displaySize();
+        if (displaySize.isEmpty() || m_job)
+            return;
+        const int level = levelFor(m_sourceSize, displaySize);
+        if (level > m_level)
+            load(level);
+    });
+}
+
+MipmapImage::~MipmapImage()
+{
+    cancel();
+}
+
+QUrl MipmapImage::source() const
+{
+    return m_source;
+}
+
+void MipmapImage::setSource(const QUrl &source)
+{
+    if (m_source == source)
+        return;
+    m_source = source;
+    emit sourceChanged();
+
+    cancel();
+    m_coarsenTimer.stop();
+    m_image = QImage();
+    m_imageChanged = true;
+    if (m_level != -1) {
+        m_level = -1;
+        emit levelChanged();
+    }
+    if (m_sourceSize.isValid()) {
+        m_sourceSize = QSize();
+        emit sourceSizeChanged();
+    }
+    setStatus(m_source.isEmpty() ? Null : Loading);
+    update();
+    updateLevel();
+}
+
+QSize MipmapImage::sourceSize() const
+{
+    return m_sourceSize;
+}
+
+int MipmapImage::level() const
+{
+    return m_level;
+}
+
+MipmapImage::Status MipmapImage::status() const
+{
+    return m_status;
+}
+
+/*
+Returns the coarsest level of an image of \a sourceSize that is at least
+\a displaySize large. Items with nothing to show get the coarsest level
+there is.
+*/
+int MipmapImage::levelFor(const QSize &sourceSize, const QSizeF &displaySize)
+{
+    if (sourceSize.isEmpty())
+        return 0;
+    const int coarsest = int(std::log2(qMax(sourceSize.width(), sourceSize.height())));
+    if (displaySize.isEmpty())
+        return coarsest;
+    const qreal ratio = qMin(sourceSize.width() / displaySize.width(),
+                             sourceSize.height() / displaySize.height());
+    if (ratio < 2)
+        return 0;
+    return qMin(coarsest, int(std::floor(std::log2(ratio))));
+}
+
+QSize MipmapImage::levelSize(const QSize &sourceSize, int level)
+{
+    const int divisor = 1 << qBound(0, level, 30);
+    return QSize(qMax(1, (sourceSize.width() + divisor - 1) / divisor),
+                 qMax(1, (sourceSize.height() + divisor - 1) / divisor));
+}
+
+/*
+Reads \a fileName at \a level, or, if that is negative, at the level that
+suits \a displaySize, and returns the level read in \a level. Readers that
+cannot scale while decoding, or that do not know the size of the image
+before decoding it, decode it at full size first.
+*/
+QImage MipmapImage::readLevel(const QString &fileName, const QSizeF &displaySize, int *level,
+                              QSize *sourceSize, QString *errorString)
+{
+    QImageReader reader(fileName);
+    reader.setAutoTransform(true);
+
+    // The reader scales before it applies the orientation stored in the image
+    const QSize storedSize = reader.size();
+    const bool transposed = reader.transformation() & QImageIOHandler::TransformationRotate90;
+    if (storedSize.isValid()) {
+        *sourceSize = transposed ? storedSize.transposed() : storedSize;
+        if (*level < 0)
+            *level = levelFor(*sourceSize, displaySize);
+        if (*level > 0)
+            reader.setScaledSize(levelSize(storedSize, *level));
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        if (errorString)
+            *errorString = reader.errorString();
+        return image;
+    }
+    if (!storedSize.isValid()) {
+        *sourceSize = image.size();
+        if (*level < 0)
+            *level = levelFor(*sourceSize, displaySize);
+        if (*level > 0)
+            image = image.scaled(levelSize(*sourceSize, *level), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+QSGNode *MipmapImage::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QSGImageNode *node = static_cast<QSGImageNode *>(oldNode);
+    if (m_imageChanged) {
+        if (m_image.isNull()) {
+            delete node;
+            node = nullptr;
+        } else {
+            if (!node) {
+                node = window()->createImageNode();
+                node->setOwnsTexture(true);
+            }
+            node->setTexture(window()->createTextureFromImage(m_image, QQuickWindow::TextureHasMipmaps));
+        }
+        // The texture has it now
+        m_image = QImage();
+        m_imageChanged = false;
+    }
+    if (!node)
+        return nullptr;
+
+    node->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+    node->setMipmapFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+    const QSizeF textureSize = node->texture()->textureSize();
+    const QSizeF fitted = textureSize.scaled(size(), Qt::KeepAspectRatio);
+    node->setRect(QRectF(QPointF((width() - fitted.width()) / 2, (height() - fitted.height()) / 2), fitted));
+    node->setSourceRect(QRectF(QPointF(), textureSize));
+    return node;
+}
+
+void MipmapImage::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    if (change == ItemSceneChange || change == ItemVisibleHasChanged)
+        updateLevel();
+    QQuickItem::itemChange(change, value);
+}
+
+/*
+The texture goes away with the node, so the level has to be loaded again
+once the item is back in a window.
+*/
+void MipmapImage::releaseResources()
+{
+    cancel();
+    m_coarsenTimer.stop();
+    m_image = QImage();
+    m_imageChanged = false;
+    if (m_level != -1) {
+        m_level = -1;
+        emit levelChanged();
+    }
+}
+
+/*
+The size of the item on the screen, in device pixels.
+*/
+QSizeF MipmapImage::displaySize() const
+{
+    QQuickWindow *window = this->window();
+    if (!window || !isVisible())
+        return QSizeF();
+    const qreal scale = QLineF(mapToScene(QPointF(0, 0)), mapToScene(QPointF(1, 0))).length();
+    return size() * scale * window->effectiveDevicePixelRatio();
+}
+
+void MipmapImage::updateLevel()
+{
+    // Items created inside a window never see it change
+    if (m_frameWindow != window()) {
+        disconnect(m_frameConnection);
+        m_frameWindow = window();
+        if (m_frameWindow)
+            m_frameConnection = connect(m_frameWindow, &QQuickWindow::afterAnimating, this, &MipmapImage::updateLevel);
+    }
+
+    if (m_source.isEmpty() || m_status == Error || !window() || !isVisible())
+        return;
+    if (!m_sourceSize.isValid()) {
+        if (!m_job)
+            load(-1);
+        return;
+    }
+
+    const QSizeF displaySize = this->displaySize();
+    if (displaySize.isEmpty())
+        return;
+    // What is shown, or will be shortly
+    const int current = m_job ? m_job->level : m_level;
+    const int level = levelFor(m_sourceSize, displaySize);
+    if (current < 0 || level < current) {
+        m_coarsenTimer.stop();
+        load(level);
+    } else if (level > current) {
+        if (!m_coarsenTimer.isActive())
+            m_coarsenTimer.start();
+    } else {
+        m_coarsenTimer.stop();
+    }
+}
+
+void MipmapImage::load(int level)
+{
+    cancel();
+    m_job.reset(new MipmapImageJob);
+    m_job->level = level;
+    m_job->item = this;
+    if (m_level < 0)
+        setStatus(Loading);
+
+    const QSharedPointer<MipmapImageJob> job = m_job;
+    const QString fileName = QQmlFile::urlToLocalFileOrQrc(m_source);
+    const QSizeF displaySize = this->displaySize();
+    QThreadPool::globalInstance()->start([job, fileName, displaySize]() {
+        {
+            QMutexLocker locker(&job->mutex);
+            if (!job->item)
+                return;
+        }
+        int level = job->level;
+        QSize sourceSize;
+        QString errorString;
+        const QImage image = readLevel(fileName, displaySize, &level, &sourceSize, &errorString);
+        job->deliver(image, level, sourceSize, errorString);
+    });
+}
+
+void MipmapImage::loaded(const QImage &image, int level, const QSize &sourceSize, const QString &errorString)
+{
+    m_job.reset();
+    if (image.isNull()) {
+        qmlWarning(this) << "Cannot load " << m_source.toString() << ": " << errorString;
+        setStatus(Error);
+        return;
+    }
+
+    if (m_sourceSize != sourceSize) {
+        m_sourceSize = sourceSize;
+        setImplicitSize(sourceSize.width(), sourceSize.height());
+        emit sourceSizeChanged();
+    }
+    m_image = image;
+    m_imageChanged = true;
+    if (m_level != level) {
+        m_level = level;
+        emit levelChanged();
+    }
+    setStatus(Ready);
+    update();
+    // The item may have been zoomed while the level was loading
+    updateLevel();
+}
+
+void MipmapImage::setStatus(Status status)
+{
+    if (m_status == status)
+        return;
+    m_status = status;
+    emit statusChanged();
+}
+
+void MipmapImage::cancel()
+{
+    if (!m_job)
+        return;
+    QMutexLocker locker(&m_job->mutex);
+    m_job->item = nullptr;
+    locker.unlock();
+    m_job.reset();
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef MIPMAPIMAGE_H
+#define MIPMAPIMAGE_H
+
+#include <QImage>
+#include <QPointer>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QSharedPointer>
+#include <QSize>
+#include <QTimer>
+#include <QUrl>
+#include <QtQml>
+
+struct MipmapImageJob;
+
+class MipmapImage : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QSize sourceSize READ sourceSize NOTIFY sourceSizeChanged)
+    Q_PROPERTY(int level READ level NOTIFY levelChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+    QML_ELEMENT
+
+public:
+    enum Status { Null, Loading, Ready, Error };
+    Q_ENUM(Status)
+
+    MipmapImage(QQuickItem *parent = nullptr);
+    ~MipmapImage() override;
+
+    QUrl source() const;
+    void setSource(const QUrl &source);
+
+    QSize sourceSize() const;
+    int level() const;
+    Status status() const;
+
+    static int levelFor(const QSize &sourceSize, const QSizeF &displaySize);
+    static QSize levelSize(const QSize &sourceSize, int level);
+    static QImage readLevel(const QString &fileName, const QSizeF &displaySize, int *level,
+                            QSize *sourceSize, QString *errorString = nullptr);
+
+Q_SIGNALS:
+    void sourceChanged();
+    void sourceSizeChanged();
+    void levelChanged();
+    void statusChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+    void releaseResources() override;
+
+private:
+    friend struct MipmapImageJob;
+
+    QSizeF displaySize() const;
+    void updateLevel();
+    void load(int level);
+    void loaded(const QImage &image, int level, const QSize &sourceSize, const QString &errorString);
+    void setStatus(Status status);
+    void cancel();
+
+    QUrl m_source;
+    QSize m_sourceSize;
+    int m_level;
+    Status m_status;
+    // Decoded, but not uploaded yet
+    QImage m_image;
+    bool m_imageChanged;
+    QSharedPointer<MipmapImageJob> m_job;
+    QTimer m_coarsenTimer;
+    QPointer<QQuickWindow> m_frameWindow;
+    QMetaObject::Connection m_frameConnection;
+};
+
+#endif // MIPMAPIMAGE_H
@@ -6,9 +6,17 @@ android: qtHaveModule(androidextras) {
     DEFINES += REQUEST_PERMISSIONS_ON_ANDROID
 }
 qtHaveModule(widgets): QT += widgets
-SOURCES += main.cpp
+CONFIG += qmltypes
+HEADERS += imagefoldermodel.h \
+           mipmapimage.h
+SOURCES += main.cpp \
+           imagefoldermodel.cpp \
+           mipmapimage.cpp
 RESOURCES += photosurface.qrc
 
+QML_IMPORT_NAME = PhotoSurface
+QML_IMPORT_MAJOR_VERSION = 1
+
 target.path = $$[QT_INSTALL_EXAMPLES]/demos/photosurface
 INSTALLS += target
 ICON = resources/icon.png
@@ -49,8 +49,8 @@
 ****************************************************************************/
 import QtQuick
 import QtQuick.Window
-import Qt.labs.folderlistmodel
 import Qt.labs.platform
+import PhotoSurface
 
 Window {
     id: root
@@ -66,7 +66,7 @@ Window {
         id: folderDialog
         title: "Choose a folder with some images"
         folder: picturesLocation
-        onAccepted: folderModel.folder = folder + "/"
+        onAccepted: folderModel.folder = folder
     }
 
     Flickable {
@@ -75,17 +75,16 @@ Window {
         contentWidth: width * surfaceViewportRatio
         contentHeight: height * surfaceViewportRatio
         Repeater {
-            model: FolderListModel {
+            model: ImageFolderModel {
                 id: folderModel
                 objectName: "folderModel"
-                showDirs: false
-                nameFilters: imageNameFilters
+                onStatusChanged: if (status === ImageFolderModel.Ready && count === 0) folderDialog.open()
             }
             Rectangle {
                 id: photoFrame
                 width: image.width * (1 + 0.10 * image.height / image.width)
                 height: image.height * 1.10
-                scale: defaultSize / Math.max(image.sourceSize.width, image.sourceSize.height)
+                scale: defaultSize / Math.max(image.width, image.height)
                 Behavior on scale { NumberAnimation { duration: 200 } }
                 Behavior on x { NumberAnimation { duration: 200 } }
                 Behavior on y { NumberAnimation { duration: 200 } }
@@ -98,11 +97,14 @@ Window {
                     y = Math.random() * root.height - height / 2
                     rotation = Math.random() * 13 - 6
                 }
-                Image {
+                MipmapImage {
                     id: image
                     anchors.centerIn: parent
-                    fillMode: Image.PreserveAspectFit
-                    source: folderModel.folder + fileName
+                    // The size read from the header lays the frame out before the image is
+                    // decoded; images without one get their size once they are loaded
+                    width: imageSize.width > 0 ? imageSize.width : implicitWidth
+                    height: imageSize.height > 0 ? imageSize.height : implicitHeight
+                    source: fileUrl
                     antialiasing: true
                 }
                 PinchArea {
@@ -118,7 +120,7 @@ Window {
                     onSmartZoom: {
                         if (pinch.scale > 0) {
                             photoFrame.rotation = 0;
-                            photoFrame.scale = Math.min(root.width, root.height) / Math.max(image.sourceSize.width, image.sourceSize.height) * 0.85
+                            photoFrame.scale = Math.min(root.width, root.height) / Math.max(image.width, image.height) * 0.85
                             photoFrame.x = flick.contentX + (flick.width - photoFrame.width) / 2
                             photoFrame.y = flick.contentY + (flick.height - photoFrame.height) / 2
                             zRestore = photoFrame.z
@@ -266,20 +268,14 @@ Window {
     Shortcut { sequence: StandardKey.Quit; onActivated: Qt.quit() }
 
     Component.onCompleted: {
-        if (typeof contextInitialUrl !== 'undefined') {
-            // Launched from C++ with context properties set.
-            imageNameFilters = contextImageNameFilters;
-            picturesLocation = contextPicturesLocation;
-            if (contextInitialUrl == "")
-                folderDialog.open();
-            else
-                folderModel.folder = contextInitialUrl + "/";
-        } else {
-            // Launched via QML viewer without context properties set.
+        // ImageFolderModel and MipmapImage come from the C++ application,
+        // which always sets these context properties.
+        picturesLocation = contextPicturesLocation;
+        if (contextInitialUrl == "")
             folderDialog.open();
-        }
+        else
+            folderModel.folder = contextInitialUrl;
     }
 
-    property var imageNameFilters : ["*.png", "*.jpg", "*.gif"];
     property string picturesLocation : "";
 }
@@ -49,6 +49,7 @@
 ****************************************************************************/
 
 import QtQuick
+import PhotoViewer
 import "script/script.mjs" as Script
 
 Package {
@@ -98,8 +99,10 @@ Package {
             BusyIndicator { anchors.centerIn: parent; on: originalImage.status != Image.Ready }
             Image {
                 id: originalImage; antialiasing: true;
-                source: link; cache: false
+                source: 'image://photos/thumbnail/' + encodeURIComponent(link); cache: false
+                sourceSize { width: 140; height: 133 }
                 fillMode: Image.PreserveAspectFit; width: photoWrapper.width; height: photoWrapper.height
+                PhotoVisibility { target: originalImage; source: originalImage.source }
             }
             Image {
                 id: hqImage; antialiasing: true; source: ""; visible: false; cache: false
@@ -143,7 +146,10 @@ Package {
                     width: mainWindow.width; height: mainWindow.height
                 }
                 PropertyChanges { target: border; opacity: 0 }
-                PropertyChanges { target: hqImage; source: listItem.ListView.isCurrentItem ? link : ""; visible: true }
+                PropertyChanges {
+                    target: hqImage; visible: true
+                    source: listItem.ListView.isCurrentItem ? 'image://photos/full/' + encodeURIComponent(link) : ""
+                }
             }
             ]
 
@@ -64,4 +64,5 @@ XmlListModel {
         XmlListModelRole { elementName: "title"; attributeName: "" },
         XmlListModelRole { elementName: "link"; attributeName: "href" }
     ]
+    keyRole: "link"
 }
@@ -53,6 +53,9 @@
 #include <QTranslator>
 #include <QDebug>
 
+#include "photoprovider.h"
+#include "photovisibility.h"
+
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
@@ -61,7 +64,12 @@ int main(int argc, char *argv[])
     qtTranslator.load(QLocale(), "qml", "_", ":/i18n/");
     app.installTranslator(&qtTranslator);
 
+    // The types of the application get an import of their own; the one
+    // generated from the sources is XmlListModel.
+    qmlRegisterType<PhotoVisibility>("PhotoViewer", 1, 0, "PhotoVisibility");
+
     QQmlApplicationEngine engine;
+    engine.addImageProvider(QStringLiteral("photos"), new PhotoProvider);
     engine.load(QUrl(QStringLiteral("qrc:///main.qml")));
 
     return app.exec();
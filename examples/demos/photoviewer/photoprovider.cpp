@@ -0,0 +1,484 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "photoprovider.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImageReader>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QQmlFile>
+
+/*
+Photos are requested as image://photos/thumbnail/<url> or
+image://photos/full/<url>, with the url percent-encoded. Thumbnails are
+decoded straight to the requested size, which lets the JPEG decoder skip
+most of the work by scaling in the DCT domain, and are kept in a cache
+bounded by their size in bytes. Full-resolution photos are only scaled
+when the item asks for a size, and are never cached: the fullscreen view
+shows one at a time and holds on to it itself.
+
+Downloads run on a thread of their own and decoding on the provider's
+thread pool, so neither the GUI thread nor the pixmap reader waits on them.
+Only a few of each run at a time. Waiting downloads are started closest to
+the viewport first, as reported by the PhotoVisibility items in the
+delegates, and photos that are too far away to be needed soon are not
+downloaded until they come closer. Photos nobody reported on are treated
+as visible.
+*/
+
+static const qint64 DefaultThumbnailCacheSize = 16 * 1024 * 1024;
+static const QSize DefaultThumbnailSize(256, 256);
+static const int DefaultMaximumDownloads = 4;
+
+class PhotoResponse;
+
+/*
+Shared between a response and the download and decode jobs working for
+it. The jobs only deliver to the response while it is still there.
+*/
+struct PhotoRequest
+{
+    QString id;
+    QUrl url;
+    QSize requestedSize;
+    QString cacheKey;
+    QAtomicInt cancelled;
+    QPointer<QNetworkReply> reply;
+
+    QMutex mutex;
+    PhotoResponse *response = nullptr;
+
+    void deliver(const QImage &image, const QString &errorString);
+};
+
+class PhotoResponse : public QQuickImageResponse
+{
+public:
+    PhotoResponse(const QSharedPointer<PhotoRequest> &request, PhotoProvider *provider)
+        : m_request(request), m_provider(provider)
+    {
+        m_request->response = this;
+    }
+
+    ~PhotoResponse() override
+    {
+        QMutexLocker locker(&m_request->mutex);
+        m_request->response = nullptr;
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    QString errorString() const override
+    {
+        return m_errorString;
+    }
+
+    void cancel() override
+    {
+        m_request->cancelled.storeRelaxed(1);
+        m_provider->cancel(m_request);
+    }
+
+    void finish(const QImage &image, const QString &errorString)
+    {
+        m_image = image;
+        m_errorString = errorString;
+        emit finished();
+    }
+
+private:
+    QSharedPointer<PhotoRequest> m_request;
+    PhotoProvider *m_provider;
+    QImage m_image;
+    QString m_errorString;
+};
+
+void PhotoRequest::deliver(const QImage &image, const QString &errorString)
+{
+    QMutexLocker locker(&mutex);
+    if (!response)
+        return;
+    // finished() is only connected once requestImageResponse() has returned
+    PhotoResponse *target = response;
+    QMetaObject::invokeMethod(target, [target, image, errorString]() {
+        target->finish(image, errorString);
+    }, Qt::QueuedConnection);
+}
+
+/*
+Lives on the provider's loader thread and owns the network access manager
+all photos are downloaded with.
+*/
+class PhotoLoader : public QObject
+{
+public:
+    explicit PhotoLoader(PhotoProvider *provider)
+        : m_provider(provider), m_manager(new QNetworkAccessManager(this))
+    {
+    }
+
+    void load(const QSharedPointer<PhotoRequest> &request)
+    {
+        if (request->cancelled.loadRelaxed()) {
+            m_provider->downloadFinished();
+            return;
+        }
+        QNetworkReply *reply = m_manager->get(QNetworkRequest(request->url));
+        request->reply = reply;
+        connect(reply, &QNetworkReply::finished, this, [this, request, reply]() {
+            reply->deleteLater();
+            m_provider->downloadFinished();
+            if (request->cancelled.loadRelaxed())
+                return;
+            if (reply->error() != QNetworkReply::NoError)
+                request->deliver(QImage(), reply->errorString());
+            else
+                m_provider->startDecode(request, reply->readAll());
+        });
+    }
+
+    void abort(const QSharedPointer<PhotoRequest> &request)
+    {
+        if (request->reply)
+            request->reply->abort();
+    }
+
+private:
+    PhotoProvider *m_provider;
+    QNetworkAccessManager *m_manager;
+};
+
+PhotoProvider::PhotoProvider()
+    : m_runningDownloads(0), m_maximumDownloads(DefaultMaximumDownloads)
+    , m_loader(new PhotoLoader(this))
+{
+    m_thumbnails.setMaxCost(DefaultThumbnailCacheSize);
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    m_loader->moveToThread(&m_loaderThread);
+    QObject::connect(&m_loaderThread, &QThread::finished, m_loader, &QObject::deleteLater);
+    m_loaderThread.setObjectName(QStringLiteral("PhotoProvider loader"));
+    m_loaderThread.start();
+}
+
+PhotoProvider::~PhotoProvider()
+{
+    // No more downloads can finish, and so start decoding, once the loader is gone
+    m_loaderThread.quit();
+    m_loaderThread.wait();
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QQuickImageResponse *PhotoProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    QSharedPointer<PhotoRequest> request(new PhotoRequest);
+    PhotoResponse *response = new PhotoResponse(request, this);
+
+    const int slash = id.indexOf(QLatin1Char('/'));
+    const QStringView kind = slash < 0 ? QStringView() : QStringView(id).left(slash);
+    request->id = id;
+    request->url = QUrl(QUrl::fromPercentEncoding(id.mid(slash + 1).toUtf8()));
+    request->requestedSize = requestedSize;
+    if (kind == QLatin1String("thumbnail")) {
+        if (!requestedSize.isValid())
+            request->requestedSize = DefaultThumbnailSize;
+        request->cacheKey = cacheKey(request->url, request->requestedSize);
+    } else if (kind != QLatin1String("full")) {
+        request->deliver(QImage(), QStringLiteral("Unknown photo %1").arg(id));
+        return response;
+    }
+
+    QImage image;
+    if (!request->cacheKey.isEmpty() && cachedThumbnail(request->cacheKey, &image)) {
+        request->deliver(image, QString());
+    } else if (request->url.isLocalFile() || request->url.scheme() == QLatin1String("qrc")) {
+        m_pool.start([this, request]() {
+            if (request->cancelled.loadRelaxed())
+                return;
+            QFile file(QQmlFile::urlToLocalFileOrQrc(request->url));
+            if (!file.open(QIODevice::ReadOnly))
+                request->deliver(QImage(), file.errorString());
+            else
+                startDecode(request, file.readAll());
+        }, decodePriority(id));
+    } else {
+        QMutexLocker locker(&m_mutex);
+        m_pending.append(request);
+        schedule();
+    }
+    return response;
+}
+
+/*
+Returns the id the pixmap reader passes to requestImageResponse() for an
+image://photos/ \a source.
+*/
+QString PhotoProvider::requestId(const QUrl &source)
+{
+    return source.toString(QUrl::RemoveScheme | QUrl::RemoveAuthority).mid(1);
+}
+
+/*
+Sets the priority \a owner gives to the photo requested as \a id: 0 when
+it is visible, its distance from the viewport in pixels when it is close,
+or Deferred. A photo shown by several items takes the most urgent of
+their priorities.
+*/
+void PhotoProvider::setPriority(const QString &id, const QObject *owner, int priority)
+{
+    QMutexLocker locker(&m_mutex);
+    int &current = m_priorities[id][owner];
+    if (current == priority)
+        return;
+    current = priority;
+    schedule();
+}
+
+void PhotoProvider::clearPriority(const QString &id, const QObject *owner)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_priorities.find(id);
+    if (it == m_priorities.end())
+        return;
+    // Owners go away with their images, which cancel their own requests, so
+    // this does not reschedule anything
+    it->remove(owner);
+    if (it->isEmpty())
+        m_priorities.erase(it);
+}
+
+// Called with the mutex locked
+int PhotoProvider::priority(const QString &id) const
+{
+    const auto it = m_priorities.constFind(id);
+    if (it == m_priorities.constEnd())
+        return 0;
+    int result = Deferred;
+    for (int priority : *it)
+        result = qMin(result, priority);
+    return result;
+}
+
+// The pool starts jobs with higher priorities first
+int PhotoProvider::decodePriority(const QString &id) const
+{
+    QMutexLocker locker(&m_mutex);
+    return -priority(id);
+}
+
+/*
+Starts the most urgent waiting downloads while there are free slots. Called
+with the mutex locked.
+*/
+void PhotoProvider::schedule()
+{
+    while (m_runningDownloads < m_maximumDownloads) {
+        int next = -1;
+        int nextPriority = Deferred;
+        for (int i = 0; i < m_pending.size(); ++i) {
+            const int priority = this->priority(m_pending.at(i)->id);
+            if (priority < nextPriority) {
+                next = i;
+                nextPriority = priority;
+            }
+        }
+        if (next < 0)
+            return;
+
+        const QSharedPointer<PhotoRequest> request = m_pending.takeAt(next);
+        ++m_runningDownloads;
+        QMetaObject::invokeMethod(m_loader, [loader = m_loader, request]() { loader->load(request); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+void PhotoProvider::cancel(const QSharedPointer<PhotoRequest> &request)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.removeOne(request))
+        return;
+    QMetaObject::invokeMethod(m_loader, [loader = m_loader, request]() { loader->abort(request); },
+                              Qt::QueuedConnection);
+}
+
+void PhotoProvider::downloadFinished()
+{
+    QMutexLocker locker(&m_mutex);
+    --m_runningDownloads;
+    schedule();
+}
+
+int PhotoProvider::maximumDownloads() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maximumDownloads;
+}
+
+void PhotoProvider::setMaximumDownloads(int downloads)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumDownloads = qMax(1, downloads);
+    schedule();
+}
+
+int PhotoProvider::maximumDecodes() const
+{
+    return m_pool.maxThreadCount();
+}
+
+void PhotoProvider::setMaximumDecodes(int decodes)
+{
+    m_pool.setMaxThreadCount(qMax(1, decodes));
+}
+
+void PhotoProvider::startDecode(const QSharedPointer<PhotoRequest> &request, const QByteArray &data)
+{
+    m_pool.start([this, request, data]() {
+        if (request->cancelled.loadRelaxed())
+            return;
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        QString errorString;
+        const QImage image = decode(&buffer, request->requestedSize, &errorString);
+        if (!image.isNull() && !request->cacheKey.isEmpty())
+            insertThumbnail(request->cacheKey, image);
+        request->deliver(image, errorString);
+    }, decodePriority(request->id));
+}
+
+/*
+Decodes an image to fit within \a requestedSize, keeping its aspect ratio.
+Readers that support it, like the JPEG one, are asked for the smaller size
+directly, everything else is scaled after reading. Images are never scaled
+up.
+*/
+QImage PhotoProvider::decode(QIODevice *device, const QSize &requestedSize, QString *errorString)
+{
+    QImageReader reader(device);
+    reader.setAutoTransform(true);
+
+    // The reader scales before it applies the orientation stored in the image
+    const QSize size = reader.size();
+    const bool transposed = reader.transformation() & QImageIOHandler::TransformationRotate90;
+    const QSize scaledSize = fittedSize(size, transposed ? requestedSize.transposed() : requestedSize);
+    if (size.isValid() && scaledSize != size && reader.supportsOption(QImageIOHandler::ScaledSize))
+        reader.setScaledSize(scaledSize);
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        if (errorString)
+            *errorString = reader.errorString();
+        return image;
+    }
+
+    const QSize fitted = fittedSize(image.size(), requestedSize);
+    if (fitted != image.size())
+        image = image.scaled(fitted, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+/*
+Returns \a size scaled down to fit within \a bounds. A bound that is not
+positive does not constrain that dimension.
+*/
+QSize PhotoProvider::fittedSize(const QSize &size, const QSize &bounds)
+{
+    const QSize limit(bounds.width() > 0 ? bounds.width() : INT_MAX,
+                      bounds.height() > 0 ? bounds.height() : INT_MAX);
+    if (!size.isValid() || (size.width() <= limit.width() && size.height() <= limit.height()))
+        return size;
+    return size.scaled(limit, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+}
+
+qint64 PhotoProvider::thumbnailCacheSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_thumbnails.maxCost();
+}
+
+void PhotoProvider::setThumbnailCacheSize(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_thumbnails.setMaxCost(bytes);
+}
+
+qint64 PhotoProvider::thumbnailCacheUsage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_thumbnails.totalCost();
+}
+
+QString PhotoProvider::cacheKey(const QUrl &url, const QSize &size)
+{
+    return QStringLiteral("%1x%2 %3").arg(size.width()).arg(size.height()).arg(url.toString());
+}
+
+bool PhotoProvider::cachedThumbnail(const QString &key, QImage *image)
+{
+    QMutexLocker locker(&m_mutex);
+    if (const QImage *cached = m_thumbnails.object(key)) {
+        *image = *cached;
+        return true;
+    }
+    return false;
+}
+
+void PhotoProvider::insertThumbnail(const QString &key, const QImage &image)
+{
+    QMutexLocker locker(&m_mutex);
+    m_thumbnails.insert(key, new QImage(image), image.sizeInBytes());
+}
@@ -0,0 +1,124 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PHOTOPROVIDER_H
+#define PHOTOPROVIDER_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QUrl>
+
+#include <climits>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
+
+class PhotoLoader;
+struct PhotoRequest;
+
+class PhotoProvider : public QQuickAsyncImageProvider
+{
+public:
+    PhotoProvider();
+    ~PhotoProvider() override;
+
+    // Priority of photos that are too far away, or scrolling away, to load at all
+    static constexpr int Deferred = INT_MAX;
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+    static QString requestId(const QUrl &source);
+
+    void setPriority(const QString &id, const QObject *owner, int priority);
+    void clearPriority(const QString &id, const QObject *owner);
+
+    int maximumDownloads() const;
+    void setMaximumDownloads(int downloads);
+    int maximumDecodes() const;
+    void setMaximumDecodes(int decodes);
+
+    qint64 thumbnailCacheSize() const;
+    void setThumbnailCacheSize(qint64 bytes);
+    qint64 thumbnailCacheUsage() const;
+
+    static QImage decode(QIODevice *device, const QSize &requestedSize, QString *errorString = nullptr);
+    static QSize fittedSize(const QSize &size, const QSize &bounds);
+
+private:
+    friend class PhotoLoader;
+    friend class PhotoResponse;
+
+    static QString cacheKey(const QUrl &url, const QSize &size);
+    bool cachedThumbnail(const QString &key, QImage *image);
+    void insertThumbnail(const QString &key, const QImage &image);
+    int priority(const QString &id) const;
+    int decodePriority(const QString &id) const;
+    void schedule();
+    void cancel(const QSharedPointer<PhotoRequest> &request);
+    void downloadFinished();
+    void startDecode(const QSharedPointer<PhotoRequest> &request, const QByteArray &data);
+
+    mutable QMutex m_mutex;
+    QCache<QString, QImage> m_thumbnails;
+    QList<QSharedPointer<PhotoRequest>> m_pending;
+    QHash<QString, QHash<const QObject *, int>> m_priorities;
+    int m_runningDownloads;
+    int m_maximumDownloads;
+    QThread m_loaderThread;
+    PhotoLoader *m_loader;
+    QThreadPool m_pool;
+};
+
+#endif // PHOTOPROVIDER_H
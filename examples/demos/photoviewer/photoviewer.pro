@@ -1,12 +1,16 @@
 TEMPLATE = app
 
-QT += qml quick
+QT += qml quick network
 CONFIG += lrelease embed_translations qmltypes
 
 INCLUDEPATH += ../shared
 
-HEADERS += ../shared/xmllistmodel.h
+HEADERS += photoprovider.h \
+           photovisibility.h \
+           ../shared/xmllistmodel.h
 SOURCES += main.cpp \
+           photoprovider.cpp \
+           photovisibility.cpp \
            ../shared/xmllistmodel.cpp
 
 QML_IMPORT_NAME = XmlListModel
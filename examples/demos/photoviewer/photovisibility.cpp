@@ -0,0 +1,239 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "photovisibility.h"
+#include "photoprovider.h"
+
+#include <QQuickWindow>
+
+/*
+Tells the photo provider how urgently the image shown by the target item
+is needed. The priority is updated with every frame from where the item
+is in the window: 0 while it is in view, and its distance from the view
+in pixels while it is within one screen of it and not scrolling away.
+Anything else, including items that are hidden or not in a window, is
+Deferred and not downloaded until it comes closer.
+
+Mapping the item into the window is skipped in frames in which neither
+the item nor anything it is in has moved, been resized or hidden.
+*/
+PhotoVisibility::PhotoVisibility(QObject *parent) : QObject(parent)
+    , m_priority(PhotoProvider::Deferred), m_moved(true)
+{
+}
+
+PhotoVisibility::~PhotoVisibility()
+{
+    if (PhotoProvider *provider = this->provider())
+        provider->clearPriority(m_id, this);
+}
+
+QQuickItem *PhotoVisibility::target() const
+{
+    return m_target;
+}
+
+void PhotoVisibility::setTarget(QQuickItem *target)
+{
+    if (m_target == target)
+        return;
+    if (m_target)
+        disconnect(m_target, &QQuickItem::windowChanged, this, &PhotoVisibility::windowChanged);
+    m_target = target;
+    if (m_target)
+        connect(m_target, &QQuickItem::windowChanged, this, &PhotoVisibility::windowChanged);
+    watchAncestors();
+    windowChanged(m_target ? m_target->window() : nullptr);
+    emit targetChanged();
+}
+
+QUrl PhotoVisibility::source() const
+{
+    return m_source;
+}
+
+void PhotoVisibility::setSource(const QUrl &source)
+{
+    if (m_source == source)
+        return;
+    if (PhotoProvider *provider = this->provider())
+        provider->clearPriority(m_id, this);
+    m_source = source;
+    m_id = PhotoProvider::requestId(source);
+    if (PhotoProvider *provider = this->provider())
+        provider->setPriority(m_id, this, m_priority);
+    emit sourceChanged();
+}
+
+int PhotoVisibility::priority() const
+{
+    return m_priority;
+}
+
+void PhotoVisibility::windowChanged(QQuickWindow *window)
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_windowConnections))
+        disconnect(connection);
+    m_windowConnections.clear();
+    if (window) {
+        m_windowConnections.append(connect(window, &QQuickWindow::afterAnimating, this, &PhotoVisibility::update));
+        m_windowConnections.append(connect(window, &QWindow::widthChanged, this, &PhotoVisibility::markMoved));
+        m_windowConnections.append(connect(window, &QWindow::heightChanged, this, &PhotoVisibility::markMoved));
+    }
+    m_previous = QRectF();
+    markMoved();
+    update();
+}
+
+// Everything that can move the target in the window, or hide it
+void PhotoVisibility::watchAncestors()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_ancestorConnections))
+        disconnect(connection);
+    m_ancestorConnections.clear();
+    for (QQuickItem *item = m_target; item; item = item->parentItem()) {
+        m_ancestorConnections.append(connect(item, &QQuickItem::xChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::yChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::widthChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::heightChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::scaleChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::rotationChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::visibleChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::opacityChanged, this, &PhotoVisibility::markMoved));
+        m_ancestorConnections.append(connect(item, &QQuickItem::parentChanged, this, &PhotoVisibility::watchAncestors));
+    }
+    markMoved();
+}
+
+void PhotoVisibility::markMoved()
+{
+    m_moved = true;
+}
+
+void PhotoVisibility::update()
+{
+    // Frames keep being mapped until the target is where it was in the
+    // last one, so that a photo the view stopped scrolling away from is
+    // no longer deferred.
+    if (!m_moved)
+        return;
+
+    QQuickWindow *window = m_target ? m_target->window() : nullptr;
+    if (!window || !isShown(m_target)) {
+        m_previous = QRectF();
+        m_moved = false;
+        setPriority(PhotoProvider::Deferred);
+        return;
+    }
+
+    const QRectF rect = m_target->mapRectToScene(m_target->boundingRect());
+    setPriority(priorityFor(rect, m_previous, QRectF(QPointF(), window->size())));
+    m_moved = rect != m_previous;
+    m_previous = rect;
+}
+
+/*
+Returns the priority of a photo covering \a rect in a window showing
+\a viewport, when it covered \a previous in the last frame. Photos are
+prefetched one screen ahead in the direction the view scrolls: they have
+to be closer than the size of the viewport along the side they are on,
+and not further away than they were before.
+*/
+int PhotoVisibility::priorityFor(const QRectF &rect, const QRectF &previous, const QRectF &viewport)
+{
+    const qreal away = distance(rect, viewport);
+    if (away == 0)
+        return 0;
+
+    const bool beside = rect.right() < viewport.left() || rect.left() > viewport.right();
+    const qreal screen = beside ? viewport.width() : viewport.height();
+    if (away > screen)
+        return PhotoProvider::Deferred;
+    if (previous.isValid() && away > distance(previous, viewport))
+        return PhotoProvider::Deferred;
+    return qMax(1, qRound(away));
+}
+
+// Manhattan distance from the viewport, 0 for rectangles that touch it
+qreal PhotoVisibility::distance(const QRectF &rect, const QRectF &viewport)
+{
+    const qreal dx = qMax(viewport.left() - rect.right(), rect.left() - viewport.right());
+    const qreal dy = qMax(viewport.top() - rect.bottom(), rect.top() - viewport.bottom());
+    return qMax<qreal>(dx, 0) + qMax<qreal>(dy, 0);
+}
+
+bool PhotoVisibility::isShown(const QQuickItem *item)
+{
+    if (!item->isVisible())
+        return false;
+    for (; item; item = item->parentItem()) {
+        if (item->opacity() == 0)
+            return false;
+    }
+    return true;
+}
+
+PhotoProvider *PhotoVisibility::provider() const
+{
+    QQmlEngine *engine = qmlEngine(this);
+    if (!engine || m_id.isEmpty())
+        return nullptr;
+    return dynamic_cast<PhotoProvider *>(engine->imageProvider(m_source.host()));
+}
+
+void PhotoVisibility::setPriority(int priority)
+{
+    if (m_priority == priority)
+        return;
+    m_priority = priority;
+    if (PhotoProvider *provider = this->provider())
+        provider->setPriority(m_id, this, m_priority);
+    emit priorityChanged();
+}
@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef PHOTOVISIBILITY_H
+#define PHOTOVISIBILITY_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QUrl>
+#include <QtQml>
+
+class PhotoProvider;
+
+class PhotoVisibility : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *target READ target WRITE setTarget NOTIFY targetChanged)
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int priority READ priority NOTIFY priorityChanged)
+
+public:
+    explicit PhotoVisibility(QObject *parent = nullptr);
+    ~PhotoVisibility() override;
+
+    QQuickItem *target() const;
+    void setTarget(QQuickItem *target);
+
+    QUrl source() const;
+    void setSource(const QUrl &source);
+
+    int priority() const;
+
+    static int priorityFor(const QRectF &rect, const QRectF &previous, const QRectF &viewport);
+
+signals:
+    void targetChanged();
+    void sourceChanged();
+    void priorityChanged();
+
+private slots:
+    void update();
+    void markMoved();
+    void watchAncestors();
+    void windowChanged(QQuickWindow *window);
+
+private:
+    static qreal distance(const QRectF &rect, const QRectF &viewport);
+    static bool isShown(const QQuickItem *item);
+    PhotoProvider *provider() const;
+    void setPriority(int priority);
+
+    QPointer<QQuickItem> m_target;
+    QUrl m_source;
+    QString m_id;
+    int m_priority;
+    QRectF m_previous;
+    bool m_moved;
+    QList<QMetaObject::Connection> m_windowConnections;
+    QList<QMetaObject::Connection> m_ancestorConnections;
+};
+
+#endif // PHOTOVISIBILITY_H
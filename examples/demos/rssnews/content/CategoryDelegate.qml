@@ -91,7 +91,7 @@ Rectangle {
         onClicked: {
             delegate.ListView.view.currentIndex = index
             if (window.currentFeed == feed)
-                feedModel.reload()
+                window.feedModel.reload()
             else
                 window.currentFeed = feed
         }
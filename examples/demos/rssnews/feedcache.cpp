@@ -0,0 +1,286 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "feedcache.h"
+
+/*
+Keeps an XmlListModel for each feed, created from the delegate. All feeds
+are loaded in the background, a few at a time, and each model then stays
+resident and refreshes itself, so switching between feeds does not wait
+for the network. Models that have not been used for the longest time are
+dropped when the feeds take more memory than allowed.
+*/
+FeedCache::FeedCache(QObject *parent) : QObject(parent)
+    , m_delegate(nullptr), m_maximumLoads(3), m_memoryLimit(16 * 1024 * 1024)
+    , m_memoryUsage(0), m_isComponentComplete(true), m_currentModel(nullptr)
+{
+}
+
+QList<QUrl> FeedCache::sources() const
+{
+    return m_sources;
+}
+
+void FeedCache::setSources(const QList<QUrl> &sources)
+{
+    if (m_sources == sources)
+        return;
+    m_sources = sources;
+    m_pendingPrefetches = sources;
+    prefetch();
+    Q_EMIT sourcesChanged();
+}
+
+QQmlComponent *FeedCache::delegate() const
+{
+    return m_delegate;
+}
+
+void FeedCache::setDelegate(QQmlComponent *delegate)
+{
+    if (m_delegate == delegate)
+        return;
+    m_delegate = delegate;
+    clear();
+    updateCurrentModel();
+    prefetch();
+    Q_EMIT delegateChanged();
+}
+
+int FeedCache::maximumLoads() const
+{
+    return m_maximumLoads;
+}
+
+void FeedCache::setMaximumLoads(int maximumLoads)
+{
+    maximumLoads = qMax(1, maximumLoads);
+    if (m_maximumLoads == maximumLoads)
+        return;
+    m_maximumLoads = maximumLoads;
+    prefetch();
+    Q_EMIT maximumLoadsChanged();
+}
+
+qint64 FeedCache::memoryLimit() const
+{
+    return m_memoryLimit;
+}
+
+void FeedCache::setMemoryLimit(qint64 memoryLimit)
+{
+    if (m_memoryLimit == memoryLimit)
+        return;
+    // Feeds that did not fit before are prefetched again when there is more room
+    if (memoryLimit > m_memoryLimit)
+        m_pendingPrefetches = m_sources;
+    m_memoryLimit = memoryLimit;
+    evict();
+    prefetch();
+    Q_EMIT memoryLimitChanged();
+}
+
+qint64 FeedCache::memoryUsage() const
+{
+    return m_memoryUsage;
+}
+
+QUrl FeedCache::currentSource() const
+{
+    return m_currentSource;
+}
+
+void FeedCache::setCurrentSource(const QUrl &currentSource)
+{
+    if (m_currentSource == currentSource)
+        return;
+    m_currentSource = currentSource;
+    updateCurrentModel();
+    Q_EMIT currentSourceChanged();
+}
+
+XmlListModel *FeedCache::currentModel() const
+{
+    return m_currentModel;
+}
+
+XmlListModel *FeedCache::model(const QUrl &source)
+{
+    if (!m_isComponentComplete || !m_delegate || source.isEmpty())
+        return nullptr;
+
+    m_recentlyUsed.removeOne(source);
+    m_recentlyUsed.prepend(source);
+
+    // A feed that is asked for is loaded right away, without waiting for
+    // the prefetches in progress.
+    XmlListModel *model = m_models.value(source);
+    if (!model)
+        model = createModel(source);
+    evict();
+    return model;
+}
+
+void FeedCache::classBegin()
+{
+    m_isComponentComplete = false;
+}
+
+void FeedCache::componentComplete()
+{
+    m_isComponentComplete = true;
+    updateCurrentModel();
+    prefetch();
+}
+
+XmlListModel *FeedCache::createModel(const QUrl &source)
+{
+    QObject *object = m_delegate->beginCreate(qmlContext(this));
+    XmlListModel *model = qobject_cast<XmlListModel *>(object);
+    if (!model) {
+        m_delegate->completeCreate();
+        delete object;
+        qmlWarning(this) << "FeedCache: the delegate must be an XmlListModel";
+        return nullptr;
+    }
+
+    // The source is set before the model is complete, so it loads only once
+    model->setParent(this);
+    model->setSource(source);
+    m_delegate->completeCreate();
+
+    connect(model, &XmlListModel::statusChanged, this, [this, model]() { modelChanged(model); });
+    connect(model, &XmlListModel::countChanged, this, [this, model]() { modelChanged(model); });
+    m_models.insert(source, model);
+    return model;
+}
+
+void FeedCache::modelChanged(XmlListModel *model)
+{
+    // The memory usage is brought up to date before more feeds are prefetched
+    const bool prefetched = model->status() != XmlListModel::Loading && m_prefetching.remove(model);
+    evict();
+    if (prefetched)
+        prefetch();
+}
+
+void FeedCache::prefetch()
+{
+    if (!m_isComponentComplete || !m_delegate)
+        return;
+
+    // Feeds that would not fit are loaded when they are asked for
+    while (m_prefetching.count() < m_maximumLoads && m_memoryUsage < m_memoryLimit
+           && !m_pendingPrefetches.isEmpty()) {
+        const QUrl source = m_pendingPrefetches.takeFirst();
+        if (m_models.contains(source))
+            continue;
+        XmlListModel *model = createModel(source);
+        if (!model)
+            return;
+        m_recentlyUsed.append(source);
+        if (model->status() == XmlListModel::Loading)
+            m_prefetching.insert(model);
+    }
+}
+
+void FeedCache::evict()
+{
+    // The feed that was asked for last is always kept, and so is the current
+    // one, even if other feeds were asked for since. Feeds that are still
+    // being prefetched are kept until they are done, or each one would be
+    // dropped before it has finished loading.
+    qint64 usage = 0;
+    for (const XmlListModel *model : qAsConst(m_models))
+        usage += model->memoryUsage();
+    for (int i = m_recentlyUsed.count() - 1; i > 0 && usage > m_memoryLimit; --i) {
+        const QUrl source = m_recentlyUsed.at(i);
+        XmlListModel *model = m_models.value(source);
+        if (source == m_currentSource || m_prefetching.contains(model))
+            continue;
+        m_recentlyUsed.removeAt(i);
+        m_models.remove(source);
+        if (!model)
+            continue;
+        usage -= model->memoryUsage();
+        model->deleteLater();
+
+        // The feeds that are left would only push out the ones loaded so far
+        m_pendingPrefetches.clear();
+    }
+
+    if (m_memoryUsage != usage) {
+        m_memoryUsage = usage;
+        Q_EMIT memoryUsageChanged();
+    }
+}
+
+void FeedCache::updateCurrentModel()
+{
+    XmlListModel *model = this->model(m_currentSource);
+    if (m_currentModel == model)
+        return;
+    m_currentModel = model;
+    Q_EMIT currentModelChanged();
+}
+
+void FeedCache::clear()
+{
+    for (XmlListModel *model : qAsConst(m_models))
+        model->deleteLater();
+    m_models.clear();
+    m_recentlyUsed.clear();
+    m_prefetching.clear();
+    m_pendingPrefetches = m_sources;
+    if (m_memoryUsage != 0) {
+        m_memoryUsage = 0;
+        Q_EMIT memoryUsageChanged();
+    }
+}
@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef FEEDCACHE_H
+#define FEEDCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QQmlComponent>
+#include <QQmlParserStatus>
+#include <QSet>
+#include <QUrl>
+#include <QtQml>
+
+#include "xmllistmodel.h"
+
+class FeedCache : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+
+    Q_PROPERTY(QList<QUrl> sources READ sources WRITE setSources NOTIFY sourcesChanged)
+    Q_PROPERTY(QQmlComponent *delegate READ delegate WRITE setDelegate NOTIFY delegateChanged)
+    Q_PROPERTY(int maximumLoads READ maximumLoads WRITE setMaximumLoads NOTIFY maximumLoadsChanged)
+    Q_PROPERTY(qint64 memoryLimit READ memoryLimit WRITE setMemoryLimit NOTIFY memoryLimitChanged)
+    Q_PROPERTY(qint64 memoryUsage READ memoryUsage NOTIFY memoryUsageChanged)
+    Q_PROPERTY(QUrl currentSource READ currentSource WRITE setCurrentSource NOTIFY currentSourceChanged)
+    Q_PROPERTY(XmlListModel *currentModel READ currentModel NOTIFY currentModelChanged)
+    Q_CLASSINFO("DefaultProperty", "delegate")
+    QML_ELEMENT
+
+public:
+    FeedCache(QObject *parent = nullptr);
+
+    QList<QUrl> sources() const;
+    void setSources(const QList<QUrl> &sources);
+
+    QQmlComponent *delegate() const;
+    void setDelegate(QQmlComponent *delegate);
+
+    int maximumLoads() const;
+    void setMaximumLoads(int maximumLoads);
+
+    qint64 memoryLimit() const;
+    void setMemoryLimit(qint64 memoryLimit);
+
+    qint64 memoryUsage() const;
+
+    QUrl currentSource() const;
+    void setCurrentSource(const QUrl &currentSource);
+
+    XmlListModel *currentModel() const;
+
+    Q_INVOKABLE XmlListModel *model(const QUrl &source);
+
+    void classBegin() override;
+    void componentComplete() override;
+
+Q_SIGNALS:
+    void sourcesChanged();
+    void delegateChanged();
+    void maximumLoadsChanged();
+    void memoryLimitChanged();
+    void memoryUsageChanged();
+    void currentSourceChanged();
+    void currentModelChanged();
+
+private:
+    XmlListModel *createModel(const QUrl &source);
+    void modelChanged(XmlListModel *model);
+    void prefetch();
+    void evict();
+    void clear();
+    void updateCurrentModel();
+
+    QList<QUrl> m_sources;
+    QQmlComponent *m_delegate;
+    int m_maximumLoads;
+    qint64 m_memoryLimit;
+    qint64 m_memoryUsage;
+    bool m_isComponentComplete;
+    QUrl m_currentSource;
+    XmlListModel *m_currentModel;
+
+    QHash<QUrl, XmlListModel *> m_models;
+    // Most recently used first; prefetched feeds join at the end
+    QList<QUrl> m_recentlyUsed;
+    QList<QUrl> m_pendingPrefetches;
+    QSet<XmlListModel *> m_prefetching;
+};
+
+#endif // FEEDCACHE_H
@@ -5,8 +5,10 @@ CONFIG += qmltypes
 
 INCLUDEPATH += ../shared
 
-HEADERS += ../shared/xmllistmodel.h
-SOURCES += main.cpp \
+HEADERS += feedcache.h \
+           ../shared/xmllistmodel.h
+SOURCES += feedcache.cpp \
+           main.cpp \
            ../shared/xmllistmodel.cpp
 
 QML_IMPORT_NAME = XmlListModel
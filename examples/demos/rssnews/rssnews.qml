@@ -60,29 +60,46 @@ Rectangle {
     height: 480
 
     property string currentFeed: rssFeeds.get(0).feed
-    property bool loading: feedModel.status === XmlListModel.Loading
+    property XmlListModel feedModel: feedCache.currentModel
+    property bool loading: feedModel !== null && feedModel.status === XmlListModel.Loading
     property bool isPortrait: Screen.primaryOrientation === Qt.PortraitOrientation
 
     onLoadingChanged: {
-        if (feedModel.status == XmlListModel.Ready)
+        if (feedModel !== null && feedModel.status == XmlListModel.Ready)
             list.positionViewAtBeginning()
     }
 
     RssFeeds { id: rssFeeds }
 
-    XmlListModel {
-        id: feedModel
+    FeedCache {
+        id: feedCache
 
-        source: "https://" + window.currentFeed
-        query: "/rss/channel/item"
-
-        roles:  [
-            XmlListModelRole { elementName: "title"; attributeName: ""},
-            XmlListModelRole { elementName: "description"; attributeName: ""},
-            XmlListModelRole { elementName: "content"; attributeName: "url" },
-            XmlListModelRole { elementName: "link"; attributeName: "" },
-            XmlListModelRole { elementName: "pubDate"; attributeName: "" }
-        ]
+        sources: {
+            var feeds = []
+            for (var i = 0; i < rssFeeds.count; ++i)
+                feeds.push("https://" + rssFeeds.get(i).feed)
+            return feeds
+        }
+        currentSource: "https://" + window.currentFeed
+        maximumLoads: 3
+        memoryLimit: 8 * 1024 * 1024
+
+        XmlListModel {
+            query: "/rss/channel/item"
+
+            roles:  [
+                XmlListModelRole { elementName: "title"; attributeName: ""},
+                XmlListModelRole { elementName: "description"; attributeName: ""},
+                XmlListModelRole { elementName: "content"; attributeName: "url" },
+                XmlListModelRole { elementName: "link"; attributeName: "" },
+                XmlListModelRole { elementName: "pubDate"; attributeName: "" }
+            ]
+            keyRole: "link"
+            persistentCache: true
+            refreshInterval: 5 * 60 * 1000
+            appendOnly: true
+            lazyDecoding: true
+        }
     }
 
     ListView {
@@ -118,7 +135,7 @@ Rectangle {
         anchors.leftMargin: 30
         anchors.rightMargin: 4
         clip: isPortrait
-        model: feedModel
+        model: window.feedModel
         footer: footerText
         delegate: NewsDelegate {}
     }
@@ -52,44 +52,81 @@
 
 #include <QQmlFile>
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QStandardPaths>
 #include <QCoreApplication>
 #include <QMutexLocker>
+#include <QCollator>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include <numeric>
 
 Q_DECLARE_METATYPE(XmlListModelQueryResult)
 
-QHash<QQmlEngine *, XmlListModelQueryEngine*> XmlListModelQueryEngine::queryEngines;
-QMutex XmlListModelQueryEngine::queryEnginesMutex;
+Q_LOGGING_CATEGORY(lcXmlListModel, "qt.examples.xmllistmodel")
 
-XmlListModelQueryThreadObject::XmlListModelQueryThreadObject(XmlListModelQueryEngine *e)
-    : m_queryEngine(e)
+static qint64 traceTime()
 {
+    // One clock for all threads, so that the phases of a query line up
+    static const QElapsedTimer clock = []() {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.nsecsElapsed();
 }
 
-void XmlListModelQueryThreadObject::processJobs()
+static void traceEvent(const char *phase, int queryId, qint64 start, qint64 end)
 {
-    QCoreApplication::postEvent(this, new QEvent(QEvent::User));
-}
+    // Every phase of a query is logged, and also written in the Chrome trace
+    // event format if XMLLISTMODEL_TRACE_FILE names a file to write to.
+    qCDebug(lcXmlListModel, "query %d: %s took %.3f ms", queryId, phase, (end - start) / 1e6);
+
+    static QFile *traceFile = []() -> QFile * {
+        const QString fileName = qEnvironmentVariable("XMLLISTMODEL_TRACE_FILE");
+        if (fileName.isEmpty())
+            return nullptr;
+        QFile *file = new QFile(fileName);
+        if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            delete file;
+            return nullptr;
+        }
+        file->write("[\n");
+        return file;
+    }();
+    if (!traceFile)
+        return;
 
-bool XmlListModelQueryThreadObject::event(QEvent *e)
-{
-    if (e->type() == QEvent::User) {
-        m_queryEngine->processJobs();
-        return true;
-    }
-    return QObject::event(e);
+    // Trace viewers accept the array without its closing bracket, so every
+    // event is complete on disk as soon as it has been written.
+    static QMutex traceMutex;
+    QMutexLocker ml(&traceMutex);
+    traceFile->write("{\"name\":\"" + QByteArray(phase) + "\",\"cat\":\"xmllistmodel\",\"ph\":\"X\""
+                     + ",\"ts\":" + QByteArray::number(start / 1e3, 'f', 3)
+                     + ",\"dur\":" + QByteArray::number((end - start) / 1e3, 'f', 3)
+                     + ",\"pid\":" + QByteArray::number(QCoreApplication::applicationPid())
+                     + ",\"tid\":" + QByteArray::number(quintptr(QThread::currentThreadId()))
+                     + ",\"args\":{\"query\":" + QByteArray::number(queryId) + "}},\n");
+    traceFile->flush();
 }
 
+QHash<QQmlEngine *, XmlListModelQueryEngine*> XmlListModelQueryEngine::queryEngines;
+QMutex XmlListModelQueryEngine::queryEnginesMutex;
+
 XmlListModelQueryEngine::XmlListModelQueryEngine(QQmlEngine *eng)
-: QThread(eng), m_threadObject(nullptr), m_queryIds(1), m_engine(eng), m_eventLoopQuitHack(nullptr)
+: QObject(eng), m_activeWorkers(0), m_busyWorkers(0), m_queryIds(1), m_engine(eng)
 {
     qRegisterMetaType<XmlListModelQueryResult>("XmlListModelQueryResult");
 
-    m_eventLoopQuitHack = new QObject;
-    m_eventLoopQuitHack->moveToThread(this);
-
-    connect(m_eventLoopQuitHack, &QObject::destroyed,
-        this, &QThread::quit, Qt::DirectConnection);
-    start(QThread::IdlePriority);
+    // One worker per core; a large document must not hold up the queries
+    // of other models.
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
 }
 
 XmlListModelQueryEngine::~XmlListModelQueryEngine()
@@ -98,28 +135,25 @@ XmlListModelQueryEngine::~XmlListModelQueryEngine()
     queryEngines.remove(m_engine);
     queryEnginesMutex.unlock();
 
-    m_eventLoopQuitHack->deleteLater();
-    wait();
+    {
+        QMutexLocker ml(&m_mutex);
+        for (const QSharedPointer<XmlListModelQueryJob> &job : qAsConst(m_jobs))
+            job->aborted.storeRelaxed(1);
+        m_jobs.clear();
+        m_pendingJobs.clear();
+    }
+    m_threadPool.waitForDone();
 }
 
 void XmlListModelQueryEngine::abort(int id)
 {
     QMutexLocker ml(&m_mutex);
-    if (id != -1)
-        m_cancelledJobs.insert(id);
-}
-
-void XmlListModelQueryEngine::run()
-{
-    m_mutex.lock();
-    m_threadObject = new XmlListModelQueryThreadObject(this);
-    m_mutex.unlock();
-
-    processJobs();
-    exec();
-
-    delete m_threadObject;
-    m_threadObject = nullptr;
+    if (id != -1) {
+        // A parse that is already running notices the flag within a few tokens
+        if (QSharedPointer<XmlListModelQueryJob> job = m_jobs.take(id))
+            job->aborted.storeRelaxed(1);
+        m_pendingJobs.removeAll(id);
+    }
 }
 
 XmlListModelQueryEngine *XmlListModelQueryEngine::instance(QQmlEngine *engine)
@@ -134,162 +168,1763 @@ XmlListModelQueryEngine *XmlListModelQueryEngine::instance(QQmlEngine *engine)
     return queryEng;
 }
 
-int XmlListModelQueryEngine::doQuery(QString query, QByteArray data, QList<XmlListModelRole *>* roles)
+bool XmlListModelQueryPlan::Predicate::matches(QStringView text) const
 {
-    {
-        QMutexLocker m1(&m_mutex);
-        m_queryIds.ref();
-        if (m_queryIds.loadRelaxed() <= 0)
-            m_queryIds.storeRelaxed(1);
+    switch (test) {
+    case Equals:
+        return text == value;
+    case NotEquals:
+        return text != value;
+    case Contains:
+        return text.contains(value);
     }
+    return false;
+}
 
-    XmlListModelQueryJob job;
-    job.queryId = m_queryIds.loadRelaxed();
-    job.data = data;
-    job.query = query;
+// Returns the index of the first separator outside of quoted literals and
+// brackets, or -1.
+static qsizetype indexOfSeparator(QStringView text, QChar separator, qsizetype from = 0)
+{
+    QChar quote;
+    int depth = 0;
+    for (qsizetype i = from; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (!quote.isNull()) {
+            if (c == quote)
+                quote = QChar();
+        } else if (c == QLatin1Char('\'') || c == QLatin1Char('"')) {
+            quote = c;
+        } else if (c == separator && depth == 0) {
+            return i;
+        } else if (c == QLatin1Char('[') || c == QLatin1Char('(')) {
+            ++depth;
+        } else if (c == QLatin1Char(']') || c == QLatin1Char(')')) {
+            --depth;
+        }
+    }
+    return -1;
+}
 
-    for (int i = 0; i < roles->count(); i++) {
-        if (!roles->at(i)->isValid()) {
-            job.roleNames << QString();
-            job.roleQueries << QString();
-            continue;
+static bool parseLiteral(QStringView text, QString *value)
+{
+    text = text.trimmed();
+    if (text.size() < 2 || (text.front() != QLatin1Char('\'') && text.front() != QLatin1Char('"'))
+            || text.back() != text.front()) {
+        return false;
+    }
+    *value = text.mid(1, text.size() - 2).toString();
+    return true;
+}
+
+static bool parseOperand(QStringView text, XmlListModelQueryPlan::Predicate *predicate)
+{
+    text = text.trimmed();
+    if (text.startsWith(QLatin1Char('@'))) {
+        predicate->attribute = text.mid(1).trimmed().toString();
+        return !predicate->attribute.isEmpty();
+    }
+    predicate->element.name = text.toString();
+    predicate->element.hash = qHash(QStringView(predicate->element.name));
+    return !text.isEmpty();
+}
+
+static bool parsePredicate(QStringView text, XmlListModelQueryPlan::Predicate *predicate)
+{
+    // child='value', @attribute!='value' or contains(child, 'value')
+    text = text.trimmed();
+    if (text.startsWith(QLatin1String("contains(")) && text.endsWith(QLatin1Char(')'))) {
+        const QStringView arguments = text.mid(9, text.size() - 10);
+        const qsizetype comma = indexOfSeparator(arguments, QLatin1Char(','));
+        predicate->test = XmlListModelQueryPlan::Predicate::Contains;
+        return comma != -1 && parseOperand(arguments.left(comma), predicate)
+                && parseLiteral(arguments.mid(comma + 1), &predicate->value);
+    }
+
+    const qsizetype equals = indexOfSeparator(text, QLatin1Char('='));
+    if (equals == -1)
+        return false;
+    const bool notEquals = equals > 0 && text.at(equals - 1) == QLatin1Char('!');
+    predicate->test = notEquals ? XmlListModelQueryPlan::Predicate::NotEquals
+                                : XmlListModelQueryPlan::Predicate::Equals;
+    return parseOperand(text.left(notEquals ? equals - 1 : equals), predicate)
+            && parseLiteral(text.mid(equals + 1), &predicate->value);
+}
+
+static bool parseStep(QStringView step, XmlListModelQueryPlan::Name *name, QList<QStringView> *predicates)
+{
+    qsizetype bracket = step.indexOf(QLatin1Char('['));
+    const QStringView elementName = (bracket == -1 ? step : step.left(bracket)).trimmed();
+    if (elementName.isEmpty())
+        return false;
+    name->name = elementName.toString();
+    name->hash = qHash(QStringView(name->name));
+
+    while (bracket != -1 && bracket < step.size()) {
+        if (step.at(bracket) != QLatin1Char('['))
+            return false;
+        const qsizetype end = indexOfSeparator(step, QLatin1Char(']'), bracket + 1);
+        if (end == -1)
+            return false;
+        predicates->append(step.mid(bracket + 1, end - bracket - 1));
+        bracket = end + 1;
+    }
+    return true;
+}
+
+QSharedPointer<const XmlListModelQueryPlan> XmlListModelQueryEngine::compileQuery(const QString &query, const QList<XmlListModelRole *> &roles)
+{
+    // Element names are matched by hash first, so the parser only compares
+    // strings for names that are likely to be equal.
+    QSharedPointer<XmlListModelQueryPlan> plan(new XmlListModelQueryPlan);
+
+    QList<QStringView> steps;
+    for (qsizetype start = 0; start <= query.size(); ) {
+        qsizetype end = indexOfSeparator(query, QLatin1Char('/'), start);
+        if (end == -1)
+            end = query.size();
+        const QStringView step = QStringView(query).mid(start, end - start);
+        if (!step.trimmed().isEmpty())
+            steps.append(step);
+        start = end + 1;
+    }
+
+    // Predicates select rows, so only the last step of the path may have them
+    for (int i = 0; i < steps.count() && plan->error.isEmpty(); ++i) {
+        XmlListModelQueryPlan::Name name;
+        QList<QStringView> predicates;
+        if (!parseStep(steps.at(i), &name, &predicates)) {
+            plan->error = QCoreApplication::translate("XmlListModel", "invalid query step: \"%1\"").arg(steps.at(i));
+        } else if (!predicates.isEmpty() && i != steps.count() - 1) {
+            plan->error = QCoreApplication::translate("XmlListModel", "predicates are only supported on the last step: \"%1\"").arg(steps.at(i));
+        }
+        for (QStringView text : qAsConst(predicates)) {
+            XmlListModelQueryPlan::Predicate predicate;
+            if (!parsePredicate(text, &predicate)) {
+                plan->error = QCoreApplication::translate("XmlListModel", "invalid predicate: \"%1\"").arg(text);
+                break;
+            }
+            plan->predicates.append(predicate);
         }
-        job.roleNames << roles->at(i)->elementName();
-        job.roleQueries << roles->at(i)->attributeName();
-        job.roleQueryErrorId << static_cast<void*>(roles->at(i));
+        plan->path.append(name);
+    }
+    if (!plan->error.isEmpty()) {
+        plan->path.clear();
+        plan->predicates.clear();
     }
 
-    {
-        QMutexLocker ml(&m_mutex);
-        m_jobs.append(job);
-        if (m_threadObject)
-            m_threadObject->processJobs();
+    for (XmlListModelRole *roleObject : roles) {
+        XmlListModelQueryPlan::Role role;
+        if (roleObject->isValid()) {
+            role.element.name = roleObject->elementName();
+            role.element.hash = qHash(QStringView(role.element.name));
+            role.attribute = roleObject->attributeName();
+            // Only links to JPEG images are of interest for href queries
+            role.jpegLinksOnly = role.attribute == QLatin1String("href");
+            role.errorId = static_cast<void*>(roleObject);
+        }
+        plan->roles.append(role);
     }
 
-    return job.queryId;
+    plan->signature = query.toUtf8();
+    for (const XmlListModelQueryPlan::Role &role : qAsConst(plan->roles))
+        plan->signature += '\n' + role.element.name.toUtf8() + '@' + role.attribute.toUtf8();
+
+    return plan;
+}
+
+int XmlListModelQueryEngine::doQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan, const QByteArray &data,
+                                     const XmlListModelQueryOptions &options)
+{
+    const int id = startQuery(plan, options);
+    appendData(id, data);
+    finishData(id);
+    return id;
+}
+
+int XmlListModelQueryEngine::doFileQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan, const QString &fileName,
+                                         const XmlListModelQueryOptions &options)
+{
+    // Opening, mapping and reading the file all happen on the worker, so
+    // the calling thread never blocks on the file system.
+    const int id = startQuery(plan, options);
+
+    QMutexLocker ml(&m_mutex);
+    QSharedPointer<XmlListModelQueryJob> job = m_jobs.value(id);
+    job->fileName = fileName;
+    job->lazy = options.lazyDecoding;
+    job->dataComplete = true;
+    scheduleJob(job);
+    return id;
+}
+
+int XmlListModelQueryEngine::nextQueryId()
+{
+    QMutexLocker m1(&m_mutex);
+    m_queryIds.ref();
+    if (m_queryIds.loadRelaxed() <= 0)
+        m_queryIds.storeRelaxed(1);
+    return m_queryIds.loadRelaxed();
+}
+
+int XmlListModelQueryEngine::startDocument()
+{
+    // A document job has no plan of its own; its data is parsed for the
+    // queries that joined it.
+    QSharedPointer<XmlListModelQueryJob> job(new XmlListModelQueryJob);
+    job->queryId = nextQueryId();
+
+    QMutexLocker ml(&m_mutex);
+    m_jobs.insert(job->queryId, job);
+    return job->queryId;
+}
+
+int XmlListModelQueryEngine::startQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan,
+                                        const XmlListModelQueryOptions &options, int documentId, bool *joined)
+{
+    QSharedPointer<XmlListModelQueryJob> job(new XmlListModelQueryJob);
+    job->queryId = nextQueryId();
+    job->plan = plan;
+    job->options = options;
+    job->rowLimit = options.limit < 0 ? -1 : options.offset + options.limit;
+    // A paused download keeps growing, so its values cannot be left in it
+    job->lazy = options.lazyDecoding && options.limit < 0;
+    job->row.resize(plan->roles.count());
+    job->rowSpans.resize(plan->roles.count());
+    job->internedValues.resize(plan->roles.count());
+    job->predicateResults.resize(plan->predicates.count());
+    job->rows = XmlListModelData(plan->roles.count());
+
+    QMutexLocker ml(&m_mutex);
+    m_jobs.insert(job->queryId, job);
+
+    // Queries can only share the pass over a document that has not begun.
+    // Paged queries stop reading at their limit, so they never share one.
+    QSharedPointer<XmlListModelQueryJob> document = m_jobs.value(documentId);
+    const bool share = document && !document->plan && !document->started && options.limit < 0;
+    if (share) {
+        job->document = document.data();
+        document->members.append(job);
+        document->lazy = document->lazy || job->lazy;
+    }
+    if (joined)
+        *joined = share;
+    return job->queryId;
+}
+
+#define XMLLISTMODEL_CACHE_MAGIC 0x584d4c43
+#define XMLLISTMODEL_CACHE_VERSION 2
+
+static bool readCache(const QString &fileName, const QByteArray &signature, XmlListModelQueryResult *result)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint16 version = 0;
+    QByteArray storedSignature;
+    stream >> magic >> version;
+    if (magic != XMLLISTMODEL_CACHE_MAGIC || version != XMLLISTMODEL_CACHE_VERSION)
+        return false;
+    stream >> storedSignature >> result->eTag >> result->lastModified;
+    if (storedSignature != signature || !result->data.read(stream))
+        return false;
+    stream >> result->documentOrder;
+    return stream.status() == QDataStream::Ok
+            && (result->documentOrder.isEmpty() || result->documentOrder.count() == result->data.count());
+}
+
+static void writeCache(const QString &fileName, const QByteArray &signature, const XmlListModelData &data,
+                       const QList<int> &documentOrder, const QByteArray &eTag, const QByteArray &lastModified)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << quint32(XMLLISTMODEL_CACHE_MAGIC) << quint16(XMLLISTMODEL_CACHE_VERSION);
+    stream << signature << eTag << lastModified;
+    data.write(stream);
+    stream << documentOrder;
+    if (stream.status() == QDataStream::Ok)
+        file.commit();
+}
+
+int XmlListModelQueryEngine::loadCache(const QString &fileName, const QSharedPointer<const XmlListModelQueryPlan> &plan)
+{
+    const int id = nextQueryId();
+    m_threadPool.start([this, id, fileName, plan]() {
+        XmlListModelQueryResult result;
+        result.queryId = id;
+        result.fromCache = readCache(fileName, plan->signature, &result);
+        if (!result.fromCache) {
+            result.eTag.clear();
+            result.lastModified.clear();
+        }
+        Q_EMIT cacheLoaded(result);
+    });
+    return id;
+}
+
+int XmlListModelQueryEngine::sortRows(const XmlListModelData &rows, const QList<int> &documentOrder,
+                                      int role, Qt::SortOrder order)
+{
+    // Rows are sorted from the document order, so that rows that compare
+    // equal keep that order whatever they were sorted by before. Without a
+    // role, they are only put back into it.
+    const int id = nextQueryId();
+    m_threadPool.start([this, id, rows, documentOrder, role, order]() {
+        QList<int> rowOf(rows.count());
+        if (documentOrder.isEmpty())
+            std::iota(rowOf.begin(), rowOf.end(), 0);
+        else for (int row = 0; row < documentOrder.count(); ++row)
+            rowOf[documentOrder.at(row)] = row;
+
+        XmlListModelQueryResult result;
+        result.queryId = id;
+        result.diffBase = rows;
+        if (role == -1) {
+            result.order = rowOf;
+        } else {
+            result.documentOrder = sortPermutation(documentOrder.isEmpty() ? rows : rows.reordered(rowOf), role, order);
+            result.order.reserve(rows.count());
+            for (int documentRow : qAsConst(result.documentOrder))
+                result.order.append(rowOf.at(documentRow));
+        }
+        result.data = rows.reordered(result.order);
+        result.reordered = true;
+        Q_EMIT queryCompleted(result);
+    });
+    return id;
+}
+
+enum XmlListModelSortKey { TextKey, Rfc2822DateKey, IsoDateKey, NumberKey };
+
+static XmlListModelSortKey sortKeyType(const QString &value)
+{
+    if (QDateTime::fromString(value, Qt::RFC2822Date).isValid())
+        return Rfc2822DateKey;
+    if (QDateTime::fromString(value, Qt::ISODate).isValid())
+        return IsoDateKey;
+    bool ok = false;
+    value.toDouble(&ok);
+    return ok ? NumberKey : TextKey;
+}
+
+static double numericSortKey(XmlListModelSortKey type, const QString &value)
+{
+    QDateTime dateTime;
+    switch (type) {
+    case Rfc2822DateKey:
+        dateTime = QDateTime::fromString(value, Qt::RFC2822Date);
+        break;
+    case IsoDateKey:
+        dateTime = QDateTime::fromString(value, Qt::ISODate);
+        break;
+    case NumberKey: {
+        bool ok = false;
+        const double number = value.toDouble(&ok);
+        return ok ? number : qQNaN();
+    }
+    case TextKey:
+        break;
+    }
+    return dateTime.isValid() ? double(dateTime.toMSecsSinceEpoch()) : qQNaN();
+}
+
+QList<int> XmlListModelQueryEngine::sortPermutation(const XmlListModelData &rows, int role, Qt::SortOrder order)
+{
+    // Each value is converted to a key once. Dates, such as the pubDate of
+    // RSS items, and numbers are compared as numbers; values that cannot be
+    // read like the first one go last. Anything else is compared as text.
+    QList<int> permutation(rows.count());
+    std::iota(permutation.begin(), permutation.end(), 0);
+
+    XmlListModelSortKey type = TextKey;
+    for (int row = 0; row < rows.count(); ++row) {
+        const QString value = rows.text(row, role).trimmed();
+        if (!value.isEmpty()) {
+            type = sortKeyType(value);
+            break;
+        }
+    }
+
+    if (type == TextKey) {
+        QCollator collator;
+        collator.setNumericMode(true);
+        QList<QCollatorSortKey> keys;
+        keys.reserve(rows.count());
+        for (int row = 0; row < rows.count(); ++row)
+            keys.append(collator.sortKey(rows.text(row, role)));
+        std::stable_sort(permutation.begin(), permutation.end(), [&keys, order](int a, int b) {
+            const int result = keys.at(a).compare(keys.at(b));
+            return order == Qt::AscendingOrder ? result < 0 : result > 0;
+        });
+        return permutation;
+    }
+
+    QList<double> keys;
+    keys.reserve(rows.count());
+    for (int row = 0; row < rows.count(); ++row)
+        keys.append(numericSortKey(type, rows.text(row, role).trimmed()));
+    std::stable_sort(permutation.begin(), permutation.end(), [&keys, order](int a, int b) {
+        const double keyA = keys.at(a);
+        const double keyB = keys.at(b);
+        if (qIsNaN(keyA) || qIsNaN(keyB))
+            return !qIsNaN(keyA) && qIsNaN(keyB);
+        return order == Qt::AscendingOrder ? keyA < keyB : keyA > keyB;
+    });
+    return permutation;
+}
+
+void XmlListModelQueryEngine::appendData(int id, const QByteArray &data)
+{
+    QMutexLocker ml(&m_mutex);
+    QSharedPointer<XmlListModelQueryJob> job = m_jobs.value(id);
+    if (!job || data.isEmpty())
+        return;
+
+    job->started = true;
+    job->data += data;
+    scheduleJob(job);
+}
+
+void XmlListModelQueryEngine::finishData(int id)
+{
+    QMutexLocker ml(&m_mutex);
+    QSharedPointer<XmlListModelQueryJob> job = m_jobs.value(id);
+    if (!job)
+        return;
+
+    job->started = true;
+    job->dataComplete = true;
+    scheduleJob(job);
+}
+
+void XmlListModelQueryEngine::fetchMore(int id, int count)
+{
+    // Resumes a paused query where its reader stopped
+    QMutexLocker ml(&m_mutex);
+    QSharedPointer<XmlListModelQueryJob> job = m_jobs.value(id);
+    if (!job || !job->paused)
+        return;
+
+    job->rowLimit += count;
+    job->paused = false;
+    scheduleJob(job);
+}
+
+void XmlListModelQueryEngine::scheduleJob(const QSharedPointer<XmlListModelQueryJob> &job)
+{
+    // m_mutex must be held by the caller. A running job is requeued by its
+    // worker once the current slice is done; a paused one keeps the data
+    // that arrives until it is resumed.
+    if (job->running || job->paused || m_pendingJobs.contains(job->queryId))
+        return;
+    m_pendingJobs.append(job->queryId);
+    job->queuedAt = traceTime();
+
+    const int idleWorkers = m_activeWorkers - m_busyWorkers;
+    if (idleWorkers < m_pendingJobs.count() && m_activeWorkers < m_threadPool.maxThreadCount()) {
+        ++m_activeWorkers;
+        m_threadPool.start([this]() { processJobs(); });
+    }
+}
+
+#define XMLLISTMODEL_PARSE_CHUNK_SIZE 65536
+
+static QByteArray readFileSlice(XmlListModelQueryJob *job, bool *atEnd)
+{
+    if (!job->file && !job->source) {
+        QScopedPointer<QFile> file(new QFile(job->fileName));
+        if (!file->open(QIODevice::ReadOnly)) {
+            *atEnd = true;
+            return QByteArray();
+        }
+        // Falls back to plain reads for files that cannot be mapped; their
+        // values are then all decoded while parsing.
+        const uchar *mappedData = file->size() > 0 ? file->map(0, file->size()) : nullptr;
+        if (mappedData) {
+            job->source.reset(new XmlListModelSource(file.take(), mappedData));
+        } else {
+            job->file.swap(file);
+            job->lazy = false;
+        }
+    }
+
+    if (job->source) {
+        // The reader copies each slice into its own buffer, so only one
+        // slice beyond the mapped pages is resident at a time.
+        const qint64 size = qMin<qint64>(XMLLISTMODEL_PARSE_CHUNK_SIZE, job->source->size() - job->fileOffset);
+        const QByteArray data = QByteArray::fromRawData(job->source->constData() + job->fileOffset, size);
+        job->fileOffset += size;
+        *atEnd = job->fileOffset >= job->source->size();
+        return data;
+    }
+
+    const QByteArray data = job->file->read(XMLLISTMODEL_PARSE_CHUNK_SIZE);
+    *atEnd = data.isEmpty() || job->file->atEnd();
+    return data;
+}
+
+static XmlListModelQueryJob *documentOf(XmlListModelQueryJob *job)
+{
+    // Queries that share a download are parsed by the job of the document
+    return job->document ? job->document : job;
 }
 
 void XmlListModelQueryEngine::processJobs()
 {
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+
     QMutexLocker locker(&m_mutex);
 
-    while (true) {
-        if (m_jobs.isEmpty())
-            return;
+    // Jobs are served round robin, one slice of input at a time, so that
+    // every model makes progress while several of them are loading.
+    while (!m_pendingJobs.isEmpty()) {
+        QSharedPointer<XmlListModelQueryJob> currentJob = m_jobs.value(m_pendingJobs.takeFirst());
+        if (!currentJob)
+            continue;
+
+        if (currentJob->queuedAt >= 0) {
+            const qint64 now = traceTime();
+            currentJob->stats.queueWait += now - currentJob->queuedAt;
+            traceEvent("queued", currentJob->queryId, currentJob->queuedAt, now);
+            currentJob->queuedAt = -1;
+        }
 
-        XmlListModelQueryJob currentJob = m_jobs.takeLast();
-        while (m_cancelledJobs.remove(currentJob.queryId)) {
-            if (m_jobs.isEmpty())
-              return;
-            currentJob = m_jobs.takeLast();
+        const bool fileSource = !currentJob->fileName.isEmpty();
+        QByteArray data;
+        bool lastSlice = false;
+        if (!fileSource) {
+            data = currentJob->data.mid(currentJob->dataOffset, XMLLISTMODEL_PARSE_CHUNK_SIZE);
+            currentJob->dataOffset += data.size();
+            if (currentJob->dataOffset >= currentJob->data.size()) {
+                currentJob->data.clear();
+                currentJob->dataOffset = 0;
+            }
+            lastSlice = currentJob->dataComplete && currentJob->data.isEmpty();
         }
+        currentJob->running = true;
+        ++m_busyWorkers;
 
         locker.unlock();
-        processQuery(&currentJob);
+        if (fileSource)
+            data = readFileSlice(currentJob.data(), &lastSlice);
+        if (currentJob->plan)
+            processQuery(currentJob, data, lastSlice);
+        else
+            processDocument(currentJob, data, lastSlice);
         locker.relock();
+
+        --m_busyWorkers;
+        currentJob->running = false;
+        if (m_jobs.value(currentJob->queryId) == currentJob && !currentJob->paused
+                && (!currentJob->data.isEmpty() || currentJob->dataComplete)) {
+            m_pendingJobs.append(currentJob->queryId);
+            currentJob->queuedAt = traceTime();
+        }
     }
+
+    --m_activeWorkers;
+}
+
+static void retainData(XmlListModelQueryJob *job, const QByteArray &data, bool dataComplete)
+{
+    // Downloads decoded lazily are kept for the values left in them. Rows
+    // refer to the document while it still grows, so they are published as
+    // they are parsed.
+    if (!job->source)
+        job->source.reset(new XmlListModelSource);
+    job->source->append(data);
+    if (dataComplete)
+        job->source->squeeze();
+}
+
+static void attachSource(XmlListModelQueryJob *job, XmlListModelData *rows)
+{
+    // Rows only keep the document if some of their values were left in it.
+    // Queries on a shared download use the document of its job.
+    if (rows->hasDeferredValues())
+        rows->setSource(documentOf(job)->source);
 }
 
-void XmlListModelQueryEngine::processQuery(XmlListModelQueryJob *job)
+void XmlListModelQueryEngine::processQuery(const QSharedPointer<XmlListModelQueryJob> &job, const QByteArray &data, bool dataComplete)
 {
     XmlListModelQueryResult result;
     result.queryId = job->queryId;
-    doQueryJob(job, &result);
+    result.data = XmlListModelData(job->plan->roles.count());
+
+    // A resumed query first parses what its reader still holds
+    const qint64 start = traceTime();
+    if (!data.isEmpty()) {
+        if (job->lazy && job->fileName.isEmpty())
+            retainData(job.data(), data, dataComplete);
+        job->reader.addData(data);
+        job->stats.bytes += data.size();
+    }
+    const bool finished = doQueryJob(job.data(), &result);
+    const qint64 end = traceTime();
+    job->stats.parseTime += end - start;
+    traceEvent("parse", job->queryId, start, end);
+    finishSlice(job, &result, finished, dataComplete);
+}
 
-    QMutexLocker ml(&m_mutex);
-    if (m_cancelledJobs.contains(job->queryId)) {
-        m_cancelledJobs.remove(job->queryId);
+void XmlListModelQueryEngine::processDocument(const QSharedPointer<XmlListModelQueryJob> &document, const QByteArray &data, bool dataComplete)
+{
+    // Every query that shares the download is evaluated in the same pass
+    // over it, so the document is read only once whatever their number.
+    const qint64 start = traceTime();
+    if (!data.isEmpty()) {
+        if (document->lazy)
+            retainData(document.data(), data, dataComplete);
+        document->reader.addData(data);
+        document->stats.bytes += data.size();
+    }
+
+    QList<XmlListModelQueryResult> results(document->members.count());
+    for (int i = 0; i < document->members.count(); ++i) {
+        results[i].queryId = document->members.at(i)->queryId;
+        results[i].data = XmlListModelData(document->members.at(i)->plan->roles.count());
+    }
+    const bool finished = doDocumentJob(document.data(), &results);
+    const qint64 end = traceTime();
+    document->stats.parseTime += end - start;
+    traceEvent("parse", document->queryId, start, end);
+
+    // Each query is charged with the whole of the pass it shares
+    for (int i = document->members.count() - 1; i >= 0; --i) {
+        const QSharedPointer<XmlListModelQueryJob> member = document->members.at(i);
+        member->stats.bytes = document->stats.bytes;
+        member->stats.queueWait = document->stats.queueWait;
+        member->stats.parseTime = document->stats.parseTime;
+        finishSlice(member, &results[i], finished || member->stopped, dataComplete);
+        if (member->aborted.loadRelaxed() || member->stopped)
+            document->members.removeAt(i);
+    }
+
+    if (finished) {
+        QMutexLocker ml(&m_mutex);
+        if (m_jobs.value(document->queryId) == document)
+            m_jobs.remove(document->queryId);
+        m_pendingJobs.removeAll(document->queryId);
+    }
+}
+
+void XmlListModelQueryEngine::finishSlice(const QSharedPointer<XmlListModelQueryJob> &job, XmlListModelQueryResult *currentResult,
+                                          bool finished, bool dataComplete)
+{
+    if (job->aborted.loadRelaxed())
+        return;
+
+    XmlListModelQueryResult &result = *currentResult;
+    // A first load has no rows to diff against, so its rows are streamed
+    // like those of any other query; only reloads are buffered and diffed.
+    const bool diffing = job->options.keyRole != -1 && !job->options.previousData.isEmpty();
+    const bool sorting = job->options.sortRole != -1;
+    const bool appendOnly = !job->options.knownKeys.isEmpty();
+    const bool caching = !job->options.cacheFile.isEmpty();
+
+    // Pages of no rows never have a next one, or fetchMore() would not end
+    const bool pageComplete = !finished && job->options.limit > 0 && job->matchedRows >= job->rowLimit;
+    const bool done = finished || (dataComplete && !pageComplete);
+    attachSource(job.data(), &result.data);
+    QList<int> documentOrder;
+    if (diffing || appendOnly || sorting || caching) {
+        job->rows.append(result.data);
+        // Sorted once, after the last row; the model never sees the rows unsorted
+        if (done && sorting) {
+            documentOrder = sortPermutation(job->rows, job->options.sortRole, job->options.sortOrder);
+            job->rows = job->rows.reordered(documentOrder);
+        }
+    }
+
+    if (appendOnly) {
+        // The new entries are inserted in front of the current rows at once
+        if (!done)
+            return;
+
+        XmlListModelQueryResult appendResult;
+        appendResult.queryId = job->queryId;
+        appendResult.data = job->rows;
+        appendResult.prepend = true;
+        publishResult(job, appendResult, true);
+    } else if (diffing) {
+        // Keyed reloads are applied to the model as a single diff against
+        // the rows it had when the query was started.
+        if (!done)
+            return;
+
+        XmlListModelQueryResult keyedResult;
+        keyedResult.queryId = job->queryId;
+        keyedResult.data = job->rows;
+        keyedResult.diffBase = job->options.previousData;
+        keyedResult.keyed = diffRows(keyedResult.diffBase, keyedResult.data, job->options.keyRole, &keyedResult.diff);
+        keyedResult.documentOrder = documentOrder;
+        publishResult(job, keyedResult, true);
+    } else if (sorting) {
+        if (!done)
+            return;
+
+        result.data = job->rows;
+        result.documentOrder = documentOrder;
+        publishResult(job, result, true);
     } else {
-        ml.unlock();
+        // Rows that are only kept for the cache are streamed all the same
+        result.hasMore = !done && pageComplete;
+        if (done || result.hasMore)
+            publishResult(job, result, true);
+        else if (!result.data.isEmpty())
+            publishResult(job, result, false);
+    }
+
+    // Only documents that were read completely and without errors are cached
+    if (done && caching && !documentOf(job.data())->reader.hasError()) {
+        writeCache(job->options.cacheFile, job->plan->signature, job->rows, documentOrder,
+                   job->options.eTag, job->options.lastModified);
+    }
+}
+
+static void appendDiffOp(QList<XmlListModelDiffOp> *diff, XmlListModelDiffOp::Type type, int first, int last, int destination = -1)
+{
+    XmlListModelDiffOp op;
+    op.type = type;
+    op.first = first;
+    op.last = last;
+    op.destination = destination;
+    diff->append(op);
+}
+
+// Rows in slots, as a Fenwick tree: each change and count takes O(log n)
+static void addToSlot(QList<int> *tree, int slot, int delta)
+{
+    for (int i = slot + 1; i < tree->count(); i += i & -i)
+        (*tree)[i] += delta;
+}
+
+static int countBeforeSlot(const QList<int> &tree, int slot)
+{
+    int count = 0;
+    for (int i = slot; i > 0; i -= i & -i)
+        count += tree.at(i);
+    return count;
+}
+
+// Finds the indexes of a longest strictly increasing subsequence of positions
+static QList<bool> longestIncreasingSubsequence(const QList<int> &positions)
+{
+    QList<int> tails;       // index of the smallest tail of each subsequence length
+    QList<int> previous(positions.count(), -1);
+    for (int i = 0; i < positions.count(); ++i) {
+        int lo = 0;
+        int hi = tails.count();
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (positions.at(tails.at(mid)) < positions.at(i))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > 0)
+            previous[i] = tails.at(lo - 1);
+        if (lo == tails.count())
+            tails.append(i);
+        else
+            tails[lo] = i;
+    }
+
+    QList<bool> result(positions.count(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = previous.at(i))
+        result[i] = true;
+    return result;
+}
+
+bool XmlListModelQueryEngine::diffRows(const XmlListModelData &oldRows, const XmlListModelData &newRows, int keyRole, QList<XmlListModelDiffOp> *diff)
+{
+    // Computes the removals, moves, insertions and changes that turn oldRows
+    // into newRows. The structural operations are meant to be applied in
+    // order; Change ranges refer to rows of newRows. Returns false if the
+    // key is not unique, in which case the model is reset instead.
+    QHash<QString, int> oldIndex;
+    for (int i = 0; i < oldRows.count(); ++i) {
+        const QString key = oldRows.value(i, keyRole);
+        if (oldIndex.contains(key))
+            return false;
+        oldIndex.insert(key, i);
+    }
+    QHash<QString, int> newIndex;
+    for (int i = 0; i < newRows.count(); ++i) {
+        const QString key = newRows.value(i, keyRole);
+        if (newIndex.contains(key))
+            return false;
+        newIndex.insert(key, i);
+    }
+
+    // Removals, back to front so that the indexes stay valid
+    QStringList current;
+    for (int i = oldRows.count() - 1; i >= 0; ) {
+        if (newIndex.contains(oldRows.value(i, keyRole))) {
+            --i;
+            continue;
+        }
+        const int last = i;
+        while (i >= 0 && !newIndex.contains(oldRows.value(i, keyRole)))
+            --i;
+        appendDiffOp(diff, XmlListModelDiffOp::Remove, i + 1, last);
+    }
+    for (int i = 0; i < oldRows.count(); ++i) {
+        const QString key = oldRows.value(i, keyRole);
+        if (newIndex.contains(key))
+            current.append(key);
+    }
+
+    // Moves: rows on a longest increasing subsequence keep their place, every
+    // other row is moved right behind its new predecessor.
+    QList<int> positions;
+    QHash<QString, int> currentIndex;
+    for (int i = 0; i < current.count(); ++i)
+        currentIndex.insert(current.at(i), i);
+    for (int i = 0; i < newRows.count(); ++i) {
+        const auto it = currentIndex.constFind(newRows.value(i, keyRole));
+        if (it != currentIndex.constEnd())
+            positions.append(it.value());
+    }
+    const QList<bool> stays = longestIncreasingSubsequence(positions);
+
+    // A moved row ends up in a run right behind the last row before it that
+    // stays, or in front of all rows. Each row thus has a slot of its own:
+    // its current place, or its place in a run. Counting the rows in the
+    // slots before it gives the index of a row at any point.
+    QList<int> anchors(positions.count(), -1);
+    QList<int> runOffsets(positions.count(), 0);
+    QList<int> runLengths(current.count() + 1, 0);
+    for (int i = 0, anchor = -1; i < positions.count(); ++i) {
+        if (stays.at(i)) {
+            anchor = positions.at(i);
+        } else {
+            anchors[i] = anchor;
+            runOffsets[i] = ++runLengths[anchor + 1];
+        }
+    }
+    QList<int> firstSlots(current.count() + 1);
+    int slotCount = 0;
+    for (int anchor = -1; anchor < current.count(); ++anchor) {
+        firstSlots[anchor + 1] = slotCount;
+        slotCount += 1 + runLengths.at(anchor + 1);
+    }
+    QList<int> occupied(slotCount + 1, 0);
+    for (int row = 0; row < current.count(); ++row)
+        addToSlot(&occupied, firstSlots.at(row + 1), 1);
+
+    for (int i = 0; i < positions.count(); ++i) {
+        if (stays.at(i))
+            continue;
+        const int fromSlot = firstSlots.at(positions.at(i) + 1);
+        const int from = countBeforeSlot(occupied, fromSlot);
+        addToSlot(&occupied, fromSlot, -1);
+        const int toSlot = firstSlots.at(anchors.at(i) + 1) + runOffsets.at(i);
+        const int to = countBeforeSlot(occupied, toSlot);
+        addToSlot(&occupied, toSlot, 1);
+        if (from != to)
+            appendDiffOp(diff, XmlListModelDiffOp::Move, from, from, to);
+    }
+
+    // Insertions, front to back
+    for (int i = 0; i < newRows.count(); ) {
+        if (oldIndex.contains(newRows.value(i, keyRole))) {
+            ++i;
+            continue;
+        }
+        const int first = i;
+        while (i < newRows.count() && !oldIndex.contains(newRows.value(i, keyRole)))
+            ++i;
+        appendDiffOp(diff, XmlListModelDiffOp::Insert, first, i - 1);
+    }
+
+    // Changed contents of rows that were kept
+    for (int i = 0; i < newRows.count(); ) {
+        const int oldRow = oldIndex.value(newRows.value(i, keyRole), -1);
+        if (oldRow == -1 || oldRows.rowEquals(oldRow, newRows, i)) {
+            ++i;
+            continue;
+        }
+        const int first = i;
+        for (++i; i < newRows.count(); ++i) {
+            const int row = oldIndex.value(newRows.value(i, keyRole), -1);
+            if (row == -1 || oldRows.rowEquals(row, newRows, i))
+                break;
+        }
+        appendDiffOp(diff, XmlListModelDiffOp::Change, first, i - 1);
+    }
+
+    return true;
+}
+
+void XmlListModelQueryEngine::publishResult(const QSharedPointer<XmlListModelQueryJob> &job, XmlListModelQueryResult result, bool finished)
+{
+    job->stats.rows = qMax(0, job->matchedRows - job->options.offset);
+    result.stats = job->stats;
+
+    QMutexLocker ml(&m_mutex);
+    if (m_jobs.value(job->queryId) != job)
+        return; // aborted
+
+    // A paused query stays, to be resumed by fetchMore()
+    if (result.hasMore) {
+        job->paused = true;
+        m_pendingJobs.removeAll(job->queryId);
+    } else if (finished) {
+        m_jobs.remove(job->queryId);
+        m_pendingJobs.removeAll(job->queryId);
+    }
+    ml.unlock();
+
+    if (finished)
         Q_EMIT queryCompleted(result);
+    else
+        Q_EMIT rowsAvailable(result);
+}
+
+#define XMLLISTMODEL_MAX_EAGER_LENGTH 256
+
+static bool canDeferValues(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader)
+{
+    // Offsets are mapped to the source assuming UTF-8, which is what feeds
+    // without an encoding declaration or byte order mark use.
+    if (currentJob->lazy && !currentJob->encodingChecked) {
+        currentJob->encodingChecked = true;
+        const XmlListModelSource *source = documentOf(currentJob)->source.data();
+        const char *bytes = source ? source->constData() : nullptr;
+        const qint64 size = source ? source->size() : 0;
+        const QStringView encoding = reader.documentEncoding();
+        if (!encoding.isEmpty() && encoding.compare(QLatin1String("UTF-8"), Qt::CaseInsensitive) != 0)
+            currentJob->lazy = false;
+        else if (size >= 2 && (bytes[0] == '\0' || bytes[1] == '\0' || uchar(bytes[0]) == 0xfe || uchar(bytes[0]) == 0xff))
+            currentJob->lazy = false;
+        else if (size >= 3 && uchar(bytes[0]) == 0xef && uchar(bytes[1]) == 0xbb && uchar(bytes[2]) == 0xbf)
+            currentJob->scannedBytes = 3;
     }
+    return currentJob->lazy;
 }
 
-void XmlListModelQueryEngine::doQueryJob(XmlListModelQueryJob *currentJob, XmlListModelQueryResult *currentResult)
+static qint64 byteOffset(XmlListModelQueryJob *currentJob, qint64 characterOffset)
+{
+    // Offsets are asked for in increasing order, so the source is only
+    // walked once. Four-byte sequences are two UTF-16 characters.
+    const XmlListModelSource *source = documentOf(currentJob)->source.data();
+    const char *bytes = source ? source->constData() : nullptr;
+    const qint64 size = source ? source->size() : 0;
+    while (currentJob->scannedCharacters < characterOffset && currentJob->scannedBytes < size) {
+        const uchar c = uchar(bytes[currentJob->scannedBytes]);
+        const int length = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+        currentJob->scannedBytes += length;
+        currentJob->scannedCharacters += length == 4 ? 2 : 1;
+    }
+    return qMin(currentJob->scannedBytes, size);
+}
+
+bool XmlListModelQueryEngine::doQueryJob(XmlListModelQueryJob *currentJob, XmlListModelQueryResult *currentResult)
 {
     Q_ASSERT(currentJob->queryId != -1);
 
-    QByteArray data(currentJob->data);
-    QXmlStreamReader reader;
-    reader.addData(data);
+    // Returns true once the document has been fully parsed or turned out to be
+    // malformed. Running out of data just suspends parsing until more arrives.
+    // A limit of 0 asks for no rows, so nothing needs to be read.
+    QXmlStreamReader &reader = currentJob->reader;
+    if (currentJob->plan->path.isEmpty() || currentJob->options.limit == 0)
+        return true;
+
+    while (!reader.atEnd()) {
+        if (currentJob->aborted.loadRelaxed())
+            return true;
+
+        reader.readNext();
+        switch (processToken(currentJob, reader, currentResult)) {
+        case ContinueParsing:
+            break;
+        case StopParsing:
+            return true;
+        case PauseParsing:
+            return false;
+        }
+    }
 
-    QStringList items = currentJob->query.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    return reader.hasError() && reader.error() != QXmlStreamReader::PrematureEndOfDocumentError;
+}
+
+bool XmlListModelQueryEngine::doDocumentJob(XmlListModelQueryJob *document, QList<XmlListModelQueryResult> *results)
+{
+    // Like doQueryJob(), for all queries on the document at once. A query
+    // that needs no more of it drops out; the pass ends with the last one.
+    QXmlStreamReader &reader = document->reader;
+    for (const QSharedPointer<XmlListModelQueryJob> &member : qAsConst(document->members)) {
+        if (member->plan->path.isEmpty())
+            member->stopped = true;
+    }
 
     while (!reader.atEnd()) {
-        int i = 0;
-        while (i < items.count()) {
-            if (reader.readNextStartElement()) {
-                if (reader.name() == items.at(i)) {
-                    if (i != items.count() - 1) {
-                        i++;
-                        continue;
-                    } else {
-                        processElement(currentJob, currentResult, items.at(i), reader);
-                    }
-                } else {
-                    reader.skipCurrentElement();
+        if (document->aborted.loadRelaxed())
+            return true;
+
+        reader.readNext();
+        bool active = false;
+        for (int i = 0; i < document->members.count(); ++i) {
+            XmlListModelQueryJob *member = document->members.at(i).data();
+            if (member->stopped || member->aborted.loadRelaxed())
+                continue;
+            if (processToken(member, reader, &(*results)[i]) == StopParsing)
+                member->stopped = true;
+            else
+                active = true;
+        }
+        if (!active)
+            return true;
+    }
+
+    return reader.hasError() && reader.error() != QXmlStreamReader::PrematureEndOfDocumentError;
+}
+
+XmlListModelQueryEngine::TokenResult XmlListModelQueryEngine::processToken(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader,
+                                                                           XmlListModelQueryResult *currentResult)
+{
+    const QList<XmlListModelQueryPlan::Name> &path = currentJob->plan->path;
+    const int rowDepth = path.count();
+
+    switch (reader.tokenType()) {
+    case QXmlStreamReader::StartElement:
+        ++currentJob->depth;
+        if (currentJob->matchedDepth == rowDepth) {
+            if (currentJob->depth == rowDepth + 1 && currentJob->roleIndex == -1
+                    && currentJob->predicateIndex == -1 && !currentJob->rowRejected) {
+                processElement(currentJob, reader);
+            }
+        } else if (currentJob->depth == currentJob->matchedDepth + 1
+                   && path.at(currentJob->matchedDepth).matches(reader.name(), qHash(reader.name()))) {
+            ++currentJob->matchedDepth;
+            if (currentJob->matchedDepth == rowDepth)
+                beginRow(currentJob, reader);
+        }
+        break;
+    case QXmlStreamReader::Characters:
+    case QXmlStreamReader::EntityReference:
+        if (currentJob->predicateIndex != -1)
+            currentJob->predicateText += reader.text();
+        if (currentJob->roleIndex != -1 && !currentJob->roleDeferred) {
+            // Long values are not copied; only their place in the source is kept
+            if (currentJob->roleText.size() + reader.text().size() > XMLLISTMODEL_MAX_EAGER_LENGTH
+                    && currentJob->roleIndex != currentJob->options.keyRole
+                    && currentJob->roleIndex != currentJob->options.sortRole
+                    && canDeferValues(currentJob, reader)) {
+                currentJob->roleDeferred = true;
+                currentJob->roleText.clear();
+            } else {
+                currentJob->roleText += reader.text();
+            }
+        }
+        break;
+    case QXmlStreamReader::EndElement:
+        if (currentJob->roleIndex != -1 && currentJob->depth == rowDepth + 1) {
+            if (currentJob->roleDeferred)
+                deferRoleValue(currentJob, currentJob->roleIndex);
+            else
+                storeRoleValue(currentJob, currentJob->roleIndex, currentJob->roleText);
+            currentJob->roleIndex = -1;
+            currentJob->roleDeferred = false;
+            currentJob->roleText.clear();
+        }
+        if (currentJob->predicateIndex != -1 && currentJob->depth == rowDepth + 1) {
+            // Every test of this element holds if any of its occurrences passes it
+            const QList<XmlListModelQueryPlan::Predicate> &predicates = currentJob->plan->predicates;
+            const XmlListModelQueryPlan::Name &element = predicates.at(currentJob->predicateIndex).element;
+            for (int i = currentJob->predicateIndex; i < predicates.count(); ++i) {
+                if (predicates.at(i).element.matches(element.name, element.hash)
+                        && predicates.at(i).matches(currentJob->predicateText)) {
+                    currentJob->predicateResults[i] = true;
                 }
             }
-            if (reader.tokenType() == QXmlStreamReader::Invalid) {
-                reader.readNext();
-                break;
+            currentJob->predicateIndex = -1;
+            currentJob->predicateText.clear();
+        }
+        if (currentJob->depth == currentJob->matchedDepth) {
+            if (currentJob->matchedDepth == rowDepth && endRow(currentJob)) {
+                // Rows that are already in the model are skipped, wherever
+                // they are in the feed, and so are repeated new entries.
+                bool known = false;
+                if (!currentJob->options.knownKeys.isEmpty()) {
+                    const QString &key = currentJob->row.at(currentJob->options.keyRole);
+                    known = currentJob->options.knownKeys.contains(key);
+                    if (!known)
+                        currentJob->options.knownKeys.insert(key);
+                }
+                if (++currentJob->matchedRows > currentJob->options.offset && !known) {
+                    internRowValues(currentJob);
+                    currentResult->data.appendRow(currentJob->row, currentJob->rowSpans);
+                }
+                currentJob->row.fill(QString());
+                currentJob->rowSpans.fill(XmlListModelSpan());
             }
-            else if (reader.hasError()) {
-                reader.raiseError();
-                break;
+            --currentJob->matchedDepth;
+        }
+        --currentJob->depth;
+
+        // The rest of the document is only read if more rows are fetched
+        if (currentJob->rowLimit >= 0 && currentJob->matchedRows >= currentJob->rowLimit)
+            return PauseParsing;
+        break;
+    default:
+        break;
+    }
+
+    // The content of a role ends where the token before its end tag ends
+    if (currentJob->lazy && currentJob->roleIndex != -1)
+        currentJob->roleEnd = reader.characterOffset();
+    return ContinueParsing;
+}
+
+#define XMLLISTMODEL_MAX_INTERNED_LENGTH 64
+
+void XmlListModelQueryEngine::storeRoleValue(XmlListModelQueryJob *currentJob, int index, const QString &value)
+{
+    currentJob->row[index] = value;
+}
+
+void XmlListModelQueryEngine::internRowValues(XmlListModelQueryJob *currentJob)
+{
+    // Short values that repeat across rows, such as categories or authors,
+    // share a single copy. Only rows that passed the predicates get here, so
+    // values of rejected rows are never kept.
+    for (int index = 0; index < currentJob->row.count(); ++index) {
+        QString &stored = currentJob->row[index];
+        if (stored.isEmpty() || stored.size() > XMLLISTMODEL_MAX_INTERNED_LENGTH)
+            continue;
+
+        QSet<QString> &interned = currentJob->internedValues[index];
+        const auto it = interned.constFind(stored);
+        if (it != interned.constEnd())
+            stored = *it;
+        else
+            interned.insert(stored);
+    }
+}
+
+void XmlListModelQueryEngine::deferRoleValue(XmlListModelQueryJob *currentJob, int index)
+{
+    XmlListModelSpan &span = currentJob->rowSpans[index];
+    span.offset = byteOffset(currentJob, currentJob->roleStart);
+    span.length = byteOffset(currentJob, currentJob->roleEnd) - span.offset;
+    currentJob->row[index] = QString();
+}
+
+void XmlListModelQueryEngine::beginRow(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader)
+{
+    currentJob->row.fill(QString());
+    currentJob->rowSpans.fill(XmlListModelSpan());
+    currentJob->predicateResults.fill(false);
+    currentJob->rowRejected = false;
+
+    // Attributes of the row are tested right away, so that a rejected row is
+    // skipped without collecting any of its values.
+    const QList<XmlListModelQueryPlan::Predicate> &predicates = currentJob->plan->predicates;
+    if (predicates.isEmpty())
+        return;
+    const QXmlStreamAttributes attributes = reader.attributes();
+    for (const XmlListModelQueryPlan::Predicate &predicate : predicates) {
+        if (predicate.isAttributeTest() && (!attributes.hasAttribute(predicate.attribute)
+                                            || !predicate.matches(attributes.value(predicate.attribute)))) {
+            currentJob->rowRejected = true;
+            return;
+        }
+    }
+}
+
+bool XmlListModelQueryEngine::endRow(XmlListModelQueryJob *currentJob)
+{
+    // Returns whether the row passed all predicates
+    if (currentJob->rowRejected)
+        return false;
+    const QList<XmlListModelQueryPlan::Predicate> &predicates = currentJob->plan->predicates;
+    for (int i = 0; i < predicates.count(); ++i) {
+        if (!predicates.at(i).isAttributeTest() && !currentJob->predicateResults.at(i))
+            return false;
+    }
+    return true;
+}
+
+void XmlListModelQueryEngine::processElement(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader)
+{
+    const QStringView name = reader.name();
+    const size_t nameHash = qHash(name);
+    const QList<XmlListModelQueryPlan::Role> &roles = currentJob->plan->roles;
+
+    // Children tested by predicates have their text collected as well
+    const QList<XmlListModelQueryPlan::Predicate> &predicates = currentJob->plan->predicates;
+    for (int i = 0; i < predicates.count(); ++i) {
+        if (predicates.at(i).element.matches(name, nameHash)) {
+            currentJob->predicateIndex = i;
+            currentJob->predicateText.clear();
+            break;
+        }
+    }
+
+    int index = 0;
+    while (index < roles.count() && !roles.at(index).element.matches(name, nameHash))
+        ++index;
+    if (index == roles.count())
+        return;
+
+    const XmlListModelQueryPlan::Role &role = roles.at(index);
+    if (role.attribute.isEmpty()) {
+        // The element text is collected by doQueryJob() until the element ends
+        currentJob->roleIndex = index;
+        currentJob->roleText.clear();
+        currentJob->roleDeferred = false;
+        if (currentJob->lazy)
+            currentJob->roleStart = currentJob->roleEnd = reader.characterOffset();
+        return;
+    }
+
+    // A single pass over the attributes finds both the value and the type
+    const QXmlStreamAttributes attributes = reader.attributes();
+    const QXmlStreamAttribute *value = nullptr;
+    QStringView type;
+    for (const QXmlStreamAttribute &attribute : attributes) {
+        const QStringView attributeName = attribute.qualifiedName();
+        if (attributeName == role.attribute)
+            value = &attribute;
+        else if (role.jpegLinksOnly && attributeName == QLatin1String("type"))
+            type = attribute.value();
+    }
+
+    if (!value) {
+        Q_EMIT error(role.errorId, role.attribute);
+        currentJob->row[index] = QString();
+        return;
+    }
+
+    if (role.jpegLinksOnly && type != QLatin1String("image/jpeg"))
+        return;
+
+    storeRoleValue(currentJob, index, value->value().toString());
+}
+
+XmlListModelSource::XmlListModelSource()
+    : m_bytes(nullptr), m_size(0), m_growing(true)
+{
+}
+
+XmlListModelSource::XmlListModelSource(QFile *file, const uchar *mappedData)
+    : m_file(file), m_bytes(reinterpret_cast<const char *>(mappedData)), m_size(file->size())
+{
+}
+
+void XmlListModelSource::append(const QByteArray &data)
+{
+    // The buffer can move, so values are not read while it grows
+    QMutexLocker locker(&m_mutex);
+    m_data += data;
+    m_bytes = m_data.constData();
+    m_size = m_data.size();
+}
+
+void XmlListModelSource::squeeze()
+{
+    if (!m_growing)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_data.squeeze();
+    m_bytes = m_data.constData();
+}
+
+QByteArray XmlListModelSource::rawText(const XmlListModelSpan &span) const
+{
+    if (m_growing) {
+        QMutexLocker locker(&m_mutex);
+        if (span.isNull() || span.offset + span.length > m_size)
+            return QByteArray();
+        return m_data.mid(span.offset, span.length);
+    }
+    if (span.isNull() || span.offset + span.length > m_size)
+        return QByteArray();
+    return QByteArray::fromRawData(m_bytes + span.offset, span.length);
+}
+
+qsizetype XmlListModelSource::memoryUsage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_data.size();
+}
+
+QString XmlListModelSource::text(const XmlListModelSpan &span) const
+{
+    // The element content is read again on its own, collecting the same
+    // text and entity references as the query does.
+    QXmlStreamReader reader;
+    reader.setNamespaceProcessing(false);
+    reader.addData(QByteArray("<v>"));
+    reader.addData(rawText(span));
+    reader.addData(QByteArray("</v>"));
+
+    QString text;
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::Characters:
+        case QXmlStreamReader::EntityReference:
+            text += reader.text();
+            break;
+        default:
+            break;
+        }
+    }
+    return text;
+}
+
+XmlListModelData::XmlListModelData(int roleCount)
+    : m_columns(roleCount)
+{
+}
+
+const QString &XmlListModelData::value(int row, int role) const
+{
+    static const QString noValue;
+    if (row < 0 || row >= m_count || role < 0 || role >= m_columns.count())
+        return noValue;
+    return m_columns.at(role).at(row);
+}
+
+bool XmlListModelData::isDeferred(int row, int role) const
+{
+    return !span(row, role).isNull();
+}
+
+XmlListModelSpan XmlListModelData::span(int row, int role) const
+{
+    if (row < 0 || row >= m_count || role < 0 || role >= m_spans.count())
+        return XmlListModelSpan();
+    return m_spans.at(role).at(row);
+}
+
+QString XmlListModelData::text(int row, int role) const
+{
+    const XmlListModelSpan valueSpan = span(row, role);
+    if (valueSpan.isNull() || !m_source)
+        return value(row, role);
+    return m_source->text(valueSpan);
+}
+
+bool XmlListModelData::rowEquals(int row, const XmlListModelData &other, int otherRow) const
+{
+    const int roles = qMax(roleCount(), other.roleCount());
+    for (int role = 0; role < roles; ++role) {
+        const bool deferred = isDeferred(row, role);
+        const bool otherDeferred = other.isDeferred(otherRow, role);
+        if (deferred && otherDeferred && m_source && other.m_source) {
+            // Identical markup is the same value; no need to decode either
+            if (m_source->rawText(span(row, role)) != other.m_source->rawText(other.span(otherRow, role)))
+                return false;
+        } else if (deferred || otherDeferred) {
+            if (text(row, role) != other.text(otherRow, role))
+                return false;
+        } else if (value(row, role) != other.value(otherRow, role)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+XmlListModelData XmlListModelData::reordered(const QList<int> &order) const
+{
+    XmlListModelData result;
+    result.m_source = m_source;
+    result.m_count = order.count();
+    result.m_columns.resize(m_columns.count());
+    for (int role = 0; role < m_columns.count(); ++role) {
+        QList<QString> &column = result.m_columns[role];
+        column.reserve(order.count());
+        for (int row : order)
+            column.append(m_columns.at(role).at(row));
+    }
+    result.m_spans.resize(m_spans.count());
+    for (int role = 0; role < m_spans.count(); ++role) {
+        QList<XmlListModelSpan> &column = result.m_spans[role];
+        column.reserve(order.count());
+        for (int row : order)
+            column.append(m_spans.at(role).at(row));
+    }
+    return result;
+}
+
+void XmlListModelData::ensureRoleCount(int roleCount)
+{
+    while (m_columns.count() < roleCount)
+        m_columns.append(QList<QString>(m_count));
+    while (!m_spans.isEmpty() && m_spans.count() < roleCount)
+        m_spans.append(QList<XmlListModelSpan>(m_count));
+}
+
+void XmlListModelData::ensureSpans()
+{
+    if (!m_spans.isEmpty())
+        return;
+    m_spans.resize(m_columns.count());
+    for (QList<XmlListModelSpan> &column : m_spans)
+        column.resize(m_count);
+}
+
+bool XmlListModelData::mergeSource(const XmlListModelData &other)
+{
+    // Deferred values of other are kept if they refer to the same document
+    // as ours; otherwise they are decoded while they are copied.
+    if (!other.hasDeferredValues() || (m_source && m_source != other.m_source))
+        return false;
+    m_source = other.m_source;
+    ensureSpans();
+    return true;
+}
+
+void XmlListModelData::appendRow(const QList<QString> &row)
+{
+    appendRow(row, QList<XmlListModelSpan>());
+}
+
+void XmlListModelData::appendRow(const QList<QString> &row, const QList<XmlListModelSpan> &spans)
+{
+    ensureRoleCount(row.count());
+    for (const XmlListModelSpan &span : spans) {
+        if (!span.isNull()) {
+            ensureSpans();
+            break;
+        }
+    }
+
+    for (int role = 0; role < m_columns.count(); ++role)
+        m_columns[role].append(role < row.count() ? row.at(role) : QString());
+    for (int role = 0; role < m_spans.count(); ++role)
+        m_spans[role].append(role < spans.count() ? spans.at(role) : XmlListModelSpan());
+    ++m_count;
+}
+
+void XmlListModelData::append(const XmlListModelData &other)
+{
+    if (m_count == 0 && roleCount() <= other.roleCount()) {
+        *this = other;
+        return;
+    }
+    insertRows(m_count, other, 0, other.m_count);
+}
+
+void XmlListModelData::prepend(const XmlListModelData &other)
+{
+    insertRows(0, other, 0, other.m_count);
+}
+
+template <typename T>
+static void insertValues(QList<T> *list, int row, const QList<T> &values)
+{
+    if (row == list->count()) {
+        list->append(values);
+    } else if (row == 0) {
+        // Back to front, so that the list grows into its free space at the
+        // beginning instead of moving the existing rows once per new row.
+        for (auto it = values.crbegin(); it != values.crend(); ++it)
+            list->prepend(*it);
+    } else {
+        for (int i = 0; i < values.count(); ++i)
+            list->insert(row + i, values.at(i));
+    }
+}
+
+void XmlListModelData::insertRows(int row, const XmlListModelData &other, int otherRow, int count)
+{
+    const bool keepSpans = mergeSource(other);
+    ensureRoleCount(other.roleCount());
+    for (int role = 0; role < m_columns.count(); ++role) {
+        QList<QString> values;
+        values.reserve(count);
+        for (int i = 0; i < count; ++i)
+            values.append(keepSpans ? other.value(otherRow + i, role) : other.text(otherRow + i, role));
+        insertValues(&m_columns[role], row, values);
+    }
+    for (int role = 0; role < m_spans.count(); ++role) {
+        QList<XmlListModelSpan> spans(count);
+        for (int i = 0; keepSpans && i < count; ++i)
+            spans[i] = other.span(otherRow + i, role);
+        insertValues(&m_spans[role], row, spans);
+    }
+    m_count += count;
+}
+
+void XmlListModelData::removeRows(int row, int count)
+{
+    for (QList<QString> &column : m_columns)
+        column.remove(row, count);
+    for (QList<XmlListModelSpan> &column : m_spans)
+        column.remove(row, count);
+    m_count -= count;
+}
+
+void XmlListModelData::moveRow(int from, int to)
+{
+    for (QList<QString> &column : m_columns)
+        column.move(from, to);
+    for (QList<XmlListModelSpan> &column : m_spans)
+        column.move(from, to);
+}
+
+void XmlListModelData::clear()
+{
+    m_columns.clear();
+    m_spans.clear();
+    m_source.reset();
+    m_count = 0;
+}
+
+void XmlListModelData::write(QDataStream &stream) const
+{
+    // Each column is written as a table of its distinct values followed by
+    // one index per row, which keeps repeated values compact on disk.
+    // Deferred values are decoded, the source is not part of the cache.
+    stream << qint32(m_columns.count()) << qint32(m_count);
+    for (int role = 0; role < m_columns.count(); ++role) {
+        QHash<QString, quint32> indexes;
+        QList<QString> values;
+        QList<quint32> rows;
+        rows.reserve(m_count);
+        for (int row = 0; row < m_count; ++row) {
+            const QString value = text(row, role);
+            auto it = indexes.constFind(value);
+            if (it == indexes.constEnd()) {
+                it = indexes.insert(value, quint32(values.count()));
+                values.append(value);
             }
+            rows.append(it.value());
+        }
+        stream << qint32(values.count());
+        for (const QString &value : qAsConst(values))
+            stream << value.toUtf8();
+        for (quint32 row : qAsConst(rows))
+            stream << row;
+    }
+}
+
+bool XmlListModelData::read(QDataStream &stream)
+{
+    qint32 roleCount = 0;
+    qint32 count = 0;
+    stream >> roleCount >> count;
+    if (stream.status() != QDataStream::Ok || roleCount < 0 || count < 0)
+        return false;
+
+    QList<QList<QString> > columns(roleCount);
+    for (QList<QString> &column : columns) {
+        qint32 valueCount = 0;
+        stream >> valueCount;
+        if (stream.status() != QDataStream::Ok || valueCount < 0)
+            return false;
+
+        QList<QString> values;
+        values.reserve(valueCount);
+        for (qint32 i = 0; i < valueCount; ++i) {
+            QByteArray value;
+            stream >> value;
+            values.append(QString::fromUtf8(value));
         }
+
+        column.reserve(count);
+        for (qint32 i = 0; i < count; ++i) {
+            quint32 index = 0;
+            stream >> index;
+            if (index >= quint32(values.count()))
+                return false;
+            column.append(values.at(index));
+        }
+    }
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    m_columns = columns;
+    m_spans.clear();
+    m_source.reset();
+    m_count = count;
+    return true;
+}
+
+qsizetype XmlListModelData::memoryUsage() const
+{
+    // The column arrays plus every distinct string payload, counted once,
+    // and the retained source of deferred values
+    qsizetype size = sizeof(*this) + m_columns.capacity() * sizeof(QList<QString>);
+    for (const QList<XmlListModelSpan> &column : m_spans)
+        size += sizeof(column) + column.capacity() * sizeof(XmlListModelSpan);
+    if (m_source)
+        size += m_source->memoryUsage();
+    QSet<const QChar *> payloads;
+    for (const QList<QString> &column : m_columns) {
+        size += column.capacity() * sizeof(QString);
+        for (const QString &value : column) {
+            if (value.isNull() || payloads.contains(value.constData()))
+                continue;
+            payloads.insert(value.constData());
+            size += sizeof(QArrayData) + (value.capacity() + 1) * sizeof(QChar);
+        }
+    }
+    return size;
+}
+
+void XmlListModelStats::reset()
+{
+    m_query = XmlListModelQueryStats();
+    m_networkWait = 0;
+    m_applyTime = 0;
+    m_totalTime = 0;
+    Q_EMIT changed();
+}
+
+void XmlListModelStats::setNetworkWait(qint64 networkWait)
+{
+    m_networkWait = networkWait;
+    Q_EMIT changed();
+}
+
+void XmlListModelStats::setQueryStats(const XmlListModelQueryStats &query)
+{
+    m_query = query;
+    Q_EMIT changed();
+}
+
+void XmlListModelStats::addApplyTime(qint64 applyTime)
+{
+    m_applyTime += applyTime;
+    Q_EMIT changed();
+}
+
+void XmlListModelStats::finish(qint64 totalTime)
+{
+    m_totalTime = totalTime;
+    Q_EMIT changed();
+}
+
+#if QT_CONFIG(qml_network)
+XmlListModelDownload *XmlListModelQueryEngine::download(const QUrl &url, const QByteArray &eTag, const QByteArray &lastModified)
+{
+    // Models that load a source before its data starts to arrive share the
+    // request, as long as they ask for it under the same conditions.
+    for (auto it = m_downloads.constFind(url); it != m_downloads.constEnd() && it.key() == url; ++it) {
+        if (it.value()->matches(eTag, lastModified))
+            return it.value();
+    }
+
+    QNetworkRequest req(url);
+    req.setRawHeader("Accept", "application/xml,*/*");
+    if (!eTag.isEmpty())
+        req.setRawHeader("If-None-Match", eTag);
+    if (!lastModified.isEmpty())
+        req.setRawHeader("If-Modified-Since", lastModified);
+    XmlListModelDownload *download = new XmlListModelDownload(this, m_engine->networkAccessManager()->get(req),
+                                                              eTag, lastModified);
+    m_downloads.insert(url, download);
+    return download;
+}
+
+void XmlListModelQueryEngine::removeDownload(XmlListModelDownload *download)
+{
+    m_downloads.remove(download->url(), download);
+}
+
+XmlListModelDownload::XmlListModelDownload(XmlListModelQueryEngine *engine, QNetworkReply *reply,
+                                           const QByteArray &eTag, const QByteArray &lastModified)
+    : QObject(engine), m_engine(engine), m_reply(reply), m_url(reply->request().url())
+    , m_eTag(eTag), m_lastModified(lastModified), m_documentId(engine->startDocument())
+    , m_users(0), m_finished(false)
+{
+    QObject::connect(m_reply, &QNetworkReply::readyRead,
+        this, &XmlListModelDownload::replyReadyRead);
+    QObject::connect(m_reply, &QNetworkReply::finished,
+        this, &XmlListModelDownload::replyFinished);
+    QObject::connect(m_reply, &QNetworkReply::downloadProgress,
+        this, &XmlListModelDownload::downloadProgress);
+}
+
+XmlListModelDownload::~XmlListModelDownload()
+{
+    if (m_reply) {
+        QObject::disconnect(m_reply, 0, this, 0);
+        m_reply->abort();
+        m_reply->deleteLater();
     }
 }
 
-void XmlListModelQueryEngine::processElement(XmlListModelQueryJob *currentJob, XmlListModelQueryResult*& currentResult, QString element, QXmlStreamReader &reader)
+void XmlListModelDownload::addUser()
 {
-    if (!reader.isStartElement() || reader.name() != element)
-        return;
+    ++m_users;
+}
 
-    const QStringList &roleQueries = currentJob->roleQueries;
-    const QStringList &roleNames = currentJob->roleNames;
-    QHash<int, QString> resultList;
+void XmlListModelDownload::release()
+{
+    if (--m_users > 0)
+        return;
 
+    // Queries on a complete document are left to finish
+    m_engine->removeDownload(this);
+    if (!m_finished) {
+        m_engine->abort(m_documentId);
+        for (int id : qAsConst(m_queries))
+            m_engine->abort(id);
+    }
+    deleteLater();
+}
 
-    while (reader.readNextStartElement()) {
+int XmlListModelDownload::startQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan,
+                                     const XmlListModelQueryOptions &options)
+{
+    bool joined = false;
+    const int id = m_engine->startQuery(plan, options, m_documentId, &joined);
+    // Queries are only started before the first data is passed on, so one
+    // that cannot share the pass over the document still gets all of it.
+    if (!joined)
+        m_queries.append(id);
+    return id;
+}
 
-        if (roleNames.contains(reader.name()) && !reader.name().isEmpty()) {
-            bool hasLink = false;
-            bool hasJpegImageLink = false;
+void XmlListModelDownload::replyReadyRead()
+{
+    // Redirect and error bodies are not part of the document
+    if (m_reply->error() != QNetworkReply::NoError
+            || m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid()) {
+        return;
+    }
 
-            QString roleResult;
-            const int index = roleNames.indexOf(reader.name());
+    const QByteArray data = m_reply->readAll();
+    if (data.isEmpty())
+        return;
 
-            if (!roleQueries.at(index).isEmpty()) {
-                if (reader.attributes().hasAttribute(roleQueries.at(index))) {
-                    if (roleQueries.at(index) == "href") {
-                        hasLink = true;
-                        if (reader.attributes().value("type").toString() == "image/jpeg")
-                            hasJpegImageLink = true;
-                    }
-                    roleResult = reader.attributes().value(roleQueries.at(index)).toString();
-                } else {
-                    Q_EMIT error(currentJob->roleQueryErrorId.at(index), roleQueries[index]);
-                }
-            } else if (!roleNames.at(index).isEmpty()) {
-                roleResult = reader.readElementText();
-            }
+    // Models start their queries when the first data arrives, so all of
+    // them that are waiting for it join the document before it is parsed.
+    // Models that load the source from then on send a request of their own,
+    // so nothing that has been passed on needs to be kept here.
+    m_engine->removeDownload(this);
+    Q_EMIT readyRead();
+    m_engine->appendData(m_documentId, data);
+    for (int id : qAsConst(m_queries))
+        m_engine->appendData(id, data);
+}
 
-            if (hasLink && !hasJpegImageLink)
-                reader.skipCurrentElement();
-            else
-                resultList[index] = roleResult;
+void XmlListModelDownload::replyFinished()
+{
+    replyReadyRead();
+    m_finished = true;
+    m_engine->removeDownload(this);
 
-        } else {
-            reader.skipCurrentElement();
-        }
-    }
+    // The queries have all the data before the models are told, so that
+    // they can let go of the download right away.
+    m_engine->finishData(m_documentId);
+    for (int id : qAsConst(m_queries))
+        m_engine->finishData(id);
 
-    if (resultList.count() <= 0)
-        resultList = QHash<int, QString>();
-    currentResult->data << resultList;
+    Q_EMIT finished();
 }
+#endif
 
 QString XmlListModelRole::elementName() const { return m_elementName; }
 
@@ -316,14 +1951,26 @@ bool XmlListModelRole::isValid() const
     return !m_elementName.isEmpty();
 }
 
+#define XMLLISTMODEL_DECODED_CACHE_SIZE (256 * 1024)
+
 XmlListModel::XmlListModel(QObject *parent) : QAbstractListModel(parent)
-    , m_isComponentComplete(true), m_size(0), m_highestRole(Qt::UserRole)
-#if QT_CONFIG(qml_network)
-    , m_reply(nullptr)
-#endif
+    , m_size(0), m_sortOrder(Qt::AscendingOrder), m_roleObjects()
+    , m_isComponentComplete(true), m_resetPending(false), m_persistentCache(false)
+    , m_appendOnly(false), m_lazyDecoding(false), m_canFetchMore(false), m_limit(-1), m_offset(0)
+    , m_refreshing(false), m_sortPending(false)
+    , m_stats(new XmlListModelStats(this)), m_loadStarted(0), m_requestStarted(0)
     , m_status(XmlListModel::Null), m_progress(0.0)
-    , m_queryId(-1), m_roleObjects(), m_redirectCount(0)
+    , m_queryId(-1), m_cacheQueryId(-1), m_redirectCount(0), m_highestRole(Qt::UserRole)
+{
+    connect(&m_refreshTimer, &QTimer::timeout, this, &XmlListModel::refresh);
+    m_decodedValues.setMaxCost(XMLLISTMODEL_DECODED_CACHE_SIZE);
+}
+
+XmlListModel::~XmlListModel()
 {
+#if QT_CONFIG(qml_network)
+    deleteReply();
+#endif
 }
 
 QModelIndex XmlListModel::index(int row, int column, const QModelIndex &parent) const
@@ -340,10 +1987,31 @@ int XmlListModel::rowCount(const QModelIndex &parent) const
 
 QVariant XmlListModel::data(const QModelIndex &index, int role) const
 {
-    const int roleIndex = m_roles.indexOf(role);
-    return (roleIndex == -1 || !index.isValid())
-            ? QVariant()
-            : m_data.value(index.row()).value(roleIndex);
+    const int column = role - Qt::UserRole;
+    const int roleIndex = column >= 0 && column < m_roleColumns.count() ? m_roleColumns.at(column) : -1;
+    if (roleIndex == -1 || !index.isValid())
+        return QVariant();
+    if (m_data.isDeferred(index.row(), roleIndex))
+        return decodedValue(index.row(), roleIndex);
+    return m_data.value(index.row(), roleIndex);
+}
+
+QString XmlListModel::decodedValue(int row, int role) const
+{
+    // The values of the rows in view are kept, up to a total length, so that
+    // delegates can read them again without decoding them again.
+    if (m_decodedSource != m_data.source()) {
+        m_decodedValues.clear();
+        m_decodedSource = m_data.source();
+    }
+
+    const qint64 key = m_data.span(row, role).offset;
+    if (const QString *value = m_decodedValues.object(key))
+        return *value;
+
+    const QString value = m_data.text(row, role);
+    m_decodedValues.insert(key, new QString(value), qMax<qsizetype>(1, value.size()));
+    return value;
 }
 
 QHash<int, QByteArray> XmlListModel::roleNames() const
@@ -354,6 +2022,23 @@ QHash<int, QByteArray> XmlListModel::roleNames() const
     return roleNames;
 }
 
+bool XmlListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_canFetchMore;
+}
+
+void XmlListModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    // The next page is appended to the rows already there
+    m_canFetchMore = false;
+    m_status = Loading;
+    XmlListModelQueryEngine::instance(qmlEngine(this))->fetchMore(m_queryId, m_limit);
+    Q_EMIT statusChanged(m_status);
+}
+
 int XmlListModel::count() const
 {
     return m_size;
@@ -387,11 +2072,170 @@ void XmlListModel::setQuery(const QString &query)
 
     if (m_query != query) {
         m_query = query;
+        invalidateQueryPlan();
         reload();
         Q_EMIT queryChanged();
     }
 }
 
+QString XmlListModel::keyRole() const
+{
+    return m_keyRole;
+}
+
+void XmlListModel::setKeyRole(const QString &keyRole)
+{
+    if (m_keyRole == keyRole)
+        return;
+    m_keyRole = keyRole;
+    Q_EMIT keyRoleChanged();
+}
+
+bool XmlListModel::persistentCache() const
+{
+    return m_persistentCache;
+}
+
+void XmlListModel::setPersistentCache(bool persistentCache)
+{
+    if (m_persistentCache == persistentCache)
+        return;
+    m_persistentCache = persistentCache;
+    Q_EMIT persistentCacheChanged();
+}
+
+int XmlListModel::refreshInterval() const
+{
+    return m_refreshTimer.interval();
+}
+
+void XmlListModel::setRefreshInterval(int refreshInterval)
+{
+    refreshInterval = qMax(0, refreshInterval);
+    if (m_refreshTimer.interval() == refreshInterval)
+        return;
+    m_refreshTimer.setInterval(refreshInterval);
+    updateRefreshTimer();
+    Q_EMIT refreshIntervalChanged();
+}
+
+bool XmlListModel::appendOnly() const
+{
+    return m_appendOnly;
+}
+
+void XmlListModel::setAppendOnly(bool appendOnly)
+{
+    if (m_appendOnly == appendOnly)
+        return;
+    m_appendOnly = appendOnly;
+    Q_EMIT appendOnlyChanged();
+}
+
+bool XmlListModel::lazyDecoding() const
+{
+    return m_lazyDecoding;
+}
+
+void XmlListModel::setLazyDecoding(bool lazyDecoding)
+{
+    if (m_lazyDecoding == lazyDecoding)
+        return;
+    m_lazyDecoding = lazyDecoding;
+    Q_EMIT lazyDecodingChanged();
+}
+
+int XmlListModel::limit() const
+{
+    return m_limit;
+}
+
+void XmlListModel::setLimit(int limit)
+{
+    limit = qMax(-1, limit);
+    if (m_limit == limit)
+        return;
+    m_limit = limit;
+    reload();
+    Q_EMIT limitChanged();
+}
+
+int XmlListModel::offset() const
+{
+    return m_offset;
+}
+
+void XmlListModel::setOffset(int offset)
+{
+    offset = qMax(0, offset);
+    if (m_offset == offset)
+        return;
+    m_offset = offset;
+    reload();
+    Q_EMIT offsetChanged();
+}
+
+QString XmlListModel::sortRole() const
+{
+    return m_sortRole;
+}
+
+void XmlListModel::setSortRole(const QString &sortRole)
+{
+    if (m_sortRole == sortRole)
+        return;
+    m_sortRole = sortRole;
+    sortAgain();
+    Q_EMIT sortRoleChanged();
+}
+
+Qt::SortOrder XmlListModel::sortOrder() const
+{
+    return m_sortOrder;
+}
+
+void XmlListModel::setSortOrder(Qt::SortOrder sortOrder)
+{
+    if (m_sortOrder == sortOrder)
+        return;
+    m_sortOrder = sortOrder;
+    sortAgain();
+    Q_EMIT sortOrderChanged();
+}
+
+void XmlListModel::sortAgain()
+{
+    // Pages are shown in document order
+    if (!m_isComponentComplete || m_limit >= 0)
+        return;
+
+    // A query keeps the order it was started with; the rows it loads are
+    // sorted again once they are all in.
+    bool loading = m_queryId != -1 || m_cacheQueryId != -1;
+#if QT_CONFIG(qml_network)
+    loading = loading || m_download;
+#endif
+    m_sortPending = loading;
+    if (loading)
+        return;
+
+    // Without a sort role the rows go back to the order of the document,
+    // which is known without reading it again.
+    const int role = roleIndex(m_sortRole);
+    if (m_size > 0 && (role != -1 || !m_documentOrder.isEmpty())) {
+        m_queryId = XmlListModelQueryEngine::instance(qmlEngine(this))->sortRows(
+                m_data, m_documentOrder, role, m_sortOrder);
+    }
+}
+
+void XmlListModel::updateRefreshTimer()
+{
+    if (m_isComponentComplete && m_refreshTimer.interval() > 0)
+        m_refreshTimer.start();
+    else
+        m_refreshTimer.stop();
+}
+
 QQmlListProperty<XmlListModelRole> XmlListModel::roleObjects()
 {
     QQmlListProperty<XmlListModelRole> list(this, &m_roleObjects);
@@ -404,20 +2248,31 @@ void XmlListModel::appendRole(XmlListModelRole* role)
 {
     int i = m_roleObjects.count();
     m_roleObjects.append(role);
+    invalidateQueryPlan();
+    connect(role, &XmlListModelRole::elementNameChanged, this, &XmlListModel::invalidateQueryPlan);
+    connect(role, &XmlListModelRole::attributeNameChanged, this, &XmlListModel::invalidateQueryPlan);
     if (m_roleNames.contains(role->elementName())) {
         qmlWarning(role) << XmlListModel::tr("\"%1\" duplicates a previous role name and will be disabled.").arg(role->elementName());
         return;
     }
     m_roles.insert(i, m_highestRole);
     m_roleNames.insert(i, role->elementName());
+    const int column = m_highestRole - Qt::UserRole;
+    while (m_roleColumns.count() <= column)
+        m_roleColumns.append(-1);
+    m_roleColumns[column] = i;
     ++m_highestRole;
 }
 
 void XmlListModel::clearRole()
 {
     m_roles.clear();
+    m_roleColumns.clear();
     m_roleNames.clear();
+    for (XmlListModelRole *role : qAsConst(m_roleObjects))
+        disconnect(role, nullptr, this, nullptr);
     m_roleObjects.clear();
+    invalidateQueryPlan();
 }
 
 void XmlListModel::appendRole(QQmlListProperty<XmlListModelRole>* list, XmlListModelRole* role)
@@ -445,38 +2300,79 @@ QString XmlListModel::errorString() const
     return m_errorString;
 }
 
+qsizetype XmlListModel::memoryUsage() const
+{
+    return m_data.memoryUsage() + m_decodedValues.totalCost();
+}
+
+XmlListModelStats *XmlListModel::stats() const
+{
+    return m_stats;
+}
+
 void XmlListModel::classBegin()
 {
     m_isComponentComplete = false;
 
     XmlListModelQueryEngine *queryEngine = XmlListModelQueryEngine::instance(qmlEngine(this));
+    connect(queryEngine, &XmlListModelQueryEngine::rowsAvailable,
+        this, &XmlListModel::queryRowsAvailable);
     connect(queryEngine, &XmlListModelQueryEngine::queryCompleted,
         this, &XmlListModel::queryCompleted);
     connect(queryEngine, &XmlListModelQueryEngine::error,
         this, &XmlListModel::queryError);
+#if QT_CONFIG(qml_network)
+    connect(queryEngine, &XmlListModelQueryEngine::cacheLoaded,
+        this, &XmlListModel::cacheLoaded);
+#endif
 }
 
 void XmlListModel::componentComplete()
 {
     m_isComponentComplete = true;
+    updateRefreshTimer();
     reload();
 }
 
 void XmlListModel::reload()
+{
+    load(false);
+}
+
+void XmlListModel::refresh()
+{
+    // A refresh that comes while the source is still being read is dropped
+    if (m_source.isEmpty() || (m_queryId != -1 && !m_canFetchMore) || m_cacheQueryId != -1)
+        return;
+#if QT_CONFIG(qml_network)
+    if (m_download)
+        return;
+#endif
+    load(true);
+}
+
+void XmlListModel::load(bool refreshing)
 {
     if (!m_isComponentComplete)
         return;
 
     XmlListModelQueryEngine::instance(qmlEngine(this))->abort(m_queryId);
     m_queryId = -1;
+    m_cacheQueryId = -1;
+    m_canFetchMore = false;
+    m_refreshing = refreshing;
+    m_sortPending = false;
+    m_stats->reset();
+    m_loadStarted = traceTime();
 
     if (m_size < 0)
         m_size = 0;
 
 #if QT_CONFIG(qml_network)
-    if (m_reply) {
-        m_reply->abort();
-        deleteReply();
+    deleteReply();
+    if (!refreshing) {
+        m_eTag.clear();
+        m_lastModified.clear();
     }
 #endif
 
@@ -486,27 +2382,24 @@ void XmlListModel::reload()
         QTimer::singleShot(0, this, &XmlListModel::dataCleared);
     }
     else if (QQmlFile::isLocalFile(m_source)) {
-        QFile file(QQmlFile::urlToLocalFileOrQrc(m_source));
-        QByteArray data = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
         notifyQueryStarted(false);
-        if (data.isEmpty()) {
-            m_queryId = 0;
-            QTimer::singleShot(0, this, &XmlListModel::dataCleared);
-        } else {
-            m_queryId = XmlListModelQueryEngine::instance(qmlEngine(this))->doQuery(
-                m_query, data, &m_roleObjects);
-        }
+        m_queryId = XmlListModelQueryEngine::instance(qmlEngine(this))->doFileQuery(
+            queryPlan(), QQmlFile::urlToLocalFileOrQrc(m_source), queryOptions());
     } else {
 #if QT_CONFIG(qml_network)
         notifyQueryStarted(true);
-        QNetworkRequest req(m_source);
-        req.setRawHeader("Accept", "application/xml,*/*");
-        m_reply = qmlContext(this)->engine()->networkAccessManager()->get(req);
-
-        QObject::connect(m_reply, &QNetworkReply::finished,
-            this, &XmlListModel::requestFinished);
-        QObject::connect(m_reply, &QNetworkReply::downloadProgress,
-            this, &XmlListModel::requestProgress);
+        if (refreshing) {
+            // The rows in the model are those of the last reply, so the
+            // server only needs to send the document if it has changed.
+            sendRequest(m_eTag, m_lastModified);
+        } else if (isCacheable()) {
+            // The request is sent once the cached rows and their validators
+            // have been read on a worker thread.
+            m_cacheQueryId = XmlListModelQueryEngine::instance(qmlEngine(this))->loadCache(
+                cacheFileName(), queryPlan());
+        } else {
+            sendRequest(QByteArray(), QByteArray());
+        }
 #else
         m_queryId = 0;
         notifyQueryStarted(false);
@@ -518,13 +2411,91 @@ void XmlListModel::reload()
 #define XMLLISTMODEL_MAX_REDIRECT 16
 
 #if QT_CONFIG(qml_network)
+void XmlListModel::sendRequest(const QByteArray &eTag, const QByteArray &lastModified)
+{
+    m_download = XmlListModelQueryEngine::instance(qmlEngine(this))->download(m_source, eTag, lastModified);
+    m_download->addUser();
+    m_requestStarted = traceTime();
+
+    QObject::connect(m_download, &XmlListModelDownload::readyRead,
+        this, &XmlListModel::requestReadyRead);
+    QObject::connect(m_download, &XmlListModelDownload::finished,
+        this, &XmlListModel::requestFinished);
+    QObject::connect(m_download, &XmlListModelDownload::downloadProgress,
+        this, &XmlListModel::requestProgress);
+}
+
+void XmlListModel::cacheLoaded(const XmlListModelQueryResult &result)
+{
+    if (result.queryId != m_cacheQueryId)
+        return;
+    m_cacheQueryId = -1;
+
+    if (result.fromCache) {
+        // Show the cached rows right away; whatever the server sends back
+        // replaces them, unless it confirms that they are still current.
+        appendRows(result.data);
+        m_documentOrder = result.documentOrder;
+        m_resetPending = true;
+        m_eTag = result.eTag;
+        m_lastModified = result.lastModified;
+        sendRequest(m_eTag, m_lastModified);
+    } else {
+        sendRequest(QByteArray(), QByteArray());
+    }
+}
+
+bool XmlListModel::isCacheable() const
+{
+    // Only complete documents are cached
+    return m_persistentCache && m_limit < 0 && m_offset == 0;
+}
+
+QString XmlListModel::cacheFileName() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_source.toEncoded());
+    hash.addData(queryPlan()->signature);
+    // Cached rows are stored in the order they are shown in
+    hash.addData(m_sortRole.toUtf8());
+    hash.addData(m_sortOrder == Qt::AscendingOrder ? "a" : "d");
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QLatin1String("/xmllistmodel/") + QString::fromLatin1(hash.result().toHex())
+            + QLatin1String(".cache");
+}
+
+void XmlListModel::requestReadyRead()
+{
+    // Parse the reply while it downloads; rows are published in batches
+    // through queryRowsAvailable() as soon as they have been read. The
+    // download gives the data to the query.
+    if (m_queryId != -1)
+        return;
+
+    XmlListModelQueryOptions options = queryOptions();
+    m_eTag = m_download->reply()->rawHeader("ETag");
+    m_lastModified = m_download->reply()->rawHeader("Last-Modified");
+    // An append-only refresh does not read the whole document
+    if (isCacheable() && options.knownKeys.isEmpty()) {
+        options.cacheFile = cacheFileName();
+        options.eTag = m_eTag;
+        options.lastModified = m_lastModified;
+    }
+    m_queryId = m_download->startQuery(queryPlan(), options);
+
+    const qint64 now = traceTime();
+    m_stats->setNetworkWait(now - m_requestStarted);
+    traceEvent("network wait", m_queryId, m_requestStarted, now);
+}
+
 void XmlListModel::requestFinished()
 {
+    QNetworkReply *reply = m_download->reply();
     m_redirectCount++;
     if (m_redirectCount < XMLLISTMODEL_MAX_REDIRECT) {
-        QVariant redirect = m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
+        QVariant redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
         if (redirect.isValid()) {
-            QUrl url = m_reply->url().resolved(redirect.toUrl());
+            QUrl url = reply->url().resolved(redirect.toUrl());
             deleteReply();
             setSource(url);
             return;
@@ -532,13 +2503,18 @@ void XmlListModel::requestFinished()
     }
     m_redirectCount = 0;
 
-    if (m_reply->error() != QNetworkReply::NoError) {
-        m_errorString = m_reply->errorString();
+    if (reply->error() != QNetworkReply::NoError) {
+        m_errorString = reply->errorString();
         deleteReply();
 
-        if (m_size > 0) {
+        XmlListModelQueryEngine::instance(qmlEngine(this))->abort(m_queryId);
+        m_resetPending = false;
+
+        // A failed refresh leaves the rows of the last successful load
+        if (m_size > 0 && !m_refreshing) {
             beginRemoveRows(QModelIndex(), 0, m_size - 1);
             m_data.clear();
+            m_documentOrder.clear();
             m_size = 0;
             endRemoveRows();
             Q_EMIT countChanged();
@@ -546,14 +2522,30 @@ void XmlListModel::requestFinished()
 
         m_status = Error;
         m_queryId = -1;
+        m_canFetchMore = false;
+        m_refreshing = false;
+        Q_EMIT statusChanged(m_status);
+        if (m_sortPending)
+            sortAgain();
+    } else if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        // The cached rows are still current; there is nothing to parse
+        deleteReply();
+        m_resetPending = false;
+        m_refreshing = false;
+        m_queryId = -1;
+        m_status = Ready;
+        m_errorString.clear();
+
+        m_progress = 1.0;
+        Q_EMIT progressChanged(m_progress);
         Q_EMIT statusChanged(m_status);
+        if (m_sortPending)
+            sortAgain();
     } else {
-        QByteArray data = m_reply->readAll();
-        if (data.isEmpty()) {
+        // The download has already told the query that the data is complete
+        if (m_queryId == -1) {
             m_queryId = 0;
             QTimer::singleShot(0, this, &XmlListModel::dataCleared);
-        } else {
-            m_queryId = XmlListModelQueryEngine::instance(qmlEngine(this))->doQuery(m_query, data, &m_roleObjects);
         }
         deleteReply();
 
@@ -564,10 +2556,10 @@ void XmlListModel::requestFinished()
 
 void XmlListModel::deleteReply()
 {
-    if (m_reply) {
-        QObject::disconnect(m_reply, 0, this, 0);
-        m_reply->deleteLater();
-        m_reply = nullptr;
+    if (m_download) {
+        QObject::disconnect(m_download, 0, this, 0);
+        m_download->release();
+        m_download = nullptr;
     }
 }
 #endif
@@ -598,43 +2590,259 @@ void XmlListModel::queryError(void* object, const QString& error)
     qmlWarning(this) << XmlListModel::tr("invalid query: \"%1\"").arg(error);
 }
 
-void XmlListModel::queryCompleted(const XmlListModelQueryResult &result)
+void XmlListModel::queryRowsAvailable(const XmlListModelQueryResult &result)
 {
     if (result.queryId != m_queryId)
         return;
 
-    int origCount = m_size;
-    bool sizeChanged = result.data.count() != m_size;
+    const qint64 start = traceTime();
+    appendRows(result.data);
+    const qint64 end = traceTime();
+    traceEvent("apply", result.queryId, start, end);
+    m_stats->setQueryStats(result.stats);
+    m_stats->addApplyTime(end - start);
+}
+
+void XmlListModel::queryCompleted(const XmlListModelQueryResult &result)
+{
+    if (result.queryId != m_queryId)
+        return;
 
     if (m_source.isEmpty())
         m_status = Null;
     else
         m_status = Ready;
     m_errorString.clear();
-    m_queryId = -1;
+    m_refreshing = false;
+
+    // A paused query keeps its id; the rest of the download still goes to it
+    m_canFetchMore = result.hasMore;
+    if (!m_canFetchMore)
+        m_queryId = -1;
+
+#if QT_CONFIG(qml_network)
+    // The parse can end before the download does, for instance when an
+    // append-only refresh reaches the entries the model already has.
+    // Other models may still be reading the same download.
+    if (m_download && !m_canFetchMore)
+        deleteReply();
+#endif
+
+    const qint64 start = traceTime();
+    if (result.reordered) {
+        if (result.diffBase == m_data)
+            applyOrder(result);
+    } else if (result.prepend) {
+        prependRows(result.data);
+    } else if (result.keyed && result.diffBase == m_data) {
+        applyDiff(result);
+        m_documentOrder = result.documentOrder;
+    } else {
+        appendRows(result.data);
+        if (result.documentOrder.count() == m_size)
+            m_documentOrder = result.documentOrder;
+    }
+    const qint64 end = traceTime();
+    traceEvent("apply", result.queryId, start, end);
+    m_stats->addApplyTime(end - start);
+
+    // Sorting rows again is not a load
+    if (!result.reordered) {
+        m_stats->setQueryStats(result.stats);
+        m_stats->finish(end - m_loadStarted);
+        traceEvent("load", result.queryId, m_loadStarted, end);
+        qCDebug(lcXmlListModel).nospace() << "query " << result.queryId << ": " << m_source.toString()
+                << ", " << m_stats->bytesReceived() << " bytes, " << m_stats->rowsProduced() << " rows"
+                << ", network wait " << m_stats->networkWait() << " ms, queue wait " << m_stats->queueWait()
+                << " ms, parse " << m_stats->parseTime() << " ms, apply " << m_stats->applyTime()
+                << " ms, total " << m_stats->totalTime() << " ms";
+    }
+
+    Q_EMIT statusChanged(m_status);
+    if (m_sortPending && m_queryId == -1)
+        sortAgain();
+}
+
+void XmlListModel::applyDiff(const XmlListModelQueryResult &result)
+{
+    const int origCount = m_size;
+    m_resetPending = false;
+
+    for (const XmlListModelDiffOp &op : result.diff) {
+        switch (op.type) {
+        case XmlListModelDiffOp::Remove:
+            beginRemoveRows(QModelIndex(), op.first, op.last);
+            m_data.removeRows(op.first, op.last - op.first + 1);
+            m_size = m_data.count();
+            endRemoveRows();
+            break;
+        case XmlListModelDiffOp::Move:
+            beginMoveRows(QModelIndex(), op.first, op.last, QModelIndex(),
+                          op.destination > op.first ? op.destination + 1 : op.destination);
+            m_data.moveRow(op.first, op.destination);
+            endMoveRows();
+            break;
+        case XmlListModelDiffOp::Insert:
+            beginInsertRows(QModelIndex(), op.first, op.last);
+            m_data.insertRows(op.first, result.data, op.first, op.last - op.first + 1);
+            m_size = m_data.count();
+            endInsertRows();
+            break;
+        case XmlListModelDiffOp::Change:
+            break;
+        }
+    }
 
-    if (origCount > 0) {
-        beginRemoveRows(QModelIndex(), 0, origCount - 1);
-        endRemoveRows();
+    // Kept rows still hold their old contents until here
+    m_data = result.data;
+    m_size = m_data.count();
+    for (const XmlListModelDiffOp &op : result.diff) {
+        if (op.type == XmlListModelDiffOp::Change)
+            Q_EMIT dataChanged(index(op.first, 0, QModelIndex()), index(op.last, 0, QModelIndex()));
     }
-    m_size = result.data.count();
+
+    if (m_size != origCount)
+        Q_EMIT countChanged();
+}
+
+void XmlListModel::applyOrder(const XmlListModelQueryResult &result)
+{
+    // Every row can move, so views are told that the layout has changed
+    // rather than about each move.
+    Q_EMIT layoutAboutToBeChanged();
+    QList<int> newRows(result.order.count());
+    for (int row = 0; row < result.order.count(); ++row)
+        newRows[result.order.at(row)] = row;
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.count());
+    for (const QModelIndex &index : from)
+        to.append(createIndex(newRows.at(index.row()), 0));
     m_data = result.data;
+    m_documentOrder = result.documentOrder;
+    changePersistentIndexList(from, to);
+    Q_EMIT layoutChanged();
+}
+
+QSharedPointer<const XmlListModelQueryPlan> XmlListModel::queryPlan() const
+{
+    // Compiled when the query or the roles change, then reused by every reload
+    if (!m_queryPlan) {
+        m_queryPlan = XmlListModelQueryEngine::compileQuery(m_query, m_roleObjects);
+        if (!m_queryPlan->error.isEmpty())
+            qmlWarning(this) << m_queryPlan->error;
+    }
+    return m_queryPlan;
+}
+
+void XmlListModel::invalidateQueryPlan()
+{
+    m_queryPlan.reset();
+}
+
+XmlListModelQueryOptions XmlListModel::queryOptions() const
+{
+    XmlListModelQueryOptions options;
+    options.lazyDecoding = m_lazyDecoding;
+    options.offset = m_offset;
+    if (m_limit >= 0) {
+        // Pages are appended as they are fetched, never diffed or sorted
+        options.limit = m_limit;
+        return options;
+    }
+
+    options.sortRole = roleIndex(m_sortRole);
+    options.sortOrder = m_sortOrder;
+    options.keyRole = roleIndex(m_keyRole);
+    if (options.keyRole == -1)
+        return options;
+
+    // New entries can only be put in front of sorted rows if they sort there
+    if (m_refreshing && m_appendOnly && m_size > 0 && options.sortRole == -1) {
+        // Every key is passed: an entry that was moved to the top of the feed
+        // hides no new ones after it, and an old one that comes back again
+        // is not added twice.
+        options.knownKeys.reserve(m_size);
+        for (int row = 0; row < m_size; ++row)
+            options.knownKeys.insert(m_data.value(row, options.keyRole));
+    } else {
+        options.previousData = m_data;
+    }
+    return options;
+}
+
+int XmlListModel::roleIndex(const QString &roleName) const
+{
+    if (roleName.isEmpty())
+        return -1;
+    for (int i = 0; i < m_roleObjects.count(); ++i) {
+        if (m_roleObjects.at(i)->elementName() == roleName)
+            return i;
+    }
+    return -1;
+}
+
+void XmlListModel::appendRows(const XmlListModelData &rows)
+{
+    const int origCount = m_size;
+
+    // The rows of the previous query stay visible until the first rows of
+    // the new one arrive.
+    if (m_resetPending) {
+        m_resetPending = false;
+        if (m_size > 0) {
+            beginRemoveRows(QModelIndex(), 0, m_size - 1);
+            m_data.clear();
+            m_documentOrder.clear();
+            m_size = 0;
+            endRemoveRows();
+        }
+    }
 
-    if (m_size > 0) {
-        beginInsertRows(QModelIndex(), 0, m_size - 1);
+    if (!rows.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_size, m_size + rows.count() - 1);
+        m_data.append(rows);
+        m_size = m_data.count();
+        while (!m_documentOrder.isEmpty() && m_documentOrder.count() < m_size)
+            m_documentOrder.append(m_documentOrder.count());
         endInsertRows();
     }
 
-    if (sizeChanged)
+    if (m_size != origCount)
         Q_EMIT countChanged();
+}
 
-    Q_EMIT statusChanged(m_status);
+void XmlListModel::prependRows(const XmlListModelData &rows)
+{
+    m_resetPending = false;
+    if (rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), 0, rows.count() - 1);
+    m_data.prepend(rows);
+    m_size = m_data.count();
+    // New entries come first in the document as well
+    if (!m_documentOrder.isEmpty()) {
+        for (int &documentRow : m_documentOrder)
+            documentRow += rows.count();
+        m_documentOrder = QList<int>(rows.count()) + m_documentOrder;
+        std::iota(m_documentOrder.begin(), m_documentOrder.begin() + rows.count(), 0);
+    }
+    endInsertRows();
+    Q_EMIT countChanged();
 }
 
 void XmlListModel::notifyQueryStarted(bool remoteSource)
 {
+    // A refresh keeps the status and rows until its results are applied
+    if (m_refreshing) {
+        m_resetPending = true;
+        return;
+    }
+
     m_progress = remoteSource ? 0.0 : 1.0;
     m_status = XmlListModel::Loading;
+    m_resetPending = true;
     m_errorString.clear();
     Q_EMIT progressChanged(m_progress);
     Q_EMIT statusChanged(m_status);
@@ -56,33 +56,289 @@
 #include <QQmlEngine>
 #include <QAbstractItemModel>
 #include <QThread>
+#include <QThreadPool>
 #include <QByteArray>
+#include <QCache>
+#include <QFile>
 #include <QMap>
 #include <QMutex>
+#include <QPointer>
 #include <QHash>
+#include <QSet>
+#include <QSharedPointer>
 #include <QStringList>
 #include <QTimer>
 #include <QUrl>
 #if QT_CONFIG(qml_network)
 #include <QNetworkRequest>
 #include <QNetworkReply>
-#include <QXmlStreamReader>
 #endif
+#include <QXmlStreamReader>
 
 
 class QQmlContext;
+class XmlListModelQueryEngine;
+
+// Where a role value that is decoded on demand lies in the source document
+struct XmlListModelSpan
+{
+    qint64 offset = -1;     // in bytes; -1 if the value is stored as a string
+    qint64 length = 0;
+
+    bool isNull() const { return offset < 0; }
+    bool operator==(const XmlListModelSpan &other) const
+    { return offset == other.offset && length == other.length; }
+};
+
+// The UTF-8 document a query read, kept for the values decoded on demand.
+// A downloaded document grows as it arrives, and its values can be read
+// from the part received so far while the worker appends to it.
+class XmlListModelSource
+{
+public:
+    XmlListModelSource();
+    XmlListModelSource(QFile *file, const uchar *mappedData);
+
+    // Only for the worker that appends to a growing source
+    const char *constData() const { return m_bytes; }
+    qint64 size() const { return m_size; }
+    void append(const QByteArray &data);
+    void squeeze();
+
+    QByteArray rawText(const XmlListModelSpan &span) const;
+    QString text(const XmlListModelSpan &span) const;
+
+    qsizetype memoryUsage() const;
+
+private:
+    Q_DISABLE_COPY(XmlListModelSource)
+
+    QByteArray m_data;
+    QScopedPointer<QFile> m_file;
+    const char *m_bytes;
+    qint64 m_size;
+    bool m_growing = false;
+    mutable QMutex m_mutex;
+};
+
+// Query results stored column by column: one contiguous array per role
+class XmlListModelData
+{
+public:
+    XmlListModelData() = default;
+    explicit XmlListModelData(int roleCount);
+
+    int count() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    int roleCount() const { return m_columns.count(); }
+
+    const QString &value(int row, int role) const;
+    bool isDeferred(int row, int role) const;
+    XmlListModelSpan span(int row, int role) const;
+    QString text(int row, int role) const;
+    bool rowEquals(int row, const XmlListModelData &other, int otherRow) const;
+    XmlListModelData reordered(const QList<int> &order) const;
+
+    bool hasDeferredValues() const { return !m_spans.isEmpty(); }
+    const QSharedPointer<const XmlListModelSource> &source() const { return m_source; }
+    void setSource(const QSharedPointer<const XmlListModelSource> &source) { m_source = source; }
+
+    void appendRow(const QList<QString> &row);
+    void appendRow(const QList<QString> &row, const QList<XmlListModelSpan> &spans);
+    void append(const XmlListModelData &other);
+    void prepend(const XmlListModelData &other);
+    void insertRows(int row, const XmlListModelData &other, int otherRow, int count);
+    void removeRows(int row, int count);
+    void moveRow(int from, int to);
+    void clear();
+
+    void write(QDataStream &stream) const;
+    bool read(QDataStream &stream);
+
+    qsizetype memoryUsage() const;
+
+    bool operator==(const XmlListModelData &other) const
+    {
+        return m_count == other.m_count && m_source == other.m_source
+                && m_columns == other.m_columns && m_spans == other.m_spans;
+    }
+    bool operator!=(const XmlListModelData &other) const
+    { return !(*this == other); }
+
+private:
+    void ensureRoleCount(int roleCount);
+    void ensureSpans();
+    bool mergeSource(const XmlListModelData &other);
+
+    QList<QList<QString> > m_columns;
+    // Empty unless some values are left in m_source; otherwise one per value
+    QList<QList<XmlListModelSpan> > m_spans;
+    QSharedPointer<const XmlListModelSource> m_source;
+    int m_count = 0;
+};
+
+// A query and its roles, compiled once and shared by every job that runs them
+struct XmlListModelQueryPlan
+{
+    struct Name
+    {
+        QString name;
+        size_t hash = 0;
+
+        bool matches(QStringView other, size_t otherHash) const
+        { return hash == otherHash && !name.isEmpty() && name == other; }
+    };
+
+    struct Role
+    {
+        Name element;
+        QString attribute;          // empty when the role is the element text
+        bool jpegLinksOnly = false;
+        void *errorId = nullptr;
+    };
+
+    // A condition on the row element, such as item[category='Tech'] or
+    // item[contains(@href, '.jpg')]. Attributes of the row are tested at its
+    // start tag, so rejected rows are skipped; child elements are only known
+    // at its end tag, so their values have been collected by then.
+    struct Predicate
+    {
+        enum Test { Equals, NotEquals, Contains };
+
+        Name element;               // empty when an attribute of the row is tested
+        QString attribute;
+        QString value;
+        Test test = Equals;
+
+        bool isAttributeTest() const { return element.name.isEmpty(); }
+        bool matches(QStringView text) const;
+    };
+
+    QList<Name> path;
+    QList<Predicate> predicates;
+    QList<Role> roles;
+    QByteArray signature;
+    QString error;
+};
+
+struct XmlListModelQueryOptions
+{
+    int keyRole = -1;
+    XmlListModelData previousData;
+    // Set for append-only refreshes: rows with any of these keys are skipped
+    QSet<QString> knownKeys;
+    bool lazyDecoding = false;
+    // Matching rows to skip, and to return before the query pauses; a limit
+    // of 0 returns no rows and never pauses
+    int offset = 0;
+    int limit = -1;
+    int sortRole = -1;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    // Where to store the parsed rows, with the validators of the reply
+    QString cacheFile;
+    QByteArray eTag;
+    QByteArray lastModified;
+};
+
+// What a query has cost so far on the worker threads; times in nanoseconds
+struct XmlListModelQueryStats
+{
+    qint64 bytes = 0;
+    qint64 queueWait = 0;
+    qint64 parseTime = 0;
+    int rows = 0;
+};
+
 struct XmlListModelQueryJob
 {
     int queryId;
     QByteArray data;
-    QString query;
-    QStringList roleNames;
-    QStringList roleQueries;
-    QList<void*> roleQueryErrorId;
+    qsizetype dataOffset = 0;
+    bool dataComplete = false;
+    bool running = false;
+    // Set once a page is complete, until more rows are asked for
+    bool paused = false;
+    int matchedRows = 0;
+    int rowLimit = -1;
+    QAtomicInt aborted;
+    // Set once data has been given to the job
+    bool started = false;
+    // A document job, without a plan, parses the data for its member
+    // queries, which point back at it. A member that needs no more of the
+    // document is stopped.
+    QList<QSharedPointer<XmlListModelQueryJob> > members;
+    XmlListModelQueryJob *document = nullptr;
+    bool stopped = false;
+    XmlListModelQueryStats stats;
+    // When the job was last queued for a worker
+    qint64 queuedAt = -1;
+    // Local sources are mapped and read by the worker instead
+    QString fileName;
+    QScopedPointer<QFile> file;
+    qint64 fileOffset = 0;
+    // The mapped file, or the downloaded document as it arrives
+    QSharedPointer<XmlListModelSource> source;
+    QSharedPointer<const XmlListModelQueryPlan> plan;
+    XmlListModelQueryOptions options;
+    XmlListModelData rows;
+    QList<QSet<QString> > internedValues;
+
+    // Parser state, kept between chunks while the source is still downloading
+    QXmlStreamReader reader;
+    int depth = 0;
+    int matchedDepth = 0;
+    int roleIndex = -1;
+    QString roleText;
+    QList<QString> row;
+
+    // Predicates of the current row; rows that fail them are dropped here
+    bool rowRejected = false;
+    int predicateIndex = -1;
+    QString predicateText;
+    QList<bool> predicateResults;
+
+    // Long values are left in the source when decoding lazily; character
+    // offsets of the reader are mapped to byte offsets as parsing goes on.
+    bool lazy = false;
+    bool encodingChecked = false;
+    bool roleDeferred = false;
+    qint64 roleStart = 0;
+    qint64 roleEnd = 0;
+    qint64 scannedCharacters = 0;
+    qint64 scannedBytes = 0;
+    QList<XmlListModelSpan> rowSpans;
+};
+struct XmlListModelDiffOp
+{
+    enum Type { Remove, Move, Insert, Change };
+    Type type;
+    int first;
+    int last;
+    int destination;
 };
+
 struct XmlListModelQueryResult {
     int queryId;
-    QList<QHash<int, QString> > data;
+    XmlListModelData data;
+    // Set for keyed queries: applying diff to diffBase yields data
+    bool keyed = false;
+    QList<XmlListModelDiffOp> diff;
+    XmlListModelData diffBase;
+    // Set for append-only refreshes: data goes in front of the current rows
+    bool prepend = false;
+    // Set when a page is complete and the query can be resumed
+    bool hasMore = false;
+    XmlListModelQueryStats stats;
+    // Set when rows were sorted again: data holds row order[i] of diffBase at i
+    bool reordered = false;
+    QList<int> order;
+    // Set when data is sorted: it holds row documentOrder[i] of the document at i
+    QList<int> documentOrder;
+    // Set for results read from the persistent cache
+    bool fromCache = false;
+    QByteArray eTag;
+    QByteArray lastModified;
 };
 
 class XmlListModelRole : public QObject
@@ -112,6 +368,91 @@ signals:
 
 };
 
+// Where the time of the last load went, for finding slow feeds
+class XmlListModelStats : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(qint64 bytesReceived READ bytesReceived NOTIFY changed)
+    Q_PROPERTY(qreal networkWait READ networkWait NOTIFY changed)
+    Q_PROPERTY(qreal queueWait READ queueWait NOTIFY changed)
+    Q_PROPERTY(qreal parseTime READ parseTime NOTIFY changed)
+    Q_PROPERTY(int rowsProduced READ rowsProduced NOTIFY changed)
+    Q_PROPERTY(qreal applyTime READ applyTime NOTIFY changed)
+    Q_PROPERTY(qreal totalTime READ totalTime NOTIFY changed)
+    QML_ANONYMOUS
+
+public:
+    explicit XmlListModelStats(QObject *parent = nullptr) : QObject(parent) {}
+
+    // Byte counts and row counts as they are, times in milliseconds
+    qint64 bytesReceived() const { return m_query.bytes; }
+    qreal networkWait() const { return m_networkWait / 1e6; }
+    qreal queueWait() const { return m_query.queueWait / 1e6; }
+    qreal parseTime() const { return m_query.parseTime / 1e6; }
+    int rowsProduced() const { return m_query.rows; }
+    qreal applyTime() const { return m_applyTime / 1e6; }
+    qreal totalTime() const { return m_totalTime / 1e6; }
+
+    void reset();
+    void setNetworkWait(qint64 networkWait);
+    void setQueryStats(const XmlListModelQueryStats &query);
+    void addApplyTime(qint64 applyTime);
+    void finish(qint64 totalTime);
+
+Q_SIGNALS:
+    void changed();
+
+private:
+    XmlListModelQueryStats m_query;
+    qint64 m_networkWait = 0;
+    qint64 m_applyTime = 0;
+    qint64 m_totalTime = 0;
+};
+
+#if QT_CONFIG(qml_network)
+// A request that is shared by every model loading the same source. Its data
+// goes to the query engine once, however many models use it.
+class XmlListModelDownload : public QObject
+{
+    Q_OBJECT
+public:
+    XmlListModelDownload(XmlListModelQueryEngine *engine, QNetworkReply *reply,
+                         const QByteArray &eTag, const QByteArray &lastModified);
+    ~XmlListModelDownload();
+
+    QNetworkReply *reply() const { return m_reply; }
+    QUrl url() const { return m_url; }
+    bool matches(const QByteArray &eTag, const QByteArray &lastModified) const
+    {
+        return m_eTag == eTag && m_lastModified == lastModified;
+    }
+
+    void addUser();
+    void release();
+    int startQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan, const XmlListModelQueryOptions &options);
+
+Q_SIGNALS:
+    void readyRead();
+    void finished();
+    void downloadProgress(qint64 received, qint64 total);
+
+private:
+    void replyReadyRead();
+    void replyFinished();
+
+    XmlListModelQueryEngine *m_engine;
+    QPointer<QNetworkReply> m_reply;
+    QUrl m_url;
+    QByteArray m_eTag;
+    QByteArray m_lastModified;
+    int m_documentId;
+    // Queries that could not join the document; each reads the data itself
+    QList<int> m_queries;
+    int m_users;
+    bool m_finished;
+};
+#endif
+
 class XmlListModel : public QAbstractListModel, public QQmlParserStatus
 {
     Q_OBJECT
@@ -121,18 +462,30 @@ class XmlListModel : public QAbstractListModel, public QQmlParserStatus
     Q_PROPERTY(qreal progress READ progress NOTIFY progressChanged)
     Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
     Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(QString keyRole READ keyRole WRITE setKeyRole NOTIFY keyRoleChanged)
+    Q_PROPERTY(bool persistentCache READ persistentCache WRITE setPersistentCache NOTIFY persistentCacheChanged)
+    Q_PROPERTY(int refreshInterval READ refreshInterval WRITE setRefreshInterval NOTIFY refreshIntervalChanged)
+    Q_PROPERTY(bool appendOnly READ appendOnly WRITE setAppendOnly NOTIFY appendOnlyChanged)
+    Q_PROPERTY(bool lazyDecoding READ lazyDecoding WRITE setLazyDecoding NOTIFY lazyDecodingChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(int offset READ offset WRITE setOffset NOTIFY offsetChanged)
+    Q_PROPERTY(QString sortRole READ sortRole WRITE setSortRole NOTIFY sortRoleChanged)
+    Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
     Q_PROPERTY(QQmlListProperty<XmlListModelRole> roles READ roleObjects)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(XmlListModelStats *stats READ stats CONSTANT)
     QML_ELEMENT
 
 public:
     XmlListModel(QObject *parent = nullptr);
-    ~XmlListModel() = default;
+    ~XmlListModel();
 
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     int rowCount(const QModelIndex &parent) const override;
     QVariant data(const QModelIndex &index, int role) const override;
     QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
 
     int count() const;
 
@@ -142,6 +495,33 @@ public:
     QString query() const;
     void setQuery(const QString&);
 
+    QString keyRole() const;
+    void setKeyRole(const QString&);
+
+    bool persistentCache() const;
+    void setPersistentCache(bool);
+
+    int refreshInterval() const;
+    void setRefreshInterval(int);
+
+    bool appendOnly() const;
+    void setAppendOnly(bool);
+
+    bool lazyDecoding() const;
+    void setLazyDecoding(bool);
+
+    int limit() const;
+    void setLimit(int);
+
+    int offset() const;
+    void setOffset(int);
+
+    QString sortRole() const;
+    void setSortRole(const QString&);
+
+    Qt::SortOrder sortOrder() const;
+    void setSortOrder(Qt::SortOrder);
+
     QQmlListProperty<XmlListModelRole> roleObjects();
 
     void appendRole(XmlListModelRole*);
@@ -154,6 +534,11 @@ public:
 
     Q_INVOKABLE QString errorString() const;
 
+    // The rows, the parts of the document they refer to, and decoded values
+    qsizetype memoryUsage() const;
+
+    XmlListModelStats *stats() const;
+
     void classBegin() override;
     void componentComplete() override;
 
@@ -163,102 +548,186 @@ Q_SIGNALS:
     void countChanged();
     void sourceChanged();
     void queryChanged();
+    void keyRoleChanged();
+    void persistentCacheChanged();
+    void refreshIntervalChanged();
+    void appendOnlyChanged();
+    void lazyDecodingChanged();
+    void limitChanged();
+    void offsetChanged();
+    void sortRoleChanged();
+    void sortOrderChanged();
 
 public Q_SLOTS:
     void reload();
+    void refresh();
 
 private Q_SLOTS:
 #if QT_CONFIG(qml_network)
+    void requestReadyRead();
     void requestFinished();
+    void cacheLoaded(const XmlListModelQueryResult &);
 #endif
     void requestProgress(qint64,qint64);
     void dataCleared();
+    void queryRowsAvailable(const XmlListModelQueryResult &);
     void queryCompleted(const XmlListModelQueryResult &);
     void queryError(void* object, const QString& error);
 
 private:
     Q_DISABLE_COPY(XmlListModel)
 
+    void load(bool refreshing);
     void notifyQueryStarted(bool remoteSource);
+    void appendRows(const XmlListModelData &rows);
+    void prependRows(const XmlListModelData &rows);
+    void updateRefreshTimer();
+    QString decodedValue(int row, int role) const;
+    void applyDiff(const XmlListModelQueryResult &result);
+    void applyOrder(const XmlListModelQueryResult &result);
+    void sortAgain();
+    int roleIndex(const QString &roleName) const;
+    XmlListModelQueryOptions queryOptions() const;
+    QSharedPointer<const XmlListModelQueryPlan> queryPlan() const;
+    void invalidateQueryPlan();
 
     static void appendRole(QQmlListProperty<XmlListModelRole>*, XmlListModelRole*);
     static void clearRole(QQmlListProperty<XmlListModelRole>*);
 
 #if QT_CONFIG(qml_network)
+    void sendRequest(const QByteArray &eTag, const QByteArray &lastModified);
     void deleteReply();
+    QString cacheFileName() const;
+    bool isCacheable() const;
 
-    QNetworkReply *m_reply;
+    QPointer<XmlListModelDownload> m_download;
+    QByteArray m_eTag;
+    QByteArray m_lastModified;
 #endif
 
     int m_size;
     QUrl m_source;
     QString m_query;
+    QString m_keyRole;
+    QString m_sortRole;
+    Qt::SortOrder m_sortOrder;
     QStringList m_roleNames;
     QList<int> m_roles;
+    QList<int> m_roleColumns;
     QList<XmlListModelRole *> m_roleObjects;
-    QList<QHash<int, QString> > m_data;
+    mutable QSharedPointer<const XmlListModelQueryPlan> m_queryPlan;
+    XmlListModelData m_data;
+    // The row of the document each row was read from; empty while the rows
+    // are in document order
+    QList<int> m_documentOrder;
+    mutable QCache<qint64, QString> m_decodedValues;
+    mutable QWeakPointer<const XmlListModelSource> m_decodedSource;
     bool m_isComponentComplete;
+    bool m_resetPending;
+    bool m_persistentCache;
+    bool m_appendOnly;
+    bool m_lazyDecoding;
+    bool m_canFetchMore;
+    int m_limit;
+    int m_offset;
+    bool m_refreshing;
+    bool m_sortPending;
+    QTimer m_refreshTimer;
+    XmlListModelStats *m_stats;
+    // Start of the current load, and of its request
+    qint64 m_loadStarted;
+    qint64 m_requestStarted;
     Status m_status;
     QString m_errorString;
     qreal m_progress;
     int m_queryId;
+    int m_cacheQueryId;
     int m_redirectCount;
     int m_highestRole;
 
 };
 
-class XmlListModelQueryThreadObject;
-
-class XmlListModelQueryEngine : public QThread
+class XmlListModelQueryEngine : public QObject
 {
     Q_OBJECT
 public:
     XmlListModelQueryEngine(QQmlEngine *eng);
     ~XmlListModelQueryEngine();
 
-    int doQuery(QString query, QByteArray data, QList<XmlListModelRole *>* roles);
+    static QSharedPointer<const XmlListModelQueryPlan> compileQuery(const QString &query,
+                                                                    const QList<XmlListModelRole *> &roles);
+
+    int doQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan, const QByteArray &data,
+                const XmlListModelQueryOptions &options = XmlListModelQueryOptions());
+    int doFileQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan, const QString &fileName,
+                    const XmlListModelQueryOptions &options = XmlListModelQueryOptions());
+    int startDocument();
+    int startQuery(const QSharedPointer<const XmlListModelQueryPlan> &plan,
+                   const XmlListModelQueryOptions &options = XmlListModelQueryOptions(),
+                   int documentId = -1, bool *joined = nullptr);
+    void appendData(int id, const QByteArray &data);
+    void finishData(int id);
+    void fetchMore(int id, int count);
     void abort(int id);
 
-    void processJobs();
+    int loadCache(const QString &fileName, const QSharedPointer<const XmlListModelQueryPlan> &plan);
+    int sortRows(const XmlListModelData &rows, const QList<int> &documentOrder, int role, Qt::SortOrder order);
+
+    static QList<int> sortPermutation(const XmlListModelData &rows, int role, Qt::SortOrder order);
 
     static XmlListModelQueryEngine *instance(QQmlEngine *engine);
 
+#if QT_CONFIG(qml_network)
+    XmlListModelDownload *download(const QUrl &url, const QByteArray &eTag, const QByteArray &lastModified);
+    void removeDownload(XmlListModelDownload *download);
+#endif
+
 signals:
+    void cacheLoaded(const XmlListModelQueryResult &);
+    void rowsAvailable(const XmlListModelQueryResult &);
     void queryCompleted(const XmlListModelQueryResult &);
     void error(void*, const QString&);
 
-protected:
-    void run() override;
-
 private:
-    void processQuery(XmlListModelQueryJob *job);
-    void doQueryJob(XmlListModelQueryJob *job, XmlListModelQueryResult *currentResult);
-    void processElement(XmlListModelQueryJob *currentJob, XmlListModelQueryResult*& currentResult, QString element, QXmlStreamReader &reader);
+    enum TokenResult { ContinueParsing, StopParsing, PauseParsing };
+
+    int nextQueryId();
+    void scheduleJob(const QSharedPointer<XmlListModelQueryJob> &job);
+    void processJobs();
+    void processQuery(const QSharedPointer<XmlListModelQueryJob> &job, const QByteArray &data, bool dataComplete);
+    void processDocument(const QSharedPointer<XmlListModelQueryJob> &document, const QByteArray &data, bool dataComplete);
+    void finishSlice(const QSharedPointer<XmlListModelQueryJob> &job, XmlListModelQueryResult *currentResult,
+                     bool finished, bool dataComplete);
+    bool doQueryJob(XmlListModelQueryJob *job, XmlListModelQueryResult *currentResult);
+    bool doDocumentJob(XmlListModelQueryJob *document, QList<XmlListModelQueryResult> *results);
+    TokenResult processToken(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader,
+                             XmlListModelQueryResult *currentResult);
+    void processElement(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader);
+    static void beginRow(XmlListModelQueryJob *currentJob, const QXmlStreamReader &reader);
+    static bool endRow(XmlListModelQueryJob *currentJob);
+    static void storeRoleValue(XmlListModelQueryJob *currentJob, int index, const QString &value);
+    static void internRowValues(XmlListModelQueryJob *currentJob);
+    static void deferRoleValue(XmlListModelQueryJob *currentJob, int index);
+    void publishResult(const QSharedPointer<XmlListModelQueryJob> &job, XmlListModelQueryResult result, bool finished);
+    static bool diffRows(const XmlListModelData &oldRows, const XmlListModelData &newRows,
+                         int keyRole, QList<XmlListModelDiffOp> *diff);
 
     QMutex m_mutex;
-    XmlListModelQueryThreadObject *m_threadObject;
-    QList<XmlListModelQueryJob> m_jobs;
-    QSet<int> m_cancelledJobs;
+    QThreadPool m_threadPool;
+    int m_activeWorkers;
+    int m_busyWorkers;
+    QHash<int, QSharedPointer<XmlListModelQueryJob> > m_jobs;
+    QList<int> m_pendingJobs;
     QAtomicInt m_queryIds;
 
     QQmlEngine *m_engine;
-    QObject *m_eventLoopQuitHack;
+#if QT_CONFIG(qml_network)
+    // Downloads that are still running, by source
+    QMultiHash<QUrl, XmlListModelDownload *> m_downloads;
+#endif
 
     static QHash<QQmlEngine *, XmlListModelQueryEngine*> queryEngines;
     static QMutex queryEnginesMutex;
 };
 
-class XmlListModelQueryThreadObject : public QObject
-{
-    Q_OBJECT
-public:
-    XmlListModelQueryThreadObject(XmlListModelQueryEngine *);
-
-    void processJobs();
-    bool event(QEvent *e) override;
-
-private:
-    XmlListModelQueryEngine *m_queryEngine;
-};
-
 #endif
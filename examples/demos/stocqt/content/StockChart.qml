@@ -50,6 +50,7 @@
 
 import QtQuick
 import QtQuick.Layouts
+import StocQt
 import "."
 
 Rectangle {
@@ -61,7 +62,7 @@ Rectangle {
     property string activeChart: "week"
     property var settings
     property int gridSize: 4
-    property real gridStep: gridSize ? (canvas.width - canvas.tickMargin) / gridSize : canvas.xGridStep
+    property real gridStep: gridSize ? (plotArea.width - plotArea.tickMargin) / gridSize : plotArea.xGridStep
 
     function update() {
         endDate = new Date(stockModel.newest);
@@ -89,8 +90,6 @@ Rectangle {
                                        stockModel.newest.getDate() - 7);
             gridSize = 0;
         }
-
-        canvas.requestPaint();
     }
 
     GridLayout {
@@ -138,63 +137,17 @@ Rectangle {
             }
         }
 
-        Canvas {
-            id: canvas
+        Item {
+            id: plotArea
             Layout.fillWidth: true
             Layout.fillHeight: true
             Layout.columnSpan: 6
-            // Uncomment below lines to use OpenGL hardware accelerated rendering.
-            // See Canvas documentation for available options.
-            // renderTarget: Canvas.FramebufferObject
-            // renderStrategy: Canvas.Threaded
 
-            property int pixelSkip: 1
-            property int numPoints: 1
             property int tickMargin: 34
 
-            property real xGridStep: (canvas.width - tickMargin) / numPoints
-            property real yGridOffset: canvas.height / 26
-            property real yGridStep: canvas.height / 12
-
-            function drawBackground(ctx) {
-                ctx.save();
-                ctx.fillStyle = "#ffffff";
-                ctx.fillRect(0, 0, canvas.width, canvas.height);
-                ctx.strokeStyle = "#d7d7d7";
-                ctx.beginPath();
-                // Horizontal grid lines
-                for (var i = 0; i < 12; i++) {
-                    ctx.moveTo(0, canvas.yGridOffset + i * canvas.yGridStep);
-                    ctx.lineTo(canvas.width, canvas.yGridOffset + i * canvas.yGridStep);
-                }
-
-                // Vertical grid lines
-                var height = 35 * canvas.height / 36;
-                var yOffset = canvas.height - height;
-                var xOffset = 0;
-                for (i = 0; i < chart.gridSize; i++) {
-                    ctx.moveTo(xOffset + i * chart.gridStep, yOffset);
-                    ctx.lineTo(xOffset + i * chart.gridStep, height);
-                }
-                ctx.stroke();
-
-                // Right ticks
-                ctx.strokeStyle = "#666666";
-                ctx.beginPath();
-                var xStart = canvas.width - tickMargin;
-                ctx.moveTo(xStart, 0);
-                ctx.lineTo(xStart, canvas.height);
-                for (i = 0; i < 12; i++) {
-                    ctx.moveTo(xStart, canvas.yGridOffset + i * canvas.yGridStep);
-                    ctx.lineTo(canvas.width, canvas.yGridOffset + i * canvas.yGridStep);
-                }
-                ctx.moveTo(0, canvas.yGridOffset + 9 * canvas.yGridStep);
-                ctx.lineTo(canvas.width, canvas.yGridOffset + 9 * canvas.yGridStep);
-                ctx.closePath();
-                ctx.stroke();
-
-                ctx.restore();
-            }
+            property real xGridStep: (width - tickMargin) / Math.max(plot.count, 1)
+            property real yGridOffset: height / 26
+            property real yGridStep: height / 12
 
             // Returns a shortened, readable version of the potentially
             // large volume number.
@@ -211,173 +164,115 @@ Rectangle {
                 return shortVal + "KMBTG".charAt(exponent - 1);
             }
 
-            function drawScales(ctx, high, low, vol)
-            {
-                ctx.save();
-                ctx.strokeStyle = "#888888";
-                ctx.font = "10px Open Sans"
-
-                ctx.beginPath();
-
-                // prices on y-axis
-                var x = canvas.width - tickMargin + 3;
-                var priceStep = (high - low) / 9.0;
-                for (var i = 0; i < 10; i += 2) {
-                    var price = parseFloat(high - i * priceStep).toFixed(1);
-                    ctx.text(price, x, canvas.yGridOffset + i * yGridStep - 2);
-                }
-
-                // volume scale
-                for (i = 0; i < 3; i++) {
-                    var volume = volumeToString(vol - (i * (vol/3)));
-                    ctx.text(volume, x, canvas.yGridOffset + (i + 9) * yGridStep + 10);
-                }
-
-                ctx.closePath();
-                ctx.stroke();
-                ctx.restore();
+            Rectangle {
+                anchors.fill: parent
+                color: "#ffffff"
             }
 
-            function drawPrice(ctx, from, to, color, price, points, highest, lowest)
-            {
-                ctx.save();
-                ctx.globalAlpha = 0.7;
-                ctx.strokeStyle = color;
-
-                ctx.lineWidth = numPoints > 200 ? 1 : 3
-
-                ctx.beginPath();
-
-                var end = points.length;
-
-                var range = highest - lowest;
-                if (range == 0) {
-                    range = 1;
-                }
-
-                for (var i = 0; i < end; i += pixelSkip) {
-                    var x = points[i].x;
-                    var y = points[i][price];
-                    var h = 9 * yGridStep;
-
-                    y = h * (lowest - y)/range + h + yGridOffset;
-
-                    if (i == 0) {
-                        ctx.moveTo(x, y);
-                    } else {
-                        ctx.lineTo(x, y);
+            // Horizontal grid lines, with ticks on the right
+            Repeater {
+                model: 12
+                Rectangle {
+                    y: plotArea.yGridOffset + index * plotArea.yGridStep
+                    width: plotArea.width
+                    height: 1
+                    color: index === 9 ? "#666666" : "#d7d7d7"
+                    Rectangle {
+                        x: plotArea.width - plotArea.tickMargin
+                        width: plotArea.tickMargin
+                        height: 1
+                        color: "#666666"
                     }
                 }
-                ctx.stroke();
-                ctx.restore();
             }
 
-            function drawVolume(ctx, from, to, color, price, points, highest)
-            {
-                ctx.save();
-                ctx.fillStyle = color;
-                ctx.globalAlpha = 0.8;
-                ctx.lineWidth = 0;
-                ctx.beginPath();
-
-                var end = points.length;
-                var margin = 0;
-
-                if (chart.activeChart === "month" || chart.activeChart === "week") {
-                    margin = 8;
-                    ctx.shadowOffsetX = 4;
-                    ctx.shadowBlur = 3.5;
-                    ctx.shadowColor = Qt.darker(color);
-                }
-
-                // To match the volume graph with price grid, skip drawing the initial
-                // volume of the first day on chart.
-                for (var i = 1; i < end; i += pixelSkip) {
-                    var x = points[i - 1].x;
-                    var y = points[i][price];
-                    y = canvas.height * (y / highest);
-                    y = 3 * y / 12;
-                    ctx.fillRect(x, canvas.height - y + yGridOffset,
-                                 canvas.xGridStep - margin, y);
+            // Vertical grid lines
+            Repeater {
+                model: chart.gridSize ? chart.gridSize : plot.count
+                Rectangle {
+                    x: index * chart.gridStep
+                    y: plotArea.height / 36
+                    width: 1
+                    height: 34 * plotArea.height / 36
+                    color: "#d7d7d7"
                 }
-
-                ctx.stroke();
-                ctx.restore();
             }
 
-            function drawError(ctx, msg)
-            {
-                ctx.save();
-                ctx.strokeStyle = "#888888";
-                ctx.font = "24px Open Sans"
-                ctx.textAlign = "center"
-                ctx.shadowOffsetX = 4;
-                ctx.shadowOffsetY = 4;
-                ctx.shadowBlur = 1.5;
-                ctx.shadowColor = "#aaaaaa";
-                ctx.beginPath();
-
-                ctx.fillText(msg, (canvas.width - tickMargin) / 2,
-                             (canvas.height - yGridOffset - yGridStep) / 2);
-
-                ctx.closePath();
-                ctx.stroke();
-                ctx.restore();
+            Rectangle {
+                x: plotArea.width - plotArea.tickMargin
+                width: 1
+                height: plotArea.height
+                color: "#666666"
             }
 
-            onPaint: {
-                numPoints = stockModel.indexOf(chart.startDate);
-                if (chart.gridSize == 0)
-                    chart.gridSize = numPoints
-
-                var ctx = canvas.getContext("2d");
-                ctx.globalCompositeOperation = "source-over";
-                ctx.lineWidth = 1;
-
-                drawBackground(ctx);
+            StockPlot {
+                id: plot
+                width: plotArea.width - plotArea.tickMargin
+                height: plotArea.height
+                visible: chart.stockModel !== null && chart.stockModel.ready
+
+                model: chart.stockModel
+                startDate: chart.startDate
+                endDate: chart.endDate
+
+                drawHighPrice: chart.settings.drawHighPrice
+                drawLowPrice: chart.settings.drawLowPrice
+                drawOpenPrice: chart.settings.drawOpenPrice
+                drawClosePrice: chart.settings.drawClosePrice
+                highColor: chart.settings.highColor
+                lowColor: chart.settings.lowColor
+                openColor: chart.settings.openColor
+                closeColor: chart.settings.closeColor
+                volumeColor: chart.settings.volumeColor
+
+                priceTop: plotArea.yGridOffset
+                priceBottom: plotArea.yGridOffset + 9 * plotArea.yGridStep
+                volumeHeight: 3 * plotArea.yGridStep - plotArea.yGridOffset
+                lineWidth: count > 200 ? 1 : 3
+                barSpacing: chart.activeChart === "month" || chart.activeChart === "week" ? 8 : 0
+            }
 
-                if (!stockModel.ready) {
-                    drawError(ctx, "No data available.");
-                    return;
+            // Prices on the y-axis
+            Repeater {
+                model: 5
+                Text {
+                    x: plotArea.width - plotArea.tickMargin + 3
+                    y: plotArea.yGridOffset + 2 * index * plotArea.yGridStep - 2 - baselineOffset
+                    visible: plot.visible
+                    color: "#888888"
+                    font.family: Settings.fontFamily
+                    font.pixelSize: 10
+                    text: (plot.highestPrice - 2 * index * (plot.highestPrice - plot.lowestPrice) / 9).toFixed(1)
                 }
+            }
 
-                var highestPrice = 0;
-                var highestVolume = 0;
-                var lowestPrice = -1;
-                var points = [];
-                for (var i = numPoints, j = 0; i >= 0 ; i -= pixelSkip, j += pixelSkip) {
-                    var price = stockModel.get(i);
-                    if (parseFloat(highestPrice) < parseFloat(price.high))
-                        highestPrice = price.high;
-                    if (parseInt(highestVolume, 10) < parseInt(price.volume, 10))
-                        highestVolume = price.volume;
-                    if (lowestPrice < 0 || parseFloat(lowestPrice) > parseFloat(price.low))
-                        lowestPrice = price.low;
-                    points.push({
-                                    x: j * xGridStep,
-                                    open: price.open,
-                                    close: price.close,
-                                    high: price.high,
-                                    low: price.low,
-                                    volume: price.volume
-                                });
+            // Volume scale
+            Repeater {
+                model: 3
+                Text {
+                    x: plotArea.width - plotArea.tickMargin + 3
+                    y: plotArea.yGridOffset + (index + 9) * plotArea.yGridStep + 10 - baselineOffset
+                    visible: plot.visible
+                    color: "#888888"
+                    font.family: Settings.fontFamily
+                    font.pixelSize: 10
+                    text: plotArea.volumeToString(plot.highestVolume - index * plot.highestVolume / 3)
                 }
+            }
 
-                if (settings.drawHighPrice)
-                    drawPrice(ctx, 0, numPoints, settings.highColor, "high", points, highestPrice, lowestPrice);
-                if (settings.drawLowPrice)
-                    drawPrice(ctx, 0, numPoints, settings.lowColor, "low", points, highestPrice, lowestPrice);
-                if (settings.drawOpenPrice)
-                    drawPrice(ctx, 0, numPoints,settings.openColor, "open", points, highestPrice, lowestPrice);
-                if (settings.drawClosePrice)
-                    drawPrice(ctx, 0, numPoints, settings.closeColor, "close", points, highestPrice, lowestPrice);
-
-                drawVolume(ctx, 0, numPoints, settings.volumeColor, "volume", points, highestVolume);
-                drawScales(ctx, highestPrice, lowestPrice, highestVolume);
+            Text {
+                x: (plotArea.width - plotArea.tickMargin - width) / 2
+                y: (plotArea.height - plotArea.yGridOffset - plotArea.yGridStep) / 2 - baselineOffset
+                visible: !plot.visible
+                color: "#888888"
+                style: Text.Raised
+                styleColor: "#aaaaaa"
+                font.family: Settings.fontFamily
+                font.pixelSize: 24
+                text: "No data available."
             }
         }
 
-
         Text {
             id: fromDate
             color: "#000000"
@@ -392,7 +287,7 @@ Rectangle {
             font.family: Settings.fontFamily
             font.pointSize: 8
             Layout.alignment: Qt.AlignRight
-            Layout.rightMargin: canvas.tickMargin
+            Layout.rightMargin: plotArea.tickMargin
             Layout.columnSpan: 5
             text: endDate.toDateString() + " |"
         }
@@ -100,10 +100,6 @@ Rectangle {
                 Layout.fillHeight: true
                 Layout.preferredWidth: 400
                 Layout.bottomMargin: 5
-                onDrawOpenPriceChanged: root.update()
-                onDrawClosePriceChanged: root.update();
-                onDrawHighPriceChanged: root.update();
-                onDrawLowPriceChanged: root.update();
             }
         }
     }
@@ -0,0 +1,600 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "stockmodel.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QQmlFile>
+#include <QThreadPool>
+
+#include <algorithm>
+
+/*
+The prices of one stock, read from a CSV file with a Date, Open, High, Low,
+Close and Volume column. The file is parsed on the thread pool straight
+into one array per column, and the model is reset with all of them at
+once, so that loading a long history creates no object per row.
+*/
+
+static const qint64 MSecsPerDay = 24 * 60 * 60 * 1000;
+// QDate::toJulianDay() of 1970-01-01
+static const qint64 EpochJulianDay = 2440588;
+
+enum Column { DateColumn, OpenColumn, HighColumn, LowColumn, CloseColumn, VolumeColumn, ColumnCount };
+
+namespace {
+
+struct Field
+{
+    const char *begin = nullptr;
+    const char *end = nullptr;
+
+    bool isEmpty() const { return begin == end; }
+};
+
+}
+
+// Splits a line at commas, trimming whitespace and quotes. Returns the number of fields.
+static int splitFields(const char *begin, const char *end, Field *fields, int maximumFields)
+{
+    int count = 0;
+    while (count < maximumFields) {
+        const char *comma = std::find(begin, end, ',');
+        Field field{begin, comma};
+        while (field.begin < field.end && (*field.begin == ' ' || *field.begin == '"'))
+            ++field.begin;
+        while (field.end > field.begin && (field.end[-1] == ' ' || field.end[-1] == '"' || field.end[-1] == '\r'))
+            --field.end;
+        fields[count++] = field;
+        if (comma == end)
+            break;
+        begin = comma + 1;
+    }
+    return count;
+}
+
+// Reads dates such as 2017-12-29, optionally followed by a time such as 09:30 or 09:30:00
+static bool parseDate(Field field, qint64 *msecs)
+{
+    const char *p = field.begin;
+    auto digits = [&p, &field](int n, int *value) {
+        if (field.end - p < n)
+            return false;
+        int result = 0;
+        for (int i = 0; i < n; ++i, ++p) {
+            if (*p < '0' || *p > '9')
+                return false;
+            result = result * 10 + (*p - '0');
+        }
+        *value = result;
+        return true;
+    };
+    auto skip = [&p, &field](char c) {
+        if (p == field.end || *p != c)
+            return false;
+        ++p;
+        return true;
+    };
+
+    int year, month, day;
+    int hour = 0, minute = 0, second = 0;
+    if (!digits(4, &year) || !skip('-') || !digits(2, &month) || !skip('-') || !digits(2, &day))
+        return false;
+    if (skip(' ') || skip('T')) {
+        if (!digits(2, &hour) || !skip(':') || !digits(2, &minute))
+            return false;
+        if (skip(':') && !digits(2, &second))
+            return false;
+    }
+    if (p != field.end)
+        return false;
+
+    const QDate date(year, month, day);
+    const QTime time(hour, minute, second);
+    if (!date.isValid() || !time.isValid())
+        return false;
+    *msecs = (date.toJulianDay() - EpochJulianDay) * MSecsPerDay + time.msecsSinceStartOfDay();
+    return true;
+}
+
+static bool parseNumber(Field field, double *value)
+{
+    bool ok = false;
+    *value = QByteArray::fromRawData(field.begin, int(field.end - field.begin)).toDouble(&ok);
+    return ok;
+}
+
+/*
+Builds the indexes of the highest and lowest prices, and of the highest
+volume, of any range of rows. This takes O(n log n) time and memory.
+*/
+void StockColumns::buildRangeIndexes()
+{
+    highIndex.build(high, true);
+    lowIndex.build(low, false);
+    volumeIndex.build(volume, true);
+}
+
+/*
+Shared between a model and the thread pool job loading a file for it.
+The job only delivers to the model while it still wants the result.
+*/
+struct StockModelJob : public QEnableSharedFromThis<StockModelJob>
+{
+    QMutex mutex;
+    StockModel *model = nullptr;
+
+    void deliver(const StockColumns &columns, const QString &errorString)
+    {
+        QMutexLocker locker(&mutex);
+        if (!model)
+            return;
+        StockModel *target = model;
+        // The call keeps the job alive, or a newer one could get its address
+        const QSharedPointer<StockModelJob> job = sharedFromThis();
+        QMetaObject::invokeMethod(target, [target, job, columns, errorString]() {
+            // Superseded by another load after this one was queued
+            if (target->m_job != job)
+                return;
+            target->loaded(columns, errorString);
+        }, Qt::QueuedConnection);
+    }
+};
+
+StockModel::StockModel(QObject *parent) : QAbstractListModel(parent)
+    , m_ready(false)
+{
+}
+
+StockModel::~StockModel()
+{
+    cancel();
+}
+
+/*
+The folder containing a <stockId>.csv file for each stock. It may be
+relative to the document that creates the model.
+*/
+QUrl StockModel::dataFolder() const
+{
+    return m_dataFolder;
+}
+
+void StockModel::setDataFolder(const QUrl &dataFolder)
+{
+    if (m_dataFolder == dataFolder)
+        return;
+    m_dataFolder = dataFolder;
+    emit dataFolderChanged();
+}
+
+QString StockModel::stockId() const
+{
+    return m_stockId;
+}
+
+void StockModel::setStockId(const QString &stockId)
+{
+    if (m_stockId == stockId)
+        return;
+    m_stockId = stockId;
+    emit stockIdChanged();
+}
+
+QString StockModel::stockName() const
+{
+    return m_stockName;
+}
+
+void StockModel::setStockName(const QString &stockName)
+{
+    if (m_stockName == stockName)
+        return;
+    m_stockName = stockName;
+    emit stockNameChanged();
+}
+
+QDateTime StockModel::newest() const
+{
+    if (m_columns.size() == 0)
+        return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(m_columns.date.first(), Qt::UTC);
+}
+
+QDateTime StockModel::oldest() const
+{
+    if (m_columns.size() == 0)
+        return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(m_columns.date.last(), Qt::UTC);
+}
+
+// Whether the prices of the current stock have been loaded
+bool StockModel::ready() const
+{
+    return m_ready;
+}
+
+// The latest closing price
+double StockModel::stockPrice() const
+{
+    return m_columns.size() > 0 ? m_columns.close.first() : 0.0;
+}
+
+// The difference between the latest two closing prices, rounded to cents
+double StockModel::stockPriceChanged() const
+{
+    if (m_columns.size() < 2)
+        return 0.0;
+    return qRound((m_columns.close.at(0) - m_columns.close.at(1)) * 100) / 100.0;
+}
+
+int StockModel::count() const
+{
+    return m_columns.size();
+}
+
+const StockColumns &StockModel::columns() const
+{
+    return m_columns;
+}
+
+int StockModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_columns.size();
+}
+
+QVariant StockModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid | CheckIndexOption::ParentIsInvalid))
+        return QVariant();
+
+    const int row = index.row();
+    switch (role) {
+    case DateRole:
+        return QDateTime::fromMSecsSinceEpoch(m_columns.date.at(row), Qt::UTC);
+    case OpenRole:
+        return m_columns.open.at(row);
+    case HighRole:
+        return m_columns.high.at(row);
+    case LowRole:
+        return m_columns.low.at(row);
+    case CloseRole:
+        return m_columns.close.at(row);
+    case VolumeRole:
+        return m_columns.volume.at(row);
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> StockModel::roleNames() const
+{
+    return {
+        { DateRole, "date" },
+        { OpenRole, "open" },
+        { HighRole, "high" },
+        { LowRole, "low" },
+        { CloseRole, "close" },
+        { VolumeRole, "volume" }
+    };
+}
+
+// Returns the prices of a row as an object with a property for each role
+QVariantMap StockModel::get(int row) const
+{
+    QVariantMap result;
+    if (row < 0 || row >= m_columns.size())
+        return result;
+    const QHash<int, QByteArray> roles = roleNames();
+    const QModelIndex index = this->index(row);
+    for (auto it = roles.cbegin(); it != roles.cend(); ++it)
+        result.insert(QString::fromLatin1(it.value()), data(index, it.key()));
+    return result;
+}
+
+/*
+Returns the row after the one closest to the date, so that a chart
+starting there begins at or before the date. Dates after the newest row
+are taken as a week before it, and dates before the oldest give the oldest.
+The dates are sorted, so the row is found by binary search.
+*/
+int StockModel::indexOf(const QDateTime &date) const
+{
+    const int count = m_columns.size();
+    if (count == 0 || !date.isValid())
+        return -1;
+
+    const qint64 newest = m_columns.date.first();
+    qint64 time = date.toMSecsSinceEpoch();
+    if (newest <= time)
+        time = newest - 7 * MSecsPerDay;
+    if (m_columns.date.last() >= time)
+        return count - 1;
+
+    // Between the rows either side of the date, the newer one wins a tie
+    int closest = firstRowAtOrBefore(time);
+    if (closest == count
+            || (closest > 0 && m_columns.date.at(closest - 1) - time <= time - m_columns.date.at(closest))) {
+        --closest;
+    }
+    return qMin(closest + 1, count - 1);
+}
+
+/*
+Returns the row of the oldest price from startDate to endDate inclusive,
+or -1 if there is none.
+*/
+int StockModel::startRow(const QDateTime &startDate, const QDateTime &endDate) const
+{
+    if (!startDate.isValid() || !endDate.isValid())
+        return -1;
+    const int start = firstRowBefore(startDate.toMSecsSinceEpoch()) - 1;
+    const int end = firstRowAtOrBefore(endDate.toMSecsSinceEpoch());
+    return start >= end ? start : -1;
+}
+
+/*
+Returns the row of the newest price from startDate to endDate inclusive,
+or -1 if there is none.
+*/
+int StockModel::endRow(const QDateTime &startDate, const QDateTime &endDate) const
+{
+    if (!startDate.isValid() || !endDate.isValid())
+        return -1;
+    const int start = firstRowBefore(startDate.toMSecsSinceEpoch()) - 1;
+    const int end = firstRowAtOrBefore(endDate.toMSecsSinceEpoch());
+    return start >= end ? end : -1;
+}
+
+/*
+Returns the highest price from startRow to endRow inclusive, in either
+order, or 0 if they are not rows of the model. Takes constant time.
+*/
+double StockModel::highestPrice(int startRow, int endRow) const
+{
+    if (!isRange(startRow, endRow) || m_columns.highIndex.isEmpty())
+        return 0.0;
+    return m_columns.highIndex.extreme(qMin(startRow, endRow), qMax(startRow, endRow));
+}
+
+// Returns the lowest price from startRow to endRow inclusive, like highestPrice()
+double StockModel::lowestPrice(int startRow, int endRow) const
+{
+    if (!isRange(startRow, endRow) || m_columns.lowIndex.isEmpty())
+        return 0.0;
+    return m_columns.lowIndex.extreme(qMin(startRow, endRow), qMax(startRow, endRow));
+}
+
+// Returns the highest volume from startRow to endRow inclusive, like highestPrice()
+qint64 StockModel::highestVolume(int startRow, int endRow) const
+{
+    if (!isRange(startRow, endRow) || m_columns.volumeIndex.isEmpty())
+        return 0;
+    return m_columns.volumeIndex.extreme(qMin(startRow, endRow), qMax(startRow, endRow));
+}
+
+bool StockModel::isRange(int startRow, int endRow) const
+{
+    const int count = m_columns.size();
+    return startRow >= 0 && startRow < count && endRow >= 0 && endRow < count;
+}
+
+// The rows are sorted newest first. Returns the first row at or before the time, or count if there is none.
+int StockModel::firstRowAtOrBefore(qint64 time) const
+{
+    const auto it = std::partition_point(m_columns.date.cbegin(), m_columns.date.cend(),
+                                         [time](qint64 date) { return date > time; });
+    return int(it - m_columns.date.cbegin());
+}
+
+// Returns the first row before the time, or count if there is none
+int StockModel::firstRowBefore(qint64 time) const
+{
+    const auto it = std::partition_point(m_columns.date.cbegin(), m_columns.date.cend(),
+                                         [time](qint64 date) { return date >= time; });
+    return int(it - m_columns.date.cbegin());
+}
+
+/*
+Loads the prices of the current stock in the background. dataReady is
+emitted once they have been loaded, with ready telling whether there are any.
+*/
+void StockModel::updateStock()
+{
+    cancel();
+    if (m_ready) {
+        m_ready = false;
+        emit readyChanged();
+    }
+    if (m_stockId.isEmpty())
+        return;
+
+    QUrl folder = m_dataFolder;
+    if (!folder.isEmpty() && !folder.path().endsWith(QLatin1Char('/')))
+        folder.setPath(folder.path() + QLatin1Char('/'));
+    if (const QQmlContext *context = qmlContext(this))
+        folder = context->resolvedUrl(folder);
+    const QString fileName = QQmlFile::urlToLocalFileOrQrc(folder.resolved(QUrl(m_stockId + QLatin1String(".csv"))));
+
+    m_job.reset(new StockModelJob);
+    m_job->model = this;
+    const QSharedPointer<StockModelJob> job = m_job;
+    QThreadPool::globalInstance()->start([job, fileName]() {
+        {
+            QMutexLocker locker(&job->mutex);
+            if (!job->model)
+                return;
+        }
+        StockColumns columns;
+        QString errorString;
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            errorString = file.errorString();
+        else if (parse(file.readAll(), &columns, &errorString))
+            columns.buildRangeIndexes();
+        job->deliver(columns, errorString);
+    });
+}
+
+/*
+Parses prices from CSV, newest or oldest first. The columns are found by
+their names in the header, or taken in the order Date, Open, High, Low,
+Close, Volume if there is none. Rows that cannot be read are skipped.
+Returns false if there is no row that can.
+*/
+bool StockModel::parse(const QByteArray &csv, StockColumns *columns, QString *errorString)
+{
+    *columns = StockColumns();
+    const char *p = csv.constData();
+    const char *end = p + csv.size();
+
+    int positions[ColumnCount] = { 0, 1, 2, 3, 4, 5 };
+    int fieldCount = ColumnCount;
+    const char *lineEnd = std::find(p, end, '\n');
+    Field fields[64];
+    const int headerCount = splitFields(p, lineEnd, fields, 64);
+    qint64 date;
+    if (headerCount > 0 && !parseDate(fields[0], &date)) {
+        static const char *const names[ColumnCount] = { "date", "open", "high", "low", "close", "volume" };
+        for (int column = 0; column < ColumnCount; ++column) {
+            positions[column] = -1;
+            for (int i = 0; i < headerCount; ++i) {
+                const QByteArray name = QByteArray::fromRawData(fields[i].begin, int(fields[i].end - fields[i].begin));
+                if (name.compare(names[column], Qt::CaseInsensitive) == 0) {
+                    positions[column] = i;
+                    break;
+                }
+            }
+            if (positions[column] < 0) {
+                *errorString = QStringLiteral("No %1 column").arg(QLatin1String(names[column]));
+                return false;
+            }
+        }
+        fieldCount = *std::max_element(positions, positions + ColumnCount) + 1;
+        p = lineEnd == end ? end : lineEnd + 1;
+    }
+
+    const int rowEstimate = int(std::count(p, end, '\n')) + 1;
+    columns->date.reserve(rowEstimate);
+    columns->open.reserve(rowEstimate);
+    columns->high.reserve(rowEstimate);
+    columns->low.reserve(rowEstimate);
+    columns->close.reserve(rowEstimate);
+    columns->volume.reserve(rowEstimate);
+
+    while (p < end) {
+        lineEnd = std::find(p, end, '\n');
+        const int count = splitFields(p, lineEnd, fields, fieldCount);
+        p = lineEnd == end ? end : lineEnd + 1;
+        if (count < fieldCount)
+            continue;
+
+        double open, high, low, close, volume;
+        if (!parseDate(fields[positions[DateColumn]], &date)
+                || !parseNumber(fields[positions[OpenColumn]], &open)
+                || !parseNumber(fields[positions[HighColumn]], &high)
+                || !parseNumber(fields[positions[LowColumn]], &low)
+                || !parseNumber(fields[positions[CloseColumn]], &close)
+                || !parseNumber(fields[positions[VolumeColumn]], &volume)) {
+            continue;
+        }
+        columns->date.append(date);
+        columns->open.append(open);
+        columns->high.append(high);
+        columns->low.append(low);
+        columns->close.append(close);
+        columns->volume.append(qRound64(volume));
+    }
+
+    if (columns->size() == 0) {
+        *errorString = QStringLiteral("No prices");
+        return false;
+    }
+
+    if (columns->date.first() < columns->date.last()) {
+        std::reverse(columns->date.begin(), columns->date.end());
+        std::reverse(columns->open.begin(), columns->open.end());
+        std::reverse(columns->high.begin(), columns->high.end());
+        std::reverse(columns->low.begin(), columns->low.end());
+        std::reverse(columns->close.begin(), columns->close.end());
+        std::reverse(columns->volume.begin(), columns->volume.end());
+    }
+    return true;
+}
+
+void StockModel::loaded(const StockColumns &columns, const QString &errorString)
+{
+    m_job.reset();
+    if (!errorString.isEmpty())
+        qmlWarning(this) << "Cannot load prices of " << m_stockId << ": " << errorString;
+
+    beginResetModel();
+    m_columns = columns;
+    endResetModel();
+
+    const bool ready = m_columns.size() > 0;
+    if (m_ready != ready) {
+        m_ready = ready;
+        emit readyChanged();
+    }
+    emit dataReady();
+}
+
+void StockModel::cancel()
+{
+    if (!m_job)
+        return;
+    QMutexLocker locker(&m_job->mutex);
+    m_job->model = nullptr;
+    locker.unlock();
+    m_job.reset();
+}
@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef STOCKMODEL_H
+#define STOCKMODEL_H
+
+#include <QAbstractListModel>
+#include <QDateTime>
+#include <QList>
+#include <QtAlgorithms>
+#include <QSharedPointer>
+#include <QUrl>
+#include <QtQml>
+
+struct StockModelJob;
+
+/*
+Finds the highest or lowest of any range of values in constant time.
+Level k holds the extreme of each run of 2^k values, so that any range is
+covered by two, possibly overlapping, runs of the same level.
+*/
+template <typename T>
+class StockRangeIndex
+{
+public:
+    void build(const QList<T> &values, bool highest)
+    {
+        m_highest = highest;
+        m_levels.clear();
+        m_levels.append(values);
+        for (qsizetype length = 2; length <= values.size(); length *= 2) {
+            const QList<T> &previous = m_levels.constLast();
+            QList<T> level;
+            level.reserve(values.size() - length + 1);
+            for (qsizetype i = 0; i + length <= values.size(); ++i)
+                level.append(pick(previous.at(i), previous.at(i + length / 2)));
+            m_levels.append(level);
+        }
+    }
+
+    bool isEmpty() const { return m_levels.isEmpty() || m_levels.constFirst().isEmpty(); }
+
+    // The extreme of the values from first to last, inclusive
+    T extreme(int first, int last) const
+    {
+        const int level = 31 - qCountLeadingZeroBits(quint32(last - first + 1));
+        const QList<T> &values = m_levels.at(level);
+        return pick(values.at(first), values.at(last - (1 << level) + 1));
+    }
+
+private:
+    T pick(T a, T b) const { return m_highest ? qMax(a, b) : qMin(a, b); }
+
+    QList<QList<T>> m_levels;
+    bool m_highest = true;
+};
+
+// The prices of a stock, one column per field, newest first
+struct StockColumns
+{
+    // Milliseconds since the epoch, in UTC
+    QList<qint64> date;
+    QList<double> open;
+    QList<double> high;
+    QList<double> low;
+    QList<double> close;
+    QList<qint64> volume;
+
+    // Built by buildRangeIndexes() once the columns are complete
+    StockRangeIndex<double> highIndex;
+    StockRangeIndex<double> lowIndex;
+    StockRangeIndex<qint64> volumeIndex;
+
+    int size() const { return date.size(); }
+    void buildRangeIndexes();
+};
+
+class StockModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QUrl dataFolder READ dataFolder WRITE setDataFolder NOTIFY dataFolderChanged)
+    Q_PROPERTY(QString stockId READ stockId WRITE setStockId NOTIFY stockIdChanged)
+    Q_PROPERTY(QString stockName READ stockName WRITE setStockName NOTIFY stockNameChanged)
+    Q_PROPERTY(QDateTime newest READ newest NOTIFY dataReady)
+    Q_PROPERTY(QDateTime oldest READ oldest NOTIFY dataReady)
+    Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+    Q_PROPERTY(double stockPrice READ stockPrice NOTIFY dataReady)
+    Q_PROPERTY(double stockPriceChanged READ stockPriceChanged NOTIFY dataReady)
+    Q_PROPERTY(int count READ count NOTIFY dataReady)
+    QML_ELEMENT
+
+public:
+    enum Roles {
+        DateRole = Qt::UserRole + 1,
+        OpenRole,
+        HighRole,
+        LowRole,
+        CloseRole,
+        VolumeRole
+    };
+
+    StockModel(QObject *parent = nullptr);
+    ~StockModel() override;
+
+    QUrl dataFolder() const;
+    void setDataFolder(const QUrl &dataFolder);
+
+    QString stockId() const;
+    void setStockId(const QString &stockId);
+
+    QString stockName() const;
+    void setStockName(const QString &stockName);
+
+    QDateTime newest() const;
+    QDateTime oldest() const;
+    bool ready() const;
+    double stockPrice() const;
+    double stockPriceChanged() const;
+    int count() const;
+
+    const StockColumns &columns() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE int indexOf(const QDateTime &date) const;
+    Q_INVOKABLE int startRow(const QDateTime &startDate, const QDateTime &endDate) const;
+    Q_INVOKABLE int endRow(const QDateTime &startDate, const QDateTime &endDate) const;
+    Q_INVOKABLE double highestPrice(int startRow, int endRow) const;
+    Q_INVOKABLE double lowestPrice(int startRow, int endRow) const;
+    Q_INVOKABLE qint64 highestVolume(int startRow, int endRow) const;
+    Q_INVOKABLE void updateStock();
+
+    static bool parse(const QByteArray &csv, StockColumns *columns, QString *errorString);
+
+Q_SIGNALS:
+    void dataFolderChanged();
+    void stockIdChanged();
+    void stockNameChanged();
+    void readyChanged();
+    void dataReady();
+
+private:
+    friend struct StockModelJob;
+
+    bool isRange(int startRow, int endRow) const;
+    int firstRowAtOrBefore(qint64 time) const;
+    int firstRowBefore(qint64 time) const;
+    void loaded(const StockColumns &columns, const QString &errorString);
+    void cancel();
+
+    QUrl m_dataFolder;
+    QString m_stockId;
+    QString m_stockName;
+    bool m_ready;
+
+    StockColumns m_columns;
+    QSharedPointer<StockModelJob> m_job;
+};
+
+#endif // STOCKMODEL_H
@@ -0,0 +1,641 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "stockplot.h"
+
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+/*
+Draws the prices of a stock as lines, and the volume of trade as bars,
+for the rows of a StockModel from startDate to endDate, oldest on the left.
+The geometry is built straight from the columns of the model, one node per
+series, and only the nodes of the series that changed are rebuilt. Showing
+or hiding a price, or changing its color, touches that series alone.
+
+Long ranges are decimated to at most four rows per pixel column: the
+first, last, lowest and highest of the rows falling into it, which draw
+the same pixels as all of them. The rows drawn are cached for each range
+and width, so going back to a range or size shown before costs no scan.
+*/
+
+static const quint32 PriceSeries = (1 << StockPlot::HighSeries) | (1 << StockPlot::LowSeries)
+        | (1 << StockPlot::OpenSeries) | (1 << StockPlot::CloseSeries);
+static const quint32 AllSeries = PriceSeries | (1 << StockPlot::VolumeSeries);
+
+static const qreal PriceOpacity = 0.7;
+static const qreal VolumeOpacity = 0.8;
+
+// In rows, for all ranges, widths and series together
+static const int MaximumCachedRows = 1 << 20;
+
+static const QList<double> &prices(const StockColumns &columns, StockPlot::Series series)
+{
+    switch (series) {
+    case StockPlot::HighSeries:
+        return columns.high;
+    case StockPlot::LowSeries:
+        return columns.low;
+    case StockPlot::OpenSeries:
+        return columns.open;
+    default:
+        return columns.close;
+    }
+}
+
+/*
+Returns the rows from firstRow down to lastRow, as drawn from left to
+right. If there are more than fit into the buckets, they are split into
+that many runs of consecutive rows, and only the first, last, lowest and
+highest row of each run are kept, or only the highest if maximumOnly is set.
+*/
+template <typename T>
+static QList<int> decimateRows(const QList<T> &values, int firstRow, int lastRow, int buckets, bool maximumOnly)
+{
+    QList<int> rows;
+    const int count = firstRow - lastRow + 1;
+    if (count <= 0 || buckets <= 0)
+        return rows;
+
+    const int rowsPerBucket = maximumOnly ? 1 : 4;
+    if (count <= buckets * rowsPerBucket) {
+        rows.reserve(count);
+        for (int row = firstRow; row >= lastRow; --row)
+            rows.append(row);
+        return rows;
+    }
+
+    rows.reserve(buckets * rowsPerBucket);
+    for (int bucket = 0; bucket < buckets; ++bucket) {
+        const int first = firstRow - int(qint64(count) * bucket / buckets);
+        const int last = firstRow - int(qint64(count) * (bucket + 1) / buckets) + 1;
+        int lowest = first;
+        int highest = first;
+        for (int row = first - 1; row >= last; --row) {
+            if (values.at(row) < values.at(lowest))
+                lowest = row;
+            if (values.at(row) > values.at(highest))
+                highest = row;
+        }
+        if (maximumOnly) {
+            rows.append(highest);
+            continue;
+        }
+        int picked[4] = { first, lowest, highest, last };
+        std::sort(picked, picked + 4, std::greater<int>());
+        for (int row : picked) {
+            if (rows.isEmpty() || rows.last() != row)
+                rows.append(row);
+        }
+    }
+    return rows;
+}
+
+StockPlot::StockPlot(QQuickItem *parent) : QQuickItem(parent)
+    , m_priceTop(0), m_priceBottom(0), m_volumeHeight(0), m_lineWidth(1), m_barSpacing(0)
+    , m_firstRow(-1), m_lastRow(-1), m_highestPrice(0), m_lowestPrice(0), m_highestVolume(0)
+    , m_dirtyGeometry(AllSeries), m_dirtyMaterial(AllSeries)
+{
+    setFlag(ItemHasContents);
+    for (int series = 0; series < SeriesCount; ++series)
+        m_visible[series] = true;
+    m_decimations.setMaxCost(MaximumCachedRows);
+}
+
+StockPlot::~StockPlot()
+{
+}
+
+StockModel *StockPlot::model() const
+{
+    return m_model;
+}
+
+void StockPlot::setModel(StockModel *model)
+{
+    if (m_model == model)
+        return;
+    if (m_model)
+        disconnect(m_model, nullptr, this, nullptr);
+    m_model = model;
+    m_decimations.clear();
+    if (m_model) {
+        connect(m_model, &StockModel::dataReady, this, [this]() {
+            m_decimations.clear();
+            updateRange();
+        });
+    }
+    updateRange();
+    emit modelChanged();
+}
+
+QDateTime StockPlot::startDate() const
+{
+    return m_startDate;
+}
+
+void StockPlot::setStartDate(const QDateTime &startDate)
+{
+    if (m_startDate == startDate)
+        return;
+    m_startDate = startDate;
+    updateRange();
+    emit startDateChanged();
+}
+
+QDateTime StockPlot::endDate() const
+{
+    return m_endDate;
+}
+
+void StockPlot::setEndDate(const QDateTime &endDate)
+{
+    if (m_endDate == endDate)
+        return;
+    m_endDate = endDate;
+    updateRange();
+    emit endDateChanged();
+}
+
+bool StockPlot::drawHighPrice() const
+{
+    return m_visible[HighSeries];
+}
+
+void StockPlot::setDrawHighPrice(bool draw)
+{
+    setSeriesVisible(HighSeries, draw, &StockPlot::drawHighPriceChanged);
+}
+
+bool StockPlot::drawLowPrice() const
+{
+    return m_visible[LowSeries];
+}
+
+void StockPlot::setDrawLowPrice(bool draw)
+{
+    setSeriesVisible(LowSeries, draw, &StockPlot::drawLowPriceChanged);
+}
+
+bool StockPlot::drawOpenPrice() const
+{
+    return m_visible[OpenSeries];
+}
+
+void StockPlot::setDrawOpenPrice(bool draw)
+{
+    setSeriesVisible(OpenSeries, draw, &StockPlot::drawOpenPriceChanged);
+}
+
+bool StockPlot::drawClosePrice() const
+{
+    return m_visible[CloseSeries];
+}
+
+void StockPlot::setDrawClosePrice(bool draw)
+{
+    setSeriesVisible(CloseSeries, draw, &StockPlot::drawClosePriceChanged);
+}
+
+QColor StockPlot::highColor() const
+{
+    return m_colors[HighSeries];
+}
+
+void StockPlot::setHighColor(const QColor &color)
+{
+    setSeriesColor(HighSeries, color, &StockPlot::highColorChanged);
+}
+
+QColor StockPlot::lowColor() const
+{
+    return m_colors[LowSeries];
+}
+
+void StockPlot::setLowColor(const QColor &color)
+{
+    setSeriesColor(LowSeries, color, &StockPlot::lowColorChanged);
+}
+
+QColor StockPlot::openColor() const
+{
+    return m_colors[OpenSeries];
+}
+
+void StockPlot::setOpenColor(const QColor &color)
+{
+    setSeriesColor(OpenSeries, color, &StockPlot::openColorChanged);
+}
+
+QColor StockPlot::closeColor() const
+{
+    return m_colors[CloseSeries];
+}
+
+void StockPlot::setCloseColor(const QColor &color)
+{
+    setSeriesColor(CloseSeries, color, &StockPlot::closeColorChanged);
+}
+
+QColor StockPlot::volumeColor() const
+{
+    return m_colors[VolumeSeries];
+}
+
+void StockPlot::setVolumeColor(const QColor &color)
+{
+    setSeriesColor(VolumeSeries, color, &StockPlot::volumeColorChanged);
+}
+
+// The y coordinate of the highest price in the range
+qreal StockPlot::priceTop() const
+{
+    return m_priceTop;
+}
+
+void StockPlot::setPriceTop(qreal priceTop)
+{
+    setLayout(&m_priceTop, priceTop, PriceSeries, &StockPlot::priceTopChanged);
+}
+
+// The y coordinate of the lowest price in the range
+qreal StockPlot::priceBottom() const
+{
+    return m_priceBottom;
+}
+
+void StockPlot::setPriceBottom(qreal priceBottom)
+{
+    setLayout(&m_priceBottom, priceBottom, PriceSeries, &StockPlot::priceBottomChanged);
+}
+
+// The height of the bar of the highest volume in the range. The bars stand on the bottom of the item.
+qreal StockPlot::volumeHeight() const
+{
+    return m_volumeHeight;
+}
+
+void StockPlot::setVolumeHeight(qreal volumeHeight)
+{
+    setLayout(&m_volumeHeight, volumeHeight, 1 << VolumeSeries, &StockPlot::volumeHeightChanged);
+}
+
+qreal StockPlot::lineWidth() const
+{
+    return m_lineWidth;
+}
+
+void StockPlot::setLineWidth(qreal lineWidth)
+{
+    setLayout(&m_lineWidth, lineWidth, PriceSeries, &StockPlot::lineWidthChanged);
+}
+
+// The gap between two volume bars
+qreal StockPlot::barSpacing() const
+{
+    return m_barSpacing;
+}
+
+void StockPlot::setBarSpacing(qreal barSpacing)
+{
+    setLayout(&m_barSpacing, barSpacing, 1 << VolumeSeries, &StockPlot::barSpacingChanged);
+}
+
+// The number of days, or other intervals, between the first and last row drawn
+int StockPlot::count() const
+{
+    return m_firstRow < 0 ? 0 : m_firstRow - m_lastRow;
+}
+
+double StockPlot::highestPrice() const
+{
+    return m_highestPrice;
+}
+
+double StockPlot::lowestPrice() const
+{
+    return m_lowestPrice;
+}
+
+qint64 StockPlot::highestVolume() const
+{
+    return m_highestVolume;
+}
+
+/*
+Returns the rows from firstRow down to lastRow to draw a line through in
+as many pixel columns as there are buckets, keeping the extremes of each.
+*/
+QList<int> StockPlot::decimate(const QList<double> &values, int firstRow, int lastRow, int buckets)
+{
+    return decimateRows(values, firstRow, lastRow, buckets, false);
+}
+
+// Returns the rows to draw a bar for, keeping the highest of each bucket
+QList<int> StockPlot::decimateMaximum(const QList<qint64> &values, int firstRow, int lastRow, int buckets)
+{
+    return decimateRows(values, firstRow, lastRow, buckets, true);
+}
+
+/*
+Extrudes a polyline into a triangle strip of the given width. Wide lines
+are not supported by every graphics API, so they cannot be drawn as lines.
+*/
+void StockPlot::setLineGeometry(QSGGeometry *geometry, const QList<QPointF> &points, float width)
+{
+    const int count = points.size();
+    if (count < 2) {
+        geometry->allocate(0);
+        return;
+    }
+    geometry->allocate(count * 2);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+
+    auto direction = [](const QPointF &from, const QPointF &to) {
+        const QPointF d = to - from;
+        const qreal length = std::hypot(d.x(), d.y());
+        return length > 0 ? d / length : QPointF(1, 0);
+    };
+    const qreal halfWidth = width / 2.0;
+    for (int i = 0; i < count; ++i) {
+        const QPointF in = direction(points.at(qMax(i - 1, 0)), points.at(qMax(i, 1)));
+        const QPointF out = direction(points.at(qMin(i, count - 2)), points.at(qMin(i + 1, count - 1)));
+        QPointF tangent = in + out;
+        const qreal length = std::hypot(tangent.x(), tangent.y());
+        tangent = length > 0 ? tangent / length : out;
+        const QPointF normal(-tangent.y(), tangent.x());
+        // Lengthened at corners to keep the width of the line, up to twice at sharp ones
+        const qreal cosine = QPointF::dotProduct(normal, QPointF(-out.y(), out.x()));
+        const QPointF offset = normal * (halfWidth / qMax(cosine, qreal(0.5)));
+        const QPointF &point = points.at(i);
+        vertices[2 * i].set(point.x() + offset.x(), point.y() + offset.y());
+        vertices[2 * i + 1].set(point.x() - offset.x(), point.y() - offset.y());
+    }
+}
+
+// Sets two triangles for each bar
+void StockPlot::setBarGeometry(QSGGeometry *geometry, const QList<QRectF> &bars)
+{
+    geometry->allocate(bars.size() * 6);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+    for (const QRectF &bar : bars) {
+        const float left = bar.left();
+        const float top = bar.top();
+        const float right = bar.right();
+        const float bottom = bar.bottom();
+        vertices[0].set(left, top);
+        vertices[1].set(right, top);
+        vertices[2].set(left, bottom);
+        vertices[3].set(right, top);
+        vertices[4].set(right, bottom);
+        vertices[5].set(left, bottom);
+        vertices += 6;
+    }
+}
+
+QSGNode *StockPlot::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode;
+        // The volume is drawn over the prices
+        for (int series = 0; series < SeriesCount; ++series) {
+            QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+            geometry->setDrawingMode(series == VolumeSeries ? QSGGeometry::DrawTriangles
+                                                            : QSGGeometry::DrawTriangleStrip);
+            QSGGeometryNode *node = new QSGGeometryNode;
+            node->setGeometry(geometry);
+            node->setFlag(QSGNode::OwnsGeometry);
+            node->setMaterial(new QSGFlatColorMaterial);
+            node->setFlag(QSGNode::OwnsMaterial);
+            root->appendChildNode(node);
+        }
+        m_dirtyGeometry = m_dirtyMaterial = AllSeries;
+    }
+
+    //! [0]
+    const int buckets = bucketCount();
+    for (int series = 0; series < SeriesCount; ++series) {
+        QSGGeometryNode *node = static_cast<QSGGeometryNode *>(root->childAtIndex(series));
+        if (m_dirtyGeometry & (1 << series)) {
+            if (series == VolumeSeries)
+                setBarGeometry(node->geometry(), m_visible[series] ? volumeBars(buckets) : QList<QRectF>());
+            else
+                setLineGeometry(node->geometry(), m_visible[series] ? pricePoints(Series(series), buckets) : QList<QPointF>(), m_lineWidth);
+            node->markDirty(QSGNode::DirtyGeometry);
+        }
+        if (m_dirtyMaterial & (1 << series)) {
+            QColor color = m_colors[series];
+            color.setAlphaF(color.alphaF() * (series == VolumeSeries ? VolumeOpacity : PriceOpacity));
+            static_cast<QSGFlatColorMaterial *>(node->material())->setColor(color);
+            node->markDirty(QSGNode::DirtyMaterial);
+        }
+    }
+    m_dirtyGeometry = 0;
+    m_dirtyMaterial = 0;
+    //! [0]
+    return root;
+}
+
+void StockPlot::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size())
+        invalidate(AllSeries);
+}
+
+void StockPlot::setSeriesVisible(Series series, bool visible, void (StockPlot::*changed)())
+{
+    if (m_visible[series] == visible)
+        return;
+    m_visible[series] = visible;
+    invalidate(1 << series);
+    emit (this->*changed)();
+}
+
+void StockPlot::setSeriesColor(Series series, const QColor &color, void (StockPlot::*changed)())
+{
+    if (m_colors[series] == color)
+        return;
+    m_colors[series] = color;
+    m_dirtyMaterial |= 1 << series;
+    update();
+    emit (this->*changed)();
+}
+
+void StockPlot::setLayout(qreal *value, qreal newValue, quint32 series, void (StockPlot::*changed)())
+{
+    if (*value == newValue)
+        return;
+    *value = newValue;
+    invalidate(series);
+    emit (this->*changed)();
+}
+
+// Finds the rows from startDate to endDate, and the extremes within them
+void StockPlot::updateRange()
+{
+    int firstRow = -1;
+    int lastRow = -1;
+    double highestPrice = 0;
+    double lowestPrice = 0;
+    qint64 highestVolume = 0;
+    if (m_model && m_model->count() > 0) {
+        // Starts at or before startDate, like the chart
+        firstRow = m_model->indexOf(m_startDate);
+        lastRow = qMax(m_model->endRow(m_startDate, m_endDate), 0);
+        if (firstRow < lastRow)
+            firstRow = lastRow = -1;
+    }
+    if (firstRow >= 0) {
+        // Looked up in the range indexes of the model, without scanning the rows
+        highestPrice = m_model->highestPrice(firstRow, lastRow);
+        lowestPrice = m_model->lowestPrice(firstRow, lastRow);
+        highestVolume = m_model->highestVolume(firstRow, lastRow);
+    }
+
+    // The rows may hold other prices than before even if they are the same
+    invalidate(AllSeries);
+    if (m_firstRow == firstRow && m_lastRow == lastRow && m_highestPrice == highestPrice
+            && m_lowestPrice == lowestPrice && m_highestVolume == highestVolume) {
+        return;
+    }
+    m_firstRow = firstRow;
+    m_lastRow = lastRow;
+    m_highestPrice = highestPrice;
+    m_lowestPrice = lowestPrice;
+    m_highestVolume = highestVolume;
+    emit rangeChanged();
+}
+
+void StockPlot::invalidate(quint32 series)
+{
+    m_dirtyGeometry |= series;
+    update();
+}
+
+// The number of pixel columns the item covers
+int StockPlot::bucketCount() const
+{
+    const qreal devicePixelRatio = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    return qMax(1, qCeil(width() * devicePixelRatio));
+}
+
+QList<int> StockPlot::decimatedRows(Series series, int buckets)
+{
+    // There is no bar for the first row
+    const int firstRow = series == VolumeSeries ? m_firstRow - 1 : m_firstRow;
+    const StockDecimationKey key{ series, firstRow, m_lastRow, buckets };
+    if (const QList<int> *rows = m_decimations.object(key))
+        return *rows;
+
+    const StockColumns &columns = m_model->columns();
+    const QList<int> rows = series == VolumeSeries
+            ? decimateMaximum(columns.volume, firstRow, m_lastRow, buckets)
+            : decimate(prices(columns, series), firstRow, m_lastRow, buckets);
+    m_decimations.insert(key, new QList<int>(rows), qMax(int(rows.size()), 1));
+    return rows;
+}
+
+QList<QPointF> StockPlot::pricePoints(Series series, int buckets)
+{
+    QList<QPointF> points;
+    if (!m_model || m_firstRow < 0 || m_firstRow >= m_model->count())
+        return points;
+
+    const QList<double> &values = prices(m_model->columns(), series);
+    const double range = m_highestPrice > m_lowestPrice ? m_highestPrice - m_lowestPrice : 1.0;
+    const qreal step = width() / qMax(count(), 1);
+    const qreal scale = (m_priceBottom - m_priceTop) / range;
+
+    const QList<int> rows = decimatedRows(series, buckets);
+    points.reserve(rows.size());
+    for (int row : rows)
+        points.append(QPointF((m_firstRow - row) * step, m_priceBottom - (values.at(row) - m_lowestPrice) * scale));
+    return points;
+}
+
+/*
+The bar of each day stands between the points of it and the day before,
+so the oldest day in the range has none. If there are more days than
+pixel columns, each column has one bar for the highest volume in it,
+and the spacing is left out.
+*/
+QList<QRectF> StockPlot::volumeBars(int buckets)
+{
+    QList<QRectF> bars;
+    if (!m_model || m_firstRow < 0 || m_firstRow >= m_model->count() || m_highestVolume <= 0)
+        return bars;
+
+    const QList<qint64> &volumes = m_model->columns().volume;
+    const QList<int> rows = decimatedRows(VolumeSeries, buckets);
+    const bool decimated = rows.size() < count();
+    const qreal step = decimated ? width() / buckets : width() / qMax(count(), 1);
+    const qreal barWidth = decimated ? step : step - m_barSpacing;
+    if (barWidth <= 0)
+        return bars;
+
+    bars.reserve(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const int row = rows.at(i);
+        const qreal barHeight = m_volumeHeight * volumes.at(row) / m_highestVolume;
+        // Each bar starts at the point of the day before its own
+        const qreal x = (decimated ? i : m_firstRow - 1 - row) * step;
+        if (barHeight > 0)
+            bars.append(QRectF(x, height() - barHeight, barWidth, barHeight));
+    }
+    return bars;
+}
@@ -0,0 +1,240 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the examples of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:BSD$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** BSD License Usage
+** Alternatively, you may use this file under the terms of the BSD license
+** as follows:
+**
+** "Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions are
+** met:
+**   * Redistributions of source code must retain the above copyright
+**     notice, this list of conditions and the following disclaimer.
+**   * Redistributions in binary form must reproduce the above copyright
+**     notice, this list of conditions and the following disclaimer in
+**     the documentation and/or other materials provided with the
+**     distribution.
+**   * Neither the name of The Qt Company Ltd nor the names of its
+**     contributors may be used to endorse or promote products derived
+**     from this software without specific prior written permission.
+**
+**
+** THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+** "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+** LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+** A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+** OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+** SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+** LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+** OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef STOCKPLOT_H
+#define STOCKPLOT_H
+
+#include <QCache>
+#include <QColor>
+#include <QDateTime>
+#include <QHash>
+#include <QPointer>
+#include <QQuickItem>
+#include <QSGGeometry>
+#include <QtQml>
+
+#include "stockmodel.h"
+
+// The rows of a series drawn for a range of rows, at a number of points per pixel
+struct StockDecimationKey
+{
+    int series;
+    int firstRow;
+    int lastRow;
+    int buckets;
+};
+
+inline bool operator==(const StockDecimationKey &a, const StockDecimationKey &b)
+{
+    return a.series == b.series && a.firstRow == b.firstRow && a.lastRow == b.lastRow
+            && a.buckets == b.buckets;
+}
+
+inline size_t qHash(const StockDecimationKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.series, key.firstRow, key.lastRow, key.buckets);
+}
+
+class StockPlot : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(StockModel *model READ model WRITE setModel NOTIFY modelChanged)
+    Q_PROPERTY(QDateTime startDate READ startDate WRITE setStartDate NOTIFY startDateChanged)
+    Q_PROPERTY(QDateTime endDate READ endDate WRITE setEndDate NOTIFY endDateChanged)
+
+    Q_PROPERTY(bool drawHighPrice READ drawHighPrice WRITE setDrawHighPrice NOTIFY drawHighPriceChanged)
+    Q_PROPERTY(bool drawLowPrice READ drawLowPrice WRITE setDrawLowPrice NOTIFY drawLowPriceChanged)
+    Q_PROPERTY(bool drawOpenPrice READ drawOpenPrice WRITE setDrawOpenPrice NOTIFY drawOpenPriceChanged)
+    Q_PROPERTY(bool drawClosePrice READ drawClosePrice WRITE setDrawClosePrice NOTIFY drawClosePriceChanged)
+    Q_PROPERTY(QColor highColor READ highColor WRITE setHighColor NOTIFY highColorChanged)
+    Q_PROPERTY(QColor lowColor READ lowColor WRITE setLowColor NOTIFY lowColorChanged)
+    Q_PROPERTY(QColor openColor READ openColor WRITE setOpenColor NOTIFY openColorChanged)
+    Q_PROPERTY(QColor closeColor READ closeColor WRITE setCloseColor NOTIFY closeColorChanged)
+    Q_PROPERTY(QColor volumeColor READ volumeColor WRITE setVolumeColor NOTIFY volumeColorChanged)
+
+    Q_PROPERTY(qreal priceTop READ priceTop WRITE setPriceTop NOTIFY priceTopChanged)
+    Q_PROPERTY(qreal priceBottom READ priceBottom WRITE setPriceBottom NOTIFY priceBottomChanged)
+    Q_PROPERTY(qreal volumeHeight READ volumeHeight WRITE setVolumeHeight NOTIFY volumeHeightChanged)
+    Q_PROPERTY(qreal lineWidth READ lineWidth WRITE setLineWidth NOTIFY lineWidthChanged)
+    Q_PROPERTY(qreal barSpacing READ barSpacing WRITE setBarSpacing NOTIFY barSpacingChanged)
+
+    Q_PROPERTY(int count READ count NOTIFY rangeChanged)
+    Q_PROPERTY(double highestPrice READ highestPrice NOTIFY rangeChanged)
+    Q_PROPERTY(double lowestPrice READ lowestPrice NOTIFY rangeChanged)
+    Q_PROPERTY(qint64 highestVolume READ highestVolume NOTIFY rangeChanged)
+    QML_ELEMENT
+
+public:
+    enum Series { HighSeries, LowSeries, OpenSeries, CloseSeries, VolumeSeries, SeriesCount };
+
+    StockPlot(QQuickItem *parent = nullptr);
+    ~StockPlot() override;
+
+    StockModel *model() const;
+    void setModel(StockModel *model);
+
+    QDateTime startDate() const;
+    void setStartDate(const QDateTime &startDate);
+
+    QDateTime endDate() const;
+    void setEndDate(const QDateTime &endDate);
+
+    bool drawHighPrice() const;
+    void setDrawHighPrice(bool draw);
+    bool drawLowPrice() const;
+    void setDrawLowPrice(bool draw);
+    bool drawOpenPrice() const;
+    void setDrawOpenPrice(bool draw);
+    bool drawClosePrice() const;
+    void setDrawClosePrice(bool draw);
+
+    QColor highColor() const;
+    void setHighColor(const QColor &color);
+    QColor lowColor() const;
+    void setLowColor(const QColor &color);
+    QColor openColor() const;
+    void setOpenColor(const QColor &color);
+    QColor closeColor() const;
+    void setCloseColor(const QColor &color);
+    QColor volumeColor() const;
+    void setVolumeColor(const QColor &color);
+
+    qreal priceTop() const;
+    void setPriceTop(qreal priceTop);
+
+    qreal priceBottom() const;
+    void setPriceBottom(qreal priceBottom);
+
+    qreal volumeHeight() const;
+    void setVolumeHeight(qreal volumeHeight);
+
+    qreal lineWidth() const;
+    void setLineWidth(qreal lineWidth);
+
+    qreal barSpacing() const;
+    void setBarSpacing(qreal barSpacing);
+
+    int count() const;
+    double highestPrice() const;
+    double lowestPrice() const;
+    qint64 highestVolume() const;
+
+    static void setLineGeometry(QSGGeometry *geometry, const QList<QPointF> &points, float width);
+    static void setBarGeometry(QSGGeometry *geometry, const QList<QRectF> &bars);
+    static QList<int> decimate(const QList<double> &values, int firstRow, int lastRow, int buckets);
+    static QList<int> decimateMaximum(const QList<qint64> &values, int firstRow, int lastRow, int buckets);
+
+Q_SIGNALS:
+    void modelChanged();
+    void startDateChanged();
+    void endDateChanged();
+    void drawHighPriceChanged();
+    void drawLowPriceChanged();
+    void drawOpenPriceChanged();
+    void drawClosePriceChanged();
+    void highColorChanged();
+    void lowColorChanged();
+    void openColorChanged();
+    void closeColorChanged();
+    void volumeColorChanged();
+    void priceTopChanged();
+    void priceBottomChanged();
+    void volumeHeightChanged();
+    void lineWidthChanged();
+    void barSpacingChanged();
+    void rangeChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+
+private:
+    // Checks which series are rebuilt
+    friend class tst_stockplot;
+
+    void setSeriesVisible(Series series, bool visible, void (StockPlot::*changed)());
+    void setSeriesColor(Series series, const QColor &color, void (StockPlot::*changed)());
+    void setLayout(qreal *value, qreal newValue, quint32 series, void (StockPlot::*changed)());
+    void updateRange();
+    void invalidate(quint32 series);
+
+    int bucketCount() const;
+    QList<int> decimatedRows(Series series, int buckets);
+    QList<QPointF> pricePoints(Series series, int buckets);
+    QList<QRectF> volumeBars(int buckets);
+
+    QPointer<StockModel> m_model;
+    QDateTime m_startDate;
+    QDateTime m_endDate;
+
+    bool m_visible[SeriesCount];
+    QColor m_colors[SeriesCount];
+    qreal m_priceTop;
+    qreal m_priceBottom;
+    qreal m_volumeHeight;
+    qreal m_lineWidth;
+    qreal m_barSpacing;
+
+    // The rows drawn, oldest first, and the extremes within them
+    int m_firstRow;
+    int m_lastRow;
+    double m_highestPrice;
+    double m_lowestPrice;
+    qint64 m_highestVolume;
+
+    // The rows drawn of each range and zoom level shown, until the model changes
+    QCache<StockDecimationKey, QList<int>> m_decimations;
+
+    // One bit per series whose geometry or color has changed since the last update
+    quint32 m_dirtyGeometry;
+    quint32 m_dirtyMaterial;
+};
+
+#endif // STOCKPLOT_H
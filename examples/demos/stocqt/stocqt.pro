@@ -1,8 +1,17 @@
 TEMPLATE = app
 
 QT += qml quick
-SOURCES += main.cpp
+CONFIG += qmltypes
+HEADERS += stockmodel.h \
+           stockplot.h
+SOURCES += main.cpp \
+           stockmodel.cpp \
+           stockplot.cpp
 RESOURCES += stocqt.qrc
+
+QML_IMPORT_NAME = StocQt
+QML_IMPORT_MAJOR_VERSION = 1
+
 OTHER_FILES += *.qml content/*.qml content/images/*.png
 
 target.path = $$[QT_INSTALL_EXAMPLES]/demos/stocqt
@@ -51,6 +51,7 @@
 import QtQuick
 import QtQml.Models
 import QtQuick.Layouts
+import StocQt
 import "./content"
 
 Rectangle {
@@ -81,6 +82,7 @@ Rectangle {
 
             StockModel {
                 id: stock
+                dataFolder: "content/data/"
                 stockId: listView.currentStockId
                 stockName: listView.currentStockName
                 onStockIdChanged: stock.updateStock();
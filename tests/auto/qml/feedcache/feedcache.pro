@@ -0,0 +1,15 @@
+CONFIG += testcase
+TARGET = tst_feedcache
+QT += qml network testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/rssnews \
+               ../../../../examples/demos/shared \
+               ../../shared
+
+HEADERS += ../../shared/httpstandin.h \
+           ../../../../examples/demos/rssnews/feedcache.h \
+           ../../../../examples/demos/shared/xmllistmodel.h
+SOURCES += tst_feedcache.cpp \
+           ../../../../examples/demos/rssnews/feedcache.cpp \
+           ../../../../examples/demos/shared/xmllistmodel.cpp
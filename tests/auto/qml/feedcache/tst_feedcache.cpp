@@ -0,0 +1,244 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+
+#include <qtest.h>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQmlEngine>
+
+#include "feedcache.h"
+#include "httpstandin.h"
+#include "xmllistmodel.h"
+
+class tst_feedcache : public QObject
+{
+    Q_OBJECT
+public:
+    tst_feedcache() {}
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void prefetchLimit();
+    void evictLeastRecentlyUsed();
+    void currentModelSurvivesEviction();
+    void prefetchWithinMemoryLimit();
+
+private:
+    FeedCache *createCache(QQmlEngine *engine, const QStringList &names,
+                           const QString &properties = QString());
+    static QByteArray feed(const QString &name);
+
+    HttpStandIn server;
+};
+
+void tst_feedcache::initTestCase()
+{
+    qmlRegisterType<XmlListModel>("XmlListModel", 1, 0, "XmlListModel");
+    qmlRegisterType<XmlListModelRole>("XmlListModel", 1, 0, "XmlListModelRole");
+    qmlRegisterType<FeedCache>("XmlListModel", 1, 0, "FeedCache");
+    server.contentType = "application/xml";
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+}
+
+void tst_feedcache::init()
+{
+    server.reset();
+    server.documents.clear();
+    for (const char *name : { "a", "b", "c", "d", "e" })
+        server.documents[QByteArray(name) + ".xml"] = feed(QString::fromLatin1(name));
+}
+
+FeedCache *tst_feedcache::createCache(QQmlEngine *engine, const QStringList &names,
+                                      const QString &properties)
+{
+    QStringList sources;
+    for (const QString &name : names)
+        sources.append(QLatin1Char('"') + server.url(name + QLatin1String(".xml")).toString() + QLatin1Char('"'));
+
+    QQmlComponent component(engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "FeedCache {\n"
+            "    sources: [ %1 ]\n"
+            "    %2\n"
+            "    XmlListModel {\n"
+            "        query: \"/rss/channel/item\"\n"
+            "        roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" } ]\n"
+            "    }\n"
+            "}\n").arg(sources.join(QLatin1String(", ")), properties).toUtf8(), QUrl());
+    if (component.isError())
+        qWarning() << component.errors();
+    return qobject_cast<FeedCache *>(component.create());
+}
+
+QByteArray tst_feedcache::feed(const QString &name)
+{
+    QByteArray data = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>";
+    for (int i = 0; i < 20; ++i)
+        data += "<item><title>" + name.toUtf8() + ' ' + QByteArray::number(i) + "</title></item>";
+    return data + "</channel></rss>";
+}
+
+void tst_feedcache::prefetchLimit()
+{
+    server.holdResponses = true;
+
+    QQmlEngine engine;
+    QScopedPointer<FeedCache> cache(createCache(&engine, { "a", "b", "c", "d", "e" },
+                                                QStringLiteral("maximumLoads: 2")));
+    QVERIFY(cache);
+
+    // Only maximumLoads feeds are loaded at a time
+    QTRY_COMPARE(server.requests.count(), 2);
+    QTest::qWait(50);
+    QCOMPARE(server.requests.count(), 2);
+
+    // The others follow as the first ones are done
+    server.release();
+    QTRY_COMPARE(server.requests.count(), 5);
+    QList<QByteArray> order = server.order;
+    std::sort(order.begin(), order.end());
+    QCOMPARE(order, QList<QByteArray>({ "a.xml", "b.xml", "c.xml", "d.xml", "e.xml" }));
+    for (const char *name : { "a", "b", "c", "d", "e" }) {
+        XmlListModel *model = cache->model(server.url(QLatin1String(name) + QLatin1String(".xml")));
+        QVERIFY(model);
+        QTRY_COMPARE(model->status(), XmlListModel::Ready);
+        QCOMPARE(model->count(), 20);
+    }
+    QCOMPARE(server.requests.count(), 5);
+}
+
+void tst_feedcache::evictLeastRecentlyUsed()
+{
+    QQmlEngine engine;
+    QScopedPointer<FeedCache> cache(createCache(&engine, { "a", "b", "c" }));
+    QVERIFY(cache);
+
+    QPointer<XmlListModel> a = cache->model(server.url(QStringLiteral("a.xml")));
+    QPointer<XmlListModel> b = cache->model(server.url(QStringLiteral("b.xml")));
+    QPointer<XmlListModel> c = cache->model(server.url(QStringLiteral("c.xml")));
+    QVERIFY(a && b && c);
+    QTRY_COMPARE(a->status(), XmlListModel::Ready);
+    QTRY_COMPARE(b->status(), XmlListModel::Ready);
+    QTRY_COMPARE(c->status(), XmlListModel::Ready);
+    QCOMPARE(cache->memoryUsage(), a->memoryUsage() + b->memoryUsage() + c->memoryUsage());
+
+    // b has been used least recently once a is used again
+    QCOMPARE(cache->model(server.url(QStringLiteral("a.xml"))), a.data());
+    cache->setMemoryLimit(a->memoryUsage() + c->memoryUsage());
+    QTRY_VERIFY(!b);
+    QVERIFY(a && c);
+    QCOMPARE(cache->memoryUsage(), a->memoryUsage() + c->memoryUsage());
+
+    // Feeds are kept until they no longer fit, the last one asked for always
+    cache->setMemoryLimit(0);
+    QTRY_VERIFY(!c);
+    QVERIFY(a);
+    QCOMPARE(cache->memoryUsage(), a->memoryUsage());
+
+    // An evicted feed is loaded again when it is asked for
+    XmlListModel *reloaded = cache->model(server.url(QStringLiteral("b.xml")));
+    QVERIFY(reloaded);
+    QTRY_COMPARE(reloaded->status(), XmlListModel::Ready);
+    QCOMPARE(server.requestCounts.value("b.xml"), 2);
+}
+
+void tst_feedcache::currentModelSurvivesEviction()
+{
+    QQmlEngine engine;
+    QScopedPointer<FeedCache> cache(createCache(&engine, { "a", "b", "c" },
+            QStringLiteral("currentSource: \"%1\"").arg(server.url(QStringLiteral("a.xml")).toString())));
+    QVERIFY(cache);
+
+    QPointer<XmlListModel> a = cache->currentModel();
+    QVERIFY(a);
+    QCOMPARE(a->source(), server.url(QStringLiteral("a.xml")));
+    QPointer<XmlListModel> b = cache->model(server.url(QStringLiteral("b.xml")));
+    QPointer<XmlListModel> c = cache->model(server.url(QStringLiteral("c.xml")));
+    QVERIFY(b && c);
+    QTRY_COMPARE(a->status(), XmlListModel::Ready);
+    QTRY_COMPARE(b->status(), XmlListModel::Ready);
+    QTRY_COMPARE(c->status(), XmlListModel::Ready);
+
+    // The current feed is now the one used least recently, and still kept
+    cache->setMemoryLimit(0);
+    QTRY_VERIFY(!b);
+    QVERIFY(a && c);
+    QCOMPARE(cache->currentModel(), a.data());
+    QCOMPARE(cache->memoryUsage(), a->memoryUsage() + c->memoryUsage());
+    QCOMPARE(a->count(), 20);
+}
+
+void tst_feedcache::prefetchWithinMemoryLimit()
+{
+    QQmlEngine engine;
+    qint64 feedUsage = 0;
+    {
+        QScopedPointer<FeedCache> cache(createCache(&engine, { "a" }));
+        QVERIFY(cache);
+        XmlListModel *a = cache->model(server.url(QStringLiteral("a.xml")));
+        QVERIFY(a);
+        QTRY_COMPARE(a->status(), XmlListModel::Ready);
+        feedUsage = a->memoryUsage();
+        QVERIFY(feedUsage > 0);
+    }
+    server.reset();
+
+    // Two and a half feeds fit; the third one is the last to be downloaded
+    QScopedPointer<FeedCache> cache(createCache(&engine, { "a", "b", "c", "d", "e" },
+            QStringLiteral("maximumLoads: 1; memoryLimit: %1").arg(feedUsage * 5 / 2)));
+    QVERIFY(cache);
+    QTRY_COMPARE(server.requests.count(), 3);
+    QTest::qWait(100);
+    QCOMPARE(server.requests.count(), 3);
+    QCOMPARE(server.order, QList<QByteArray>({ "a.xml", "b.xml", "c.xml" }));
+    QTRY_VERIFY(cache->memoryUsage() <= cache->memoryLimit());
+
+    // The feeds that were kept are not downloaded again
+    for (const char *name : { "a", "b" }) {
+        XmlListModel *model = cache->model(server.url(QLatin1String(name) + QLatin1String(".xml")));
+        QVERIFY(model);
+        QCOMPARE(model->status(), XmlListModel::Ready);
+        QCOMPARE(model->count(), 20);
+    }
+    QCOMPARE(server.requests.count(), 3);
+
+    // Raising the limit resumes prefetching
+    cache->setMemoryLimit(feedUsage * 6);
+    QTRY_COMPARE(server.requests.count(), 6);
+    QCOMPARE(server.requestCounts.value("c.xml"), 2);
+    QCOMPARE(server.requestCounts.value("e.xml"), 1);
+}
+
+QTEST_MAIN(tst_feedcache)
+
+#include "tst_feedcache.moc"
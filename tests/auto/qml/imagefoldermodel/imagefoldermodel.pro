@@ -0,0 +1,10 @@
+CONFIG += testcase
+TARGET = tst_imagefoldermodel
+QT += qml gui testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/photosurface
+
+HEADERS += ../../../../examples/demos/photosurface/imagefoldermodel.h
+SOURCES += tst_imagefoldermodel.cpp \
+           ../../../../examples/demos/photosurface/imagefoldermodel.cpp
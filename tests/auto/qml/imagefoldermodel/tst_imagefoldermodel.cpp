@@ -0,0 +1,197 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "imagefoldermodel.h"
+
+class tst_imagefoldermodel : public QObject
+{
+    Q_OBJECT
+public:
+    tst_imagefoldermodel() {}
+
+private slots:
+    void scan();
+    void batches();
+    void watch();
+    void missingFolder();
+    void changeFolder();
+
+private:
+    static bool writeImage(const QTemporaryDir &dir, const QString &fileName, const QSize &size);
+    static QVariant value(ImageFolderModel *model, const QString &fileName, int role);
+};
+
+bool tst_imagefoldermodel::writeImage(const QTemporaryDir &dir, const QString &fileName, const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::blue);
+    return image.save(dir.filePath(fileName), "png");
+}
+
+QVariant tst_imagefoldermodel::value(ImageFolderModel *model, const QString &fileName, int role)
+{
+    for (int row = 0; row < model->rowCount(); ++row) {
+        const QModelIndex index = model->index(row, 0);
+        if (index.data(ImageFolderModel::FileNameRole).toString() == fileName)
+            return index.data(role);
+    }
+    return QVariant();
+}
+
+void tst_imagefoldermodel::scan()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(writeImage(dir, QStringLiteral("wide.png"), QSize(40, 30)));
+    QVERIFY(writeImage(dir, QStringLiteral("tall.png"), QSize(10, 20)));
+    QVERIFY(writeImage(dir, QStringLiteral("UPPER.PNG"), QSize(5, 5)));
+    QFile notes(dir.filePath(QStringLiteral("notes.txt")));
+    QVERIFY(notes.open(QIODevice::WriteOnly));
+    notes.write("not an image");
+    notes.close();
+
+    ImageFolderModel model;
+    QCOMPARE(model.status(), ImageFolderModel::Null);
+    model.setFolder(QUrl::fromLocalFile(dir.path()));
+    QCOMPARE(model.status(), ImageFolderModel::Loading);
+    QTRY_COMPARE(model.status(), ImageFolderModel::Ready);
+
+    QCOMPARE(model.count(), 3);
+    QCOMPARE(value(&model, QStringLiteral("wide.png"), ImageFolderModel::ImageSizeRole).toSize(), QSize(40, 30));
+    QCOMPARE(value(&model, QStringLiteral("tall.png"), ImageFolderModel::ImageSizeRole).toSize(), QSize(10, 20));
+    QCOMPARE(value(&model, QStringLiteral("UPPER.PNG"), ImageFolderModel::ImageSizeRole).toSize(), QSize(5, 5));
+    QCOMPARE(value(&model, QStringLiteral("wide.png"), ImageFolderModel::FileUrlRole).toUrl(),
+             QUrl::fromLocalFile(dir.filePath(QStringLiteral("wide.png"))));
+    QVERIFY(!value(&model, QStringLiteral("notes.txt"), ImageFolderModel::FileNameRole).isValid());
+}
+
+void tst_imagefoldermodel::batches()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const int files = 600;
+    for (int i = 0; i < files; ++i)
+        QVERIFY(writeImage(dir, QStringLiteral("photo%1.png").arg(i), QSize(2, 1)));
+
+    ImageFolderModel model;
+    QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+    model.setFolder(QUrl::fromLocalFile(dir.path()));
+    QTRY_COMPARE(model.status(), ImageFolderModel::Ready);
+
+    QCOMPARE(model.count(), files);
+    QVERIFY(inserted.count() >= 3);
+    QCOMPARE(model.index(files - 1, 0).data(ImageFolderModel::ImageSizeRole).toSize(), QSize(2, 1));
+
+    // Sorted by name, whatever order the batches came in
+    QStringList names;
+    for (int row = 0; row < model.count(); ++row)
+        names.append(model.index(row, 0).data(ImageFolderModel::FileNameRole).toString());
+    QStringList sorted = names;
+    sorted.sort();
+    QCOMPARE(names, sorted);
+}
+
+void tst_imagefoldermodel::watch()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(writeImage(dir, QStringLiteral("first.png"), QSize(10, 10)));
+
+    ImageFolderModel model;
+    model.setFolder(QUrl::fromLocalFile(dir.path()));
+    QTRY_COMPARE(model.status(), ImageFolderModel::Ready);
+    QCOMPARE(model.count(), 1);
+
+    QVERIFY(writeImage(dir, QStringLiteral("second.png"), QSize(20, 10)));
+    QTRY_COMPARE(model.count(), 2);
+    QCOMPARE(value(&model, QStringLiteral("second.png"), ImageFolderModel::ImageSizeRole).toSize(), QSize(20, 10));
+
+    // Replaced, so that the directory itself changes
+    QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+    QVERIFY(writeImage(dir, QStringLiteral("first.tmp"), QSize(30, 40)));
+    QVERIFY(QFile::remove(dir.filePath(QStringLiteral("first.png"))));
+    QVERIFY(QFile::rename(dir.filePath(QStringLiteral("first.tmp")), dir.filePath(QStringLiteral("first.png"))));
+    QTRY_COMPARE(value(&model, QStringLiteral("first.png"), ImageFolderModel::ImageSizeRole).toSize(), QSize(30, 40));
+    QVERIFY(changed.count() > 0);
+    QCOMPARE(model.count(), 2);
+
+    QVERIFY(QFile::remove(dir.filePath(QStringLiteral("second.png"))));
+    QTRY_COMPARE(model.count(), 1);
+    QCOMPARE(model.index(0, 0).data(ImageFolderModel::FileNameRole).toString(), QStringLiteral("first.png"));
+}
+
+void tst_imagefoldermodel::missingFolder()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ImageFolderModel model;
+    model.setFolder(QUrl::fromLocalFile(dir.filePath(QStringLiteral("missing"))));
+    QTRY_COMPARE(model.status(), ImageFolderModel::Error);
+    QCOMPARE(model.count(), 0);
+}
+
+void tst_imagefoldermodel::changeFolder()
+{
+    QTemporaryDir first;
+    QTemporaryDir second;
+    QVERIFY(first.isValid());
+    QVERIFY(second.isValid());
+    for (int i = 0; i < 3; ++i)
+        QVERIFY(writeImage(first, QStringLiteral("first%1.png").arg(i), QSize(4, 4)));
+    QVERIFY(writeImage(second, QStringLiteral("second.png"), QSize(8, 8)));
+
+    ImageFolderModel model;
+    model.setFolder(QUrl::fromLocalFile(first.path()));
+    QTRY_COMPARE(model.status(), ImageFolderModel::Ready);
+    QCOMPARE(model.count(), 3);
+
+    QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+    model.setFolder(QUrl::fromLocalFile(second.path()));
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(model.count(), 0);
+    QTRY_COMPARE(model.status(), ImageFolderModel::Ready);
+    QCOMPARE(model.count(), 1);
+    QCOMPARE(model.index(0, 0).data(ImageFolderModel::ImageSizeRole).toSize(), QSize(8, 8));
+
+    model.setFolder(QUrl());
+    QCOMPARE(model.status(), ImageFolderModel::Null);
+    QCOMPARE(model.count(), 0);
+}
+
+QTEST_MAIN(tst_imagefoldermodel)
+
+#include "tst_imagefoldermodel.moc"
@@ -4,3 +4,9 @@ QT_FOR_CONFIG += qml-private
 qtConfig(private_tests): \
     SUBDIRS += qqmlparser
 
+SUBDIRS += imagefoldermodel \
+           stockmodel
+
+qtHaveModule(network): \
+    SUBDIRS += feedcache \
+               xmllistmodel
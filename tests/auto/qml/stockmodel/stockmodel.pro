@@ -0,0 +1,10 @@
+CONFIG += testcase
+TARGET = tst_stockmodel
+QT += qml testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/stocqt
+
+HEADERS += ../../../../examples/demos/stocqt/stockmodel.h
+SOURCES += tst_stockmodel.cpp \
+           ../../../../examples/demos/stocqt/stockmodel.cpp
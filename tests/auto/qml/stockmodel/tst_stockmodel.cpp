@@ -0,0 +1,320 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cmath>
+
+#include "stockmodel.h"
+
+class tst_stockmodel : public QObject
+{
+    Q_OBJECT
+public:
+    tst_stockmodel() {}
+
+private slots:
+    void parse();
+    void parseColumns();
+    void parseInvalid();
+    void load();
+    void missingFile();
+    void indexOf();
+    void ranges();
+    void rangeIndex();
+
+private:
+    static void loadDays(StockModel *model, const QTemporaryDir &dir);
+    static qint64 msecs(int year, int month, int day);
+    static bool writeFile(const QTemporaryDir &dir, const QString &fileName, const QByteArray &contents);
+};
+
+static const char prices[] =
+        "Date,Open,High,Low,Close,Volume,Ex-Dividend\n"
+        "2017-12-29,170.52,170.59,169.22,169.23,25643711.0,0.0\n"
+        "2017-12-28,171.0,171.85,170.48,171.08,15997739.0,0.0\n"
+        "2017-12-27,170.1,170.78,169.71,170.6,21672062.0,0.0\n";
+
+qint64 tst_stockmodel::msecs(int year, int month, int day)
+{
+    return QDateTime(QDate(year, month, day), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+}
+
+bool tst_stockmodel::writeFile(const QTemporaryDir &dir, const QString &fileName, const QByteArray &contents)
+{
+    QFile file(dir.filePath(fileName));
+    return file.open(QIODevice::WriteOnly) && file.write(contents) == contents.size();
+}
+
+void tst_stockmodel::parse()
+{
+    StockColumns columns;
+    QString errorString;
+    QVERIFY(StockModel::parse(prices, &columns, &errorString));
+    QCOMPARE(columns.size(), 3);
+    QCOMPARE(columns.date, QList<qint64>({ msecs(2017, 12, 29), msecs(2017, 12, 28), msecs(2017, 12, 27) }));
+    QCOMPARE(columns.open, QList<double>({ 170.52, 171.0, 170.1 }));
+    QCOMPARE(columns.high, QList<double>({ 170.59, 171.85, 170.78 }));
+    QCOMPARE(columns.low, QList<double>({ 169.22, 170.48, 169.71 }));
+    QCOMPARE(columns.close, QList<double>({ 169.23, 171.08, 170.6 }));
+    QCOMPARE(columns.volume, QList<qint64>({ 25643711, 15997739, 21672062 }));
+}
+
+void tst_stockmodel::parseColumns()
+{
+    // Named columns in another order, oldest first, with intraday times and CRLF line endings
+    const QByteArray csv =
+            "\"Volume\",\"Close\",\"Low\",\"High\",\"Open\",\"Date\"\r\n"
+            "100,2.5,1.0,3.0,2.0,2020-03-02 09:30\r\n"
+            "200,3.5,2.0,4.0,3.0,2020-03-02T09:31:30\r\n";
+    StockColumns columns;
+    QString errorString;
+    QVERIFY(StockModel::parse(csv, &columns, &errorString));
+    QCOMPARE(columns.size(), 2);
+    const qint64 day = msecs(2020, 3, 2);
+    QCOMPARE(columns.date, QList<qint64>({ day + (9 * 60 + 31) * 60000 + 30000, day + (9 * 60 + 30) * 60000 }));
+    QCOMPARE(columns.open, QList<double>({ 3.0, 2.0 }));
+    QCOMPARE(columns.close, QList<double>({ 3.5, 2.5 }));
+    QCOMPARE(columns.volume, QList<qint64>({ 200, 100 }));
+
+    QVERIFY(!StockModel::parse("Date,Open,High,Low,Close\n2020-03-02,1,2,3,4\n", &columns, &errorString));
+    QVERIFY(errorString.contains(QLatin1String("volume")));
+}
+
+void tst_stockmodel::parseInvalid()
+{
+    // No header, and rows that cannot be read
+    const QByteArray csv =
+            "2020-01-03,1,2,0.5,1.5,10\n"
+            "2020-01-02,1,2,0.5\n"
+            "2020-13-01,1,2,0.5,1.5,10\n"
+            "2020-01-01,1,two,0.5,1.5,10\n"
+            "\n"
+            "2019-12-31,1,2,0.5,1.5,20";
+    StockColumns columns;
+    QString errorString;
+    QVERIFY(StockModel::parse(csv, &columns, &errorString));
+    QCOMPARE(columns.date, QList<qint64>({ msecs(2020, 1, 3), msecs(2019, 12, 31) }));
+    QCOMPARE(columns.volume, QList<qint64>({ 10, 20 }));
+
+    QVERIFY(!StockModel::parse("Date,Open,High,Low,Close,Volume\n", &columns, &errorString));
+    QCOMPARE(columns.size(), 0);
+    QVERIFY(!StockModel::parse(QByteArray(), &columns, &errorString));
+}
+
+void tst_stockmodel::load()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(writeFile(dir, QStringLiteral("TEST.csv"), prices));
+
+    StockModel model;
+    QSignalSpy dataReady(&model, &StockModel::dataReady);
+    QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+    model.setDataFolder(QUrl::fromLocalFile(dir.path()));
+    model.setStockId(QStringLiteral("TEST"));
+    model.updateStock();
+    QVERIFY(!model.ready());
+    QTRY_COMPARE(dataReady.count(), 1);
+
+    QVERIFY(model.ready());
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(model.count(), 3);
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(model.stockPrice(), 169.23);
+    QCOMPARE(model.stockPriceChanged(), -1.85);
+    QCOMPARE(model.newest(), QDateTime(QDate(2017, 12, 29), QTime(0, 0), Qt::UTC));
+    QCOMPARE(model.oldest(), QDateTime(QDate(2017, 12, 27), QTime(0, 0), Qt::UTC));
+    QCOMPARE(model.index(1, 0).data(StockModel::HighRole).toDouble(), 171.85);
+    QCOMPARE(model.index(2, 0).data(StockModel::VolumeRole).toLongLong(), 21672062);
+
+    const QVariantMap row = model.get(1);
+    QCOMPARE(row.value(QStringLiteral("date")).toDateTime(), QDateTime(QDate(2017, 12, 28), QTime(0, 0), Qt::UTC));
+    QCOMPARE(row.value(QStringLiteral("close")).toDouble(), 171.08);
+    QVERIFY(model.get(3).isEmpty());
+
+    QCOMPARE(model.highestPrice(0, 2), 171.85);
+    QCOMPARE(model.highestPrice(2, 0), 171.85);
+    QCOMPARE(model.lowestPrice(0, 1), 169.22);
+    QCOMPARE(model.lowestPrice(2, 2), 169.71);
+    QCOMPARE(model.highestVolume(1, 2), qint64(21672062));
+    QCOMPARE(model.highestPrice(0, 3), 0.0);
+    QCOMPARE(model.highestVolume(-1, 2), qint64(0));
+
+    // Only the last of several loads is published
+    QVERIFY(writeFile(dir, QStringLiteral("OTHER.csv"), "2020-01-01,1,2,0.5,1.5,10\n"));
+    model.setStockId(QStringLiteral("OTHER"));
+    model.updateStock();
+    model.setStockId(QStringLiteral("TEST"));
+    model.updateStock();
+    model.setStockId(QStringLiteral("OTHER"));
+    model.updateStock();
+    QTRY_COMPARE(dataReady.count(), 2);
+    QTest::qWait(50);
+    QCOMPARE(dataReady.count(), 2);
+    QCOMPARE(model.count(), 1);
+    QCOMPARE(model.stockPrice(), 1.5);
+    QCOMPARE(model.stockPriceChanged(), 0.0);
+}
+
+void tst_stockmodel::missingFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    StockModel model;
+    QSignalSpy dataReady(&model, &StockModel::dataReady);
+    model.setDataFolder(QUrl::fromLocalFile(dir.path()));
+    model.setStockId(QStringLiteral("MISSING"));
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("Cannot load prices of MISSING")));
+    model.updateStock();
+    QTRY_COMPARE(dataReady.count(), 1);
+    QVERIFY(!model.ready());
+    QCOMPARE(model.count(), 0);
+    QVERIFY(!model.newest().isValid());
+    QCOMPARE(model.indexOf(QDateTime::currentDateTimeUtc()), -1);
+}
+
+// Loads the thirty days of April 2020, newest first
+void tst_stockmodel::loadDays(StockModel *model, const QTemporaryDir &dir)
+{
+    QByteArray csv = "Date,Open,High,Low,Close,Volume\n";
+    for (int day = 30; day >= 1; --day)
+        csv += QStringLiteral("2020-04-%1,1,2,0.5,1.5,10\n").arg(day, 2, 10, QLatin1Char('0')).toLatin1();
+    QVERIFY(writeFile(dir, QStringLiteral("DAYS.csv"), csv));
+
+    QSignalSpy dataReady(model, &StockModel::dataReady);
+    model->setDataFolder(QUrl::fromLocalFile(dir.path()));
+    model->setStockId(QStringLiteral("DAYS"));
+    model->updateStock();
+    QTRY_COMPARE(dataReady.count(), 1);
+    QCOMPARE(model->count(), 30);
+}
+
+void tst_stockmodel::indexOf()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StockModel model;
+    loadDays(&model, dir);
+    if (QTest::currentTestFailed())
+        return;
+
+    auto date = [](int month, int day, int hour = 0) {
+        return QDateTime(QDate(2020, month, day), QTime(hour, 0), Qt::UTC);
+    };
+    // The row after the closest one
+    QCOMPARE(model.indexOf(date(4, 23)), 8);
+    QCOMPARE(model.indexOf(date(4, 23, 11)), 8);
+    QCOMPARE(model.indexOf(date(4, 22, 11)), 9);
+    // After the newest row, a week before it
+    QCOMPARE(model.indexOf(date(5, 10)), 8);
+    // Before the oldest row
+    QCOMPARE(model.indexOf(date(4, 1)), 29);
+    QCOMPARE(model.indexOf(date(3, 1)), 29);
+    QCOMPARE(model.indexOf(QDateTime()), -1);
+}
+
+void tst_stockmodel::ranges()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StockModel model;
+    loadDays(&model, dir);
+    if (QTest::currentTestFailed())
+        return;
+
+    auto date = [](int month, int day, int hour = 0) {
+        return QDateTime(QDate(2020, month, day), QTime(hour, 0), Qt::UTC);
+    };
+    // Inclusive at both ends
+    QCOMPARE(model.startRow(date(4, 10), date(4, 20)), 20);
+    QCOMPARE(model.endRow(date(4, 10), date(4, 20)), 10);
+    QCOMPARE(model.startRow(date(4, 9, 12), date(4, 20, 12)), 20);
+    QCOMPARE(model.endRow(date(4, 9, 12), date(4, 20, 12)), 10);
+    QCOMPARE(model.startRow(date(4, 10, 12), date(4, 19, 12)), 19);
+    QCOMPARE(model.endRow(date(4, 10, 12), date(4, 19, 12)), 11);
+    // A single day
+    QCOMPARE(model.startRow(date(4, 15), date(4, 15)), 15);
+    QCOMPARE(model.endRow(date(4, 15), date(4, 15)), 15);
+    // Beyond the data
+    QCOMPARE(model.startRow(date(3, 1), date(6, 1)), 29);
+    QCOMPARE(model.endRow(date(3, 1), date(6, 1)), 0);
+    QCOMPARE(model.startRow(date(4, 25), date(6, 1)), 5);
+    QCOMPARE(model.endRow(date(4, 25), date(6, 1)), 0);
+    // No prices in the range
+    QCOMPARE(model.startRow(date(4, 15, 6), date(4, 15, 18)), -1);
+    QCOMPARE(model.endRow(date(4, 15, 6), date(4, 15, 18)), -1);
+    QCOMPARE(model.startRow(date(5, 1), date(6, 1)), -1);
+    QCOMPARE(model.endRow(date(3, 1), date(3, 31)), -1);
+    QCOMPARE(model.startRow(date(4, 20), date(4, 10)), -1);
+    QCOMPARE(model.endRow(QDateTime(), date(4, 10)), -1);
+}
+
+void tst_stockmodel::rangeIndex()
+{
+    QList<double> values;
+    QList<qint64> volumes;
+    for (int i = 0; i < 100; ++i) {
+        values.append(std::sin(i * 0.7) * 100 + i);
+        volumes.append((i * 7919) % 101);
+    }
+    StockRangeIndex<double> highest;
+    StockRangeIndex<double> lowest;
+    StockRangeIndex<qint64> highestVolume;
+    QVERIFY(highest.isEmpty());
+    highest.build(values, true);
+    lowest.build(values, false);
+    highestVolume.build(volumes, true);
+    QVERIFY(!highest.isEmpty());
+
+    // Every range against a scan
+    for (int first = 0; first < values.size(); ++first) {
+        for (int last = first; last < values.size(); ++last) {
+            const auto begin = values.cbegin() + first;
+            const auto end = values.cbegin() + last + 1;
+            QCOMPARE(highest.extreme(first, last), *std::max_element(begin, end));
+            QCOMPARE(lowest.extreme(first, last), *std::min_element(begin, end));
+            QCOMPARE(highestVolume.extreme(first, last),
+                     *std::max_element(volumes.cbegin() + first, volumes.cbegin() + last + 1));
+        }
+    }
+
+    highest.build(QList<double>(), true);
+    QVERIFY(highest.isEmpty());
+}
+
+QTEST_MAIN(tst_stockmodel)
+
+#include "tst_stockmodel.moc"
@@ -0,0 +1,1103 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QDir>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQmlListReference>
+
+#include "httpstandin.h"
+#include "xmllistmodel.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+class tst_xmllistmodel : public QObject
+{
+    Q_OBJECT
+public:
+    tst_xmllistmodel() {}
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void persistentCacheRevalidation();
+    void persistentCacheUpdate();
+    void appendOnlyRefresh();
+    void appendOnlyKnownKeys();
+    void lazyDecoding_data();
+    void lazyDecoding();
+    void mappedFile();
+    void unmappableFile();
+    void sharedValues();
+    void paging_data();
+    void paging();
+    void predicates_data();
+    void predicates();
+    void sorting();
+    void sortWhileLoading();
+    void keyedReload_data();
+    void keyedReload();
+    void streaming_data();
+    void streaming();
+    void sharedDownload();
+    void stats();
+    void abortLargeParse();
+    void queryPlanReuse();
+    void concurrentLoads();
+
+private:
+    XmlListModel *createModel(QQmlEngine *engine, const QUrl &source,
+                              const QString &properties = QString());
+    static QString title(XmlListModel *model, int row);
+    static QByteArray feed(const QStringList &titles);
+    static QByteArray keyedFeed(const QStringList &items);
+    static QByteArray largeFeed(int count);
+
+    HttpStandIn server;
+    QTemporaryDir traceDir;
+};
+
+void tst_xmllistmodel::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    // Read once, when the first phase of a query is traced
+    QVERIFY(traceDir.isValid());
+    qputenv("XMLLISTMODEL_TRACE_FILE", QFile::encodeName(traceDir.filePath(QStringLiteral("trace.json"))));
+    qmlRegisterType<XmlListModel>("XmlListModel", 1, 0, "XmlListModel");
+    qmlRegisterType<XmlListModelRole>("XmlListModel", 1, 0, "XmlListModelRole");
+    server.contentType = "application/xml";
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+}
+
+void tst_xmllistmodel::init()
+{
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+    server.reset();
+}
+
+XmlListModel *tst_xmllistmodel::createModel(QQmlEngine *engine, const QUrl &source,
+                                            const QString &properties)
+{
+    QQmlComponent component(engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    persistentCache: true\n"
+            "    roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" } ]\n"
+            "    %2\n"
+            "}\n").arg(source.toString(), properties).toUtf8(), QUrl());
+    if (component.isError())
+        qWarning() << component.errors();
+    return qobject_cast<XmlListModel *>(component.create());
+}
+
+QString tst_xmllistmodel::title(XmlListModel *model, int row)
+{
+    return model->data(model->index(row, 0, QModelIndex()), Qt::UserRole).toString();
+}
+
+QByteArray tst_xmllistmodel::feed(const QStringList &titles)
+{
+    QByteArray data = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>";
+    for (const QString &title : titles)
+        data += "<item><title>" + title.toUtf8() + "</title></item>";
+    return data + "</channel></rss>";
+}
+
+QByteArray tst_xmllistmodel::keyedFeed(const QStringList &items)
+{
+    // Each item is "title=description"; the title is the key
+    QByteArray data = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>";
+    for (const QString &item : items) {
+        const QStringList parts = item.split(QLatin1Char('='));
+        data += "<item><title>" + parts.at(0).toUtf8() + "</title><description>"
+                + parts.at(1).toUtf8() + "</description></item>";
+    }
+    return data + "</channel></rss>";
+}
+
+QByteArray tst_xmllistmodel::largeFeed(int count)
+{
+    QByteArray data = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>";
+    data.reserve(data.size() + count * 40);
+    for (int i = 0; i < count; ++i)
+        data += "<item><title>Item " + QByteArray::number(i) + "</title></item>";
+    return data + "</channel></rss>";
+}
+
+void tst_xmllistmodel::persistentCacheRevalidation()
+{
+    server.documents["feed.xml"] = feed({ "One", "Two", "Three" });
+    server.eTag = "\"v1\"";
+
+    {
+        QQmlEngine engine;
+        QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+        QVERIFY(model);
+        QTRY_COMPARE(model->status(), XmlListModel::Ready);
+        QCOMPARE(model->count(), 3);
+        QCOMPARE(server.fullResponses, 1);
+    }
+
+    // A cold start shows the cached rows before the server has answered
+    server.holdResponses = true;
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+    QVERIFY(model);
+    QTRY_COMPARE(model->count(), 3);
+    QCOMPARE(model->status(), XmlListModel::Loading);
+    QCOMPARE(title(model.data(), 2), QStringLiteral("Three"));
+
+    QTRY_COMPARE(server.requests.count(), 2);
+    QVERIFY(server.requests.last().contains("If-None-Match: \"v1\""));
+
+    server.release();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(server.notModifiedResponses, 1);
+    QCOMPARE(server.fullResponses, 1);
+    QCOMPARE(model->count(), 3);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("One"));
+}
+
+void tst_xmllistmodel::persistentCacheUpdate()
+{
+    server.documents["feed.xml"] = feed({ "One", "Two", "Three" });
+    server.eTag = "\"v1\"";
+
+    {
+        QQmlEngine engine;
+        QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+        QVERIFY(model);
+        QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    }
+
+    // A changed document replaces the cached rows and the cache itself
+    server.documents["feed.xml"] = feed({ "Four", "Five" });
+    server.eTag = "\"v2\"";
+    {
+        QQmlEngine engine;
+        QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+        QVERIFY(model);
+        QTRY_COMPARE(model->status(), XmlListModel::Ready);
+        QCOMPARE(model->count(), 2);
+        QCOMPARE(title(model.data(), 0), QStringLiteral("Four"));
+        QCOMPARE(server.fullResponses, 2);
+    }
+
+    server.holdResponses = true;
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+    QVERIFY(model);
+    QTRY_COMPARE(model->count(), 2);
+    QCOMPARE(title(model.data(), 1), QStringLiteral("Five"));
+    QTRY_COMPARE(server.requests.count(), 3);
+    QVERIFY(server.requests.last().contains("If-None-Match: \"v2\""));
+    server.release();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(server.notModifiedResponses, 1);
+}
+
+void tst_xmllistmodel::appendOnlyRefresh()
+{
+    server.documents["feed.xml"] = feed({ "One", "Two", "Three" });
+    server.eTag = "\"v1\"";
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml")),
+            QStringLiteral("keyRole: \"title\"; appendOnly: true")));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 3);
+
+    // Only the entries in front of the known ones are added, in one step
+    server.documents["feed.xml"] = feed({ "Minus", "Zero", "One", "Two", "Three" });
+    server.eTag = "\"v2\"";
+    QSignalSpy insertedSpy(model.data(), &QAbstractItemModel::rowsInserted);
+    QSignalSpy removedSpy(model.data(), &QAbstractItemModel::rowsRemoved);
+    QSignalSpy statusSpy(model.data(), &XmlListModel::statusChanged);
+    model->refresh();
+    QTRY_COMPARE(insertedSpy.count(), 1);
+    QCOMPARE(insertedSpy.first().at(1).toInt(), 0);
+    QCOMPARE(insertedSpy.first().at(2).toInt(), 1);
+    QCOMPARE(removedSpy.count(), 0);
+    QCOMPARE(model->count(), 5);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("Minus"));
+    QCOMPARE(title(model.data(), 2), QStringLiteral("One"));
+    QCOMPARE(model->status(), XmlListModel::Ready);
+    QVERIFY(server.requests.last().contains("If-None-Match: \"v1\""));
+    for (const QList<QVariant> &arguments : qAsConst(statusSpy))
+        QCOMPARE(arguments.at(0).value<XmlListModel::Status>(), XmlListModel::Ready);
+
+    // An unchanged feed is not downloaded again
+    model->refresh();
+    QTRY_COMPARE(server.notModifiedResponses, 1);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 5);
+    QCOMPARE(insertedSpy.count(), 1);
+}
+
+void tst_xmllistmodel::appendOnlyKnownKeys()
+{
+    QStringList titles;
+    for (int i = 0; i < 40; ++i)
+        titles.append(QStringLiteral("Item %1").arg(i));
+    server.documents["feed.xml"] = feed(titles);
+    server.eTag = "\"v1\"";
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml")),
+            QStringLiteral("keyRole: \"title\"; appendOnly: true")));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 40);
+
+    // A known entry moved to the top does not hide the new one after it
+    server.documents["feed.xml"] = feed(QStringList({ QStringLiteral("Item 5"), QStringLiteral("New") }) + titles);
+    server.eTag = "\"v2\"";
+    QSignalSpy insertedSpy(model.data(), &QAbstractItemModel::rowsInserted);
+    model->refresh();
+    QTRY_COMPARE(insertedSpy.count(), 1);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 41);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("New"));
+    QCOMPARE(title(model.data(), 1), QStringLiteral("Item 0"));
+
+    // Entries far down the model that come back, and new entries listed
+    // twice, are only added once
+    server.documents["feed.xml"] = feed({ QStringLiteral("Newer"), QStringLiteral("Item 35"),
+                                          QStringLiteral("Newer"), QStringLiteral("New"),
+                                          QStringLiteral("Item 0") });
+    server.eTag = "\"v3\"";
+    model->refresh();
+    QTRY_COMPARE(insertedSpy.count(), 2);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 42);
+    QCOMPARE(insertedSpy.last().at(1).toInt(), 0);
+    QCOMPARE(insertedSpy.last().at(2).toInt(), 0);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("Newer"));
+    QCOMPARE(title(model.data(), 1), QStringLiteral("New"));
+    QCOMPARE(title(model.data(), 37), QStringLiteral("Item 35"));
+    QSet<QString> keys;
+    for (int row = 0; row < model->count(); ++row)
+        keys.insert(title(model.data(), row));
+    QCOMPARE(keys.count(), 42);
+}
+
+void tst_xmllistmodel::lazyDecoding_data()
+{
+    QTest::addColumn<bool>("localFile");
+
+    QTest::newRow("network") << false;
+    QTest::newRow("local file") << true;
+}
+
+void tst_xmllistmodel::lazyDecoding()
+{
+    QFETCH(bool, localFile);
+
+    // Long descriptions with markup, entities and characters outside of
+    // ASCII and of the BMP are left in the source and decoded on access.
+    const QString longText = QString::fromUtf8("Caf\u00e9 \U0001F600 &amp; <b>bold</b> ").repeated(40);
+    const QString expected = QString::fromUtf8("Caf\u00e9 \U0001F600 & bold ").repeated(40);
+    QByteArray body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>";
+    for (int i = 0; i < 3; ++i) {
+        body += "<item><title>Item " + QByteArray::number(i) + "</title>"
+                "<description>" + QByteArray::number(i) + longText.toUtf8() + "</description>"
+                "<summary><![CDATA[" + QByteArray::number(i) + longText.toUtf8() + "]]></summary>"
+                "<short>Short &lt;" + QByteArray::number(i) + "&gt;</short></item>\n";
+    }
+    body += "</channel></rss>";
+
+    QUrl source;
+    QTemporaryDir dir;
+    if (localFile) {
+        QVERIFY(dir.isValid());
+        QFile file(dir.filePath(QStringLiteral("feed.xml")));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(body);
+        file.close();
+        source = QUrl::fromLocalFile(file.fileName());
+    } else {
+        server.documents["feed.xml"] = body;
+        server.eTag = "\"v1\"";
+        source = server.url(QStringLiteral("feed.xml"));
+    }
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    lazyDecoding: true\n"
+            "    roles: [\n"
+            "        XmlListModelRole { elementName: \"title\"; attributeName: \"\" },\n"
+            "        XmlListModelRole { elementName: \"description\"; attributeName: \"\" },\n"
+            "        XmlListModelRole { elementName: \"summary\"; attributeName: \"\" },\n"
+            "        XmlListModelRole { elementName: \"short\"; attributeName: \"\" }\n"
+            "    ]\n"
+            "}\n").arg(source.toString()).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 3);
+
+    for (int row = 0; row < 3; ++row) {
+        const QModelIndex index = model->index(row, 0, QModelIndex());
+        const QString number = QString::number(row);
+        QCOMPARE(model->data(index, Qt::UserRole).toString(), QStringLiteral("Item ") + number);
+        QCOMPARE(model->data(index, Qt::UserRole + 1).toString(), number + expected);
+        QCOMPARE(model->data(index, Qt::UserRole + 2).toString(), number + longText);
+        QCOMPARE(model->data(index, Qt::UserRole + 3).toString(), QStringLiteral("Short <%1>").arg(row));
+        // Served from the decoded values the second time
+        QCOMPARE(model->data(index, Qt::UserRole + 1).toString(), number + expected);
+    }
+}
+
+void tst_xmllistmodel::mappedFile()
+{
+    QStringList titles;
+    for (int i = 0; i < 1000; ++i)
+        titles.append(QStringLiteral("Item %1 ").arg(i) + QString(1000, QLatin1Char('x')));
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("feed.xml")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(feed(titles));
+    file.close();
+
+    // The values are left in the mapped file, which takes no memory of its own
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, QUrl::fromLocalFile(file.fileName()),
+                                                   QStringLiteral("lazyDecoding: true")));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), titles.count());
+    QVERIFY(model->memoryUsage() < file.size() / 4);
+    QCOMPARE(title(model.data(), 0), titles.at(0));
+    QCOMPARE(title(model.data(), 999), titles.at(999));
+}
+
+void tst_xmllistmodel::unmappableFile()
+{
+#ifdef Q_OS_UNIX
+    QStringList titles;
+    for (int i = 0; i < 3; ++i)
+        titles.append(QStringLiteral("Item %1 ").arg(i) + QString(300, QLatin1Char('x')));
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("feed.xml"));
+    QCOMPARE(::mkfifo(QFile::encodeName(fileName).constData(), 0600), 0);
+
+    // Opening a pipe blocks until it has a writer, so the event loop would
+    // stop if the model opened it on the GUI thread.
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, QUrl::fromLocalFile(fileName),
+                                                   QStringLiteral("lazyDecoding: true")));
+    QVERIFY(model);
+    QTest::qWait(50);
+    QCOMPARE(model->status(), XmlListModel::Loading);
+
+    // A pipe cannot be mapped, so it is read and its values are all decoded
+    QFile pipe(fileName);
+    QVERIFY(pipe.open(QIODevice::WriteOnly));
+    pipe.write(feed(titles));
+    pipe.close();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), titles.count());
+    for (int row = 0; row < titles.count(); ++row)
+        QCOMPARE(title(model.data(), row), titles.at(row));
+#else
+    QSKIP("Named pipes are only created on Unix");
+#endif
+}
+
+void tst_xmllistmodel::sharedValues()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("feed.xml")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>");
+    for (int i = 0; i < 10; ++i) {
+        file.write("<item><title>Item " + QByteArray::number(i) + "</title>"
+                   "<category>Category " + QByteArray::number(i % 2) + "</category>"
+                   "<description>" + QByteArray::number(i) + QByteArray(300, 'x') + "</description></item>");
+    }
+    file.write("</channel></rss>");
+    file.close();
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    lazyDecoding: true\n"
+            "    roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" },\n"
+            "             XmlListModelRole { elementName: \"category\"; attributeName: \"\" },\n"
+            "             XmlListModelRole { elementName: \"description\"; attributeName: \"\" } ]\n"
+            "}\n").arg(QUrl::fromLocalFile(file.fileName()).toString()).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 10);
+
+    const auto value = [&](int row, int role) {
+        return model->data(model->index(row, 0, QModelIndex()), Qt::UserRole + role).toString();
+    };
+
+    // Values that repeat across rows share a single copy
+    QCOMPARE(value(0, 1), QStringLiteral("Category 0"));
+    QCOMPARE(value(2, 1).constData(), value(0, 1).constData());
+    QCOMPARE(value(3, 1).constData(), value(1, 1).constData());
+    QVERIFY(value(0, 1).constData() != value(1, 1).constData());
+
+    // Scrolling back and forth reads the stored strings, and decodes long
+    // values only the first time, so data() does not copy anything
+    QList<const QChar *> first;
+    for (int row = 0; row < model->count(); ++row) {
+        for (int role = 0; role < 3; ++role)
+            first.append(value(row, role).constData());
+    }
+    QCOMPARE(value(5, 2), QStringLiteral("5") + QString(300, QLatin1Char('x')));
+    for (int pass = 0; pass < 2; ++pass) {
+        int i = 0;
+        for (int row = 0; row < model->count(); ++row) {
+            for (int role = 0; role < 3; ++role)
+                QCOMPARE(value(row, role).constData(), first.at(i++));
+        }
+    }
+}
+
+void tst_xmllistmodel::paging_data()
+{
+    QTest::addColumn<bool>("localFile");
+    QTest::addColumn<int>("limit");
+
+    QTest::newRow("network") << false << 2;
+    QTest::newRow("local file") << true << 2;
+    QTest::newRow("network, no rows") << false << 0;
+    QTest::newRow("local file, no rows") << true << 0;
+}
+
+void tst_xmllistmodel::paging()
+{
+    QFETCH(bool, localFile);
+    QFETCH(int, limit);
+
+    const QByteArray body = feed({ "One", "Two", "Three", "Four", "Five" });
+    QUrl source;
+    QTemporaryDir dir;
+    if (localFile) {
+        QVERIFY(dir.isValid());
+        QFile file(dir.filePath(QStringLiteral("feed.xml")));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(body);
+        file.close();
+        source = QUrl::fromLocalFile(file.fileName());
+    } else {
+        server.documents["feed.xml"] = body;
+        server.eTag = "\"v1\"";
+        source = server.url(QStringLiteral("feed.xml"));
+    }
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, source,
+            QStringLiteral("offset: 1; limit: %1").arg(limit)));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+
+    // A page of no rows has no next page either
+    if (limit == 0) {
+        QCOMPARE(model->count(), 0);
+        QVERIFY(!model->canFetchMore(QModelIndex()));
+        model->fetchMore(QModelIndex());
+        QCOMPARE(model->status(), XmlListModel::Ready);
+        return;
+    }
+
+    QCOMPARE(model->count(), 2);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("Two"));
+    QCOMPARE(title(model.data(), 1), QStringLiteral("Three"));
+    QVERIFY(model->canFetchMore(QModelIndex()));
+
+    // The next page continues where the previous one stopped
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->status(), XmlListModel::Loading);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 4);
+    QCOMPARE(title(model.data(), 2), QStringLiteral("Four"));
+    QCOMPARE(title(model.data(), 3), QStringLiteral("Five"));
+
+    // Only the end of the document is left
+    QVERIFY(model->canFetchMore(QModelIndex()));
+    model->fetchMore(QModelIndex());
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), 4);
+    QVERIFY(!model->canFetchMore(QModelIndex()));
+}
+
+void tst_xmllistmodel::predicates_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<QStringList>("titles");
+
+    QTest::newRow("element equals")
+            << QStringLiteral("/rss/channel/item[category='Tech']") << QStringList { "One", "Three" };
+    QTest::newRow("element not equals")
+            << QStringLiteral("/rss/channel/item[category!='Tech']") << QStringList { "Two", "Three" };
+    QTest::newRow("element contains")
+            << QStringLiteral("/rss/channel/item[contains(title, 'o')]") << QStringList { "Two" };
+    QTest::newRow("attribute equals")
+            << QStringLiteral("/rss/channel/item[@kind=\"video\"]") << QStringList { "Two", "Three" };
+    QTest::newRow("attribute contains")
+            << QStringLiteral("/rss/channel/item[contains(@link, 'a/b')]") << QStringList { "One" };
+    QTest::newRow("combined")
+            << QStringLiteral("/rss/channel/item[@kind='video'][category='Tech']") << QStringList { "Three" };
+    QTest::newRow("no match")
+            << QStringLiteral("/rss/channel/item[category='Sports']") << QStringList();
+}
+
+void tst_xmllistmodel::predicates()
+{
+    QFETCH(QString, query);
+    QFETCH(QStringList, titles);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("feed.xml")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>"
+               "<item kind=\"text\" link=\"http://a/b\"><title>One</title><category>Tech</category></item>"
+               "<item kind=\"video\"><title>Two</title><category>Science</category></item>"
+               "<item kind=\"video\"><category>Science</category><category>Tech</category><title>Three</title></item>"
+               "</channel></rss>");
+    file.close();
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"%2\"\n"
+            "    roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" } ]\n"
+            "}\n").arg(QUrl::fromLocalFile(file.fileName()).toString(),
+                       QString(query).replace(QLatin1Char('"'), QLatin1String("\\\""))).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+
+    QStringList result;
+    for (int row = 0; row < model->count(); ++row)
+        result.append(title(model.data(), row));
+    QCOMPARE(result, titles);
+}
+
+void tst_xmllistmodel::sorting()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("feed.xml")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?><rss><channel>"
+               "<item><title>Item 4</title><pubDate>Tue, 01 Dec 2020 09:00:00 +0000</pubDate></item>"
+               "<item><title>Item 2</title><pubDate>Sat, 05 Dec 2020 09:00:00 +0100</pubDate></item>"
+               "<item><title>Item 1</title><pubDate>Fri, 27 Nov 2020 18:30:00 -0500</pubDate></item>"
+               "<item><title>Item 3</title></item>"
+               "</channel></rss>");
+    file.close();
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    sortRole: \"pubDate\"\n"
+            "    sortOrder: Qt.DescendingOrder\n"
+            "    roles: [\n"
+            "        XmlListModelRole { elementName: \"title\"; attributeName: \"\" },\n"
+            "        XmlListModelRole { elementName: \"pubDate\"; attributeName: \"\" }\n"
+            "    ]\n"
+            "}\n").arg(QUrl::fromLocalFile(file.fileName()).toString()).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+    QSignalSpy insertedSpy(model.data(), &QAbstractItemModel::rowsInserted);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+
+    // The rows arrive sorted, in one go; items without a date go last
+    auto titles = [&model]() {
+        QStringList result;
+        for (int row = 0; row < model->count(); ++row)
+            result.append(title(model.data(), row));
+        return result;
+    };
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(titles(), QStringList({ "Item 2", "Item 4", "Item 1", "Item 3" }));
+
+    // Sorting again moves the rows that are there without reading the file
+    QSignalSpy layoutSpy(model.data(), &QAbstractItemModel::layoutChanged);
+    QPersistentModelIndex first = model->index(0, 0, QModelIndex());
+    model->setSortOrder(Qt::AscendingOrder);
+    QTRY_COMPARE(layoutSpy.count(), 1);
+    QCOMPARE(titles(), QStringList({ "Item 1", "Item 4", "Item 2", "Item 3" }));
+    QCOMPARE(first.row(), 2);
+
+    model->setSortRole(QStringLiteral("title"));
+    QTRY_COMPARE(layoutSpy.count(), 2);
+    QCOMPARE(titles(), QStringList({ "Item 1", "Item 2", "Item 3", "Item 4" }));
+
+    // Without a sort role the rows go back to the order of the file
+    model->setSortRole(QString());
+    QTRY_COMPARE(layoutSpy.count(), 3);
+    QCOMPARE(titles(), QStringList({ "Item 4", "Item 2", "Item 1", "Item 3" }));
+    QCOMPARE(insertedSpy.count(), 1);
+}
+
+void tst_xmllistmodel::sortWhileLoading()
+{
+    QStringList titles;
+    for (int i = 0; i < 100; ++i)
+        titles.append(QStringLiteral("Item %1").arg(i, 3, 10, QLatin1Char('0')));
+    server.documents["feed.xml"] = feed(titles);
+    server.partialBytes = server.documents.value("feed.xml").size() / 2;
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+    QVERIFY(model);
+    QTRY_VERIFY(model->rowCount(QModelIndex()) > 0);
+    QCOMPARE(model->status(), XmlListModel::Loading);
+
+    // The rows that are still loading are sorted once they are all in,
+    // without asking for the feed again
+    model->setSortRole(QStringLiteral("title"));
+    model->setSortOrder(Qt::DescendingOrder);
+    server.finish();
+    QTRY_COMPARE(title(model.data(), 0), titles.last());
+    QCOMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), titles.count());
+    QCOMPARE(title(model.data(), 99), titles.first());
+    QCOMPARE(server.requests.count(), 1);
+
+    // The order of the feed is kept to go back to
+    QSignalSpy layoutSpy(model.data(), &QAbstractItemModel::layoutChanged);
+    model->setSortRole(QString());
+    QTRY_COMPARE(layoutSpy.count(), 1);
+    QCOMPARE(title(model.data(), 0), titles.first());
+    QCOMPARE(title(model.data(), 99), titles.last());
+    QCOMPARE(server.requests.count(), 1);
+}
+
+void tst_xmllistmodel::keyedReload_data()
+{
+    QTest::addColumn<QStringList>("before");
+    QTest::addColumn<QStringList>("after");
+    QTest::addColumn<QStringList>("changes");
+
+    QTest::newRow("inserted")
+            << QStringList({ "A=a", "B=b", "C=c" })
+            << QStringList({ "A=a", "X=x", "B=b", "C=c", "Y=y" })
+            << QStringList({ "insert 1-1", "insert 4-4" });
+    QTest::newRow("removed")
+            << QStringList({ "A=a", "B=b", "C=c", "D=d" })
+            << QStringList({ "A=a", "D=d" })
+            << QStringList({ "remove 1-2" });
+    QTest::newRow("moved")
+            << QStringList({ "A=a", "B=b", "C=c", "D=d" })
+            << QStringList({ "D=d", "A=a", "B=b", "C=c" })
+            << QStringList({ "move 3-3 to 0" });
+    QTest::newRow("changed")
+            << QStringList({ "A=a", "B=b", "C=c" })
+            << QStringList({ "A=a", "B=x", "C=y" })
+            << QStringList({ "change 1-2" });
+    QTest::newRow("mixed")
+            << QStringList({ "A=a", "B=b", "C=c", "D=d", "E=e" })
+            << QStringList({ "F=f", "A=a", "D=d", "B=x", "E=e" })
+            << QStringList({ "remove 2-2", "move 2-2 to 1", "insert 0-0", "change 3-3" });
+    QTest::newRow("unchanged")
+            << QStringList({ "A=a", "B=b" })
+            << QStringList({ "A=a", "B=b" })
+            << QStringList();
+}
+
+void tst_xmllistmodel::keyedReload()
+{
+    QFETCH(QStringList, before);
+    QFETCH(QStringList, after);
+    QFETCH(QStringList, changes);
+
+    server.documents["feed.xml"] = keyedFeed(before);
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    keyRole: \"title\"\n"
+            "    roles: [\n"
+            "        XmlListModelRole { elementName: \"title\"; attributeName: \"\" },\n"
+            "        XmlListModelRole { elementName: \"description\"; attributeName: \"\" }\n"
+            "    ]\n"
+            "}\n").arg(server.url(QStringLiteral("feed.xml")).toString()).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), before.count());
+
+    QStringList log;
+    connect(model.data(), &QAbstractItemModel::rowsInserted, this,
+            [&log](const QModelIndex &, int first, int last) {
+        log.append(QStringLiteral("insert %1-%2").arg(first).arg(last));
+    });
+    connect(model.data(), &QAbstractItemModel::rowsRemoved, this,
+            [&log](const QModelIndex &, int first, int last) {
+        log.append(QStringLiteral("remove %1-%2").arg(first).arg(last));
+    });
+    connect(model.data(), &QAbstractItemModel::rowsMoved, this,
+            [&log](const QModelIndex &, int first, int last, const QModelIndex &, int row) {
+        log.append(QStringLiteral("move %1-%2 to %3").arg(first).arg(last).arg(row));
+    });
+    connect(model.data(), &QAbstractItemModel::dataChanged, this,
+            [&log](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        log.append(QStringLiteral("change %1-%2").arg(topLeft.row()).arg(bottomRight.row()));
+    });
+    QSignalSpy resetSpy(model.data(), &QAbstractItemModel::modelReset);
+
+    // The reload is applied as the smallest set of changes, in one go
+    server.documents["feed.xml"] = keyedFeed(after);
+    model->reload();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    model->disconnect(this);
+    QCOMPARE(log, changes);
+    QCOMPARE(resetSpy.count(), 0);
+
+    QStringList rows;
+    for (int row = 0; row < model->count(); ++row) {
+        rows.append(title(model.data(), row) + QLatin1Char('=')
+                    + model->data(model->index(row, 0, QModelIndex()), Qt::UserRole + 1).toString());
+    }
+    QCOMPARE(rows, after);
+}
+
+void tst_xmllistmodel::streaming_data()
+{
+    QTest::addColumn<QString>("properties");
+
+    QTest::newRow("plain") << QString();
+    // Nothing to diff against, so a first keyed load is streamed as well
+    QTest::newRow("keyed") << QStringLiteral("keyRole: \"title\"");
+    // Values left in the download are read from the part received so far
+    QTest::newRow("lazy decoding") << QStringLiteral("lazyDecoding: true");
+    QTest::newRow("persistent cache") << QStringLiteral("persistentCache: true; keyRole: \"title\"");
+}
+
+void tst_xmllistmodel::streaming()
+{
+    QFETCH(QString, properties);
+
+    // Long enough to be decoded lazily
+    QStringList titles;
+    for (int i = 0; i < 100; ++i)
+        titles.append(QStringLiteral("Item %1 ").arg(i) + QString(300, QLatin1Char('x')));
+    server.documents["feed.xml"] = feed(titles);
+    server.partialBytes = server.documents.value("feed.xml").size() / 2;
+
+    // The rows are shown as they are parsed
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item\"\n"
+            "    roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" } ]\n"
+            "    %2\n"
+            "}\n").arg(server.url(QStringLiteral("feed.xml")).toString(), properties).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> model(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(model);
+
+    QTRY_VERIFY(model->rowCount(QModelIndex()) > 0);
+    QCOMPARE(model->status(), XmlListModel::Loading);
+    QVERIFY(model->rowCount(QModelIndex()) < titles.count());
+    QCOMPARE(title(model.data(), 0), titles.at(0));
+
+    server.finish();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(model->count(), titles.count());
+    QCOMPARE(title(model.data(), 0), titles.at(0));
+    QCOMPARE(title(model.data(), 99), titles.at(99));
+}
+
+void tst_xmllistmodel::sharedDownload()
+{
+    server.documents["feed.xml"] = feed({ "One", "Two", "Three" });
+    server.eTag = "\"v1\"";
+    server.holdResponses = true;
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> items(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+    QVERIFY(items);
+    QQmlComponent component(&engine);
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"/rss/channel/item[title!='Two']\"\n"
+            "    roles: [ XmlListModelRole { elementName: \"title\"; attributeName: \"\" } ]\n"
+            "}\n").arg(server.url(QStringLiteral("feed.xml")).toString()).toUtf8(), QUrl());
+    QScopedPointer<XmlListModel> filtered(qobject_cast<XmlListModel *>(component.create()));
+    QVERIFY(filtered);
+
+    // Both models wait on one request, and read the document in one pass
+    QTRY_COMPARE(server.requests.count(), 1);
+    QTest::qWait(50);
+    QCOMPARE(server.requests.count(), 1);
+    server.release();
+
+    QTRY_COMPARE(items->status(), XmlListModel::Ready);
+    QTRY_COMPARE(filtered->status(), XmlListModel::Ready);
+    QCOMPARE(server.fullResponses, 1);
+    QCOMPARE(items->count(), 3);
+    QCOMPARE(title(items.data(), 1), QStringLiteral("Two"));
+    QCOMPARE(filtered->count(), 2);
+    QCOMPARE(title(filtered.data(), 0), QStringLiteral("One"));
+    QCOMPARE(title(filtered.data(), 1), QStringLiteral("Three"));
+
+    // A model that loads the source later starts a request of its own
+    filtered->reload();
+    QTRY_COMPARE(filtered->status(), XmlListModel::Ready);
+    QCOMPARE(server.requests.count(), 2);
+    QCOMPARE(filtered->count(), 2);
+
+    // So does one that loads it once the data has started to arrive; what
+    // was received is not kept for it
+    QStringList titles;
+    for (int i = 0; i < 100; ++i)
+        titles.append(QStringLiteral("Item %1").arg(i));
+    server.documents["partial.xml"] = feed(titles);
+    server.partialBytes = server.documents.value("partial.xml").size() / 2;
+    QScopedPointer<XmlListModel> first(createModel(&engine, server.url(QStringLiteral("partial.xml"))));
+    QVERIFY(first);
+    QTRY_VERIFY(first->count() > 0);
+    QScopedPointer<XmlListModel> late(createModel(&engine, server.url(QStringLiteral("partial.xml"))));
+    QVERIFY(late);
+    QTRY_COMPARE(server.requests.count(), 4);
+    QTRY_VERIFY(late->count() > 0);
+    server.finish();
+    QTRY_COMPARE(first->status(), XmlListModel::Ready);
+    QTRY_COMPARE(late->status(), XmlListModel::Ready);
+    QCOMPARE(first->count(), 100);
+    QCOMPARE(late->count(), 100);
+    QCOMPARE(title(late.data(), 99), QStringLiteral("Item 99"));
+}
+
+void tst_xmllistmodel::stats()
+{
+    server.documents["feed.xml"] = feed({ "One", "Two", "Three" });
+    server.eTag = "\"v1\"";
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, server.url(QStringLiteral("feed.xml"))));
+    QVERIFY(model);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+
+    const XmlListModelStats *stats = model->stats();
+    QCOMPARE(stats->bytesReceived(), qint64(server.documents.value("feed.xml").size()));
+    QCOMPARE(stats->rowsProduced(), 3);
+    QVERIFY(stats->networkWait() > 0);
+    QVERIFY(stats->parseTime() > 0);
+    QVERIFY(stats->queueWait() >= 0);
+    QVERIFY(stats->applyTime() > 0);
+    QVERIFY(stats->totalTime() >= stats->networkWait() + stats->parseTime());
+
+    // Every phase is in the trace
+    QFile trace(traceDir.filePath(QStringLiteral("trace.json")));
+    QVERIFY(trace.open(QIODevice::ReadOnly));
+    const QByteArray events = trace.readAll();
+    QVERIFY(events.startsWith("[\n"));
+    for (const char *phase : { "network wait", "queued", "parse", "apply", "load" })
+        QVERIFY2(events.contains("\"name\":\"" + QByteArray(phase) + "\""), phase);
+
+    // Loading again starts over
+    server.eTag = "\"v2\"";
+    QSignalSpy changedSpy(stats, &XmlListModelStats::changed);
+    model->reload();
+    QVERIFY(changedSpy.count() > 0);
+    QCOMPARE(stats->rowsProduced(), 0);
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(stats->rowsProduced(), 3);
+}
+
+void tst_xmllistmodel::abortLargeParse()
+{
+    QQmlEngine engine;
+    XmlListModelQueryEngine *queryEngine = XmlListModelQueryEngine::instance(&engine);
+    XmlListModelRole role;
+    role.setElementName(QStringLiteral("title"));
+    const QSharedPointer<const XmlListModelQueryPlan> plan =
+            XmlListModelQueryEngine::compileQuery(QStringLiteral("/rss/channel/item"), { &role });
+
+    QSet<int> available;
+    QSet<int> completed;
+    connect(queryEngine, &XmlListModelQueryEngine::rowsAvailable, this,
+            [&](const XmlListModelQueryResult &result) { available.insert(result.queryId); });
+    connect(queryEngine, &XmlListModelQueryEngine::queryCompleted, this,
+            [&](const XmlListModelQueryResult &result) { completed.insert(result.queryId); });
+
+    // Every worker is kept busy with a document of many slices
+    const QByteArray large = largeFeed(500000);
+    QList<int> ids;
+    for (int i = 0; i < qMax(1, QThread::idealThreadCount()); ++i)
+        ids.append(queryEngine->doQuery(plan, large));
+    QTRY_VERIFY(available.contains(ids.first()));
+
+    // Aborted parses stop within their current slice, and never complete
+    for (int id : qAsConst(ids))
+        queryEngine->abort(id);
+    const int small = queryEngine->doQuery(plan, feed({ "One", "Two", "Three" }));
+    QTRY_VERIFY_WITH_TIMEOUT(completed.contains(small), 1000);
+    QTest::qWait(100);
+    for (int id : qAsConst(ids))
+        QVERIFY(!completed.contains(id));
+}
+
+void tst_xmllistmodel::concurrentLoads()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile largeFile(dir.filePath(QStringLiteral("large.xml")));
+    QVERIFY(largeFile.open(QIODevice::WriteOnly));
+    largeFile.write(largeFeed(200000));
+    largeFile.close();
+    QFile smallFile(dir.filePath(QStringLiteral("small.xml")));
+    QVERIFY(smallFile.open(QIODevice::WriteOnly));
+    smallFile.write(feed({ "One", "Two", "Three" }));
+    smallFile.close();
+
+    // The large feed is loaded first, yet the small one does not wait for it
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> large(createModel(&engine, QUrl::fromLocalFile(largeFile.fileName())));
+    QScopedPointer<XmlListModel> small(createModel(&engine, QUrl::fromLocalFile(smallFile.fileName())));
+    QVERIFY(large && small);
+    QStringList ready;
+    connect(large.data(), &XmlListModel::statusChanged, this, [&]() {
+        if (large->status() == XmlListModel::Ready)
+            ready.append(QStringLiteral("large"));
+    });
+    connect(small.data(), &XmlListModel::statusChanged, this, [&]() {
+        if (small->status() == XmlListModel::Ready)
+            ready.append(QStringLiteral("small"));
+    });
+
+    QTRY_COMPARE_WITH_TIMEOUT(ready.count(), 2, 30000);
+    QCOMPARE(ready, QStringList({ QStringLiteral("small"), QStringLiteral("large") }));
+    QCOMPARE(small->count(), 3);
+    QCOMPARE(large->count(), 200000);
+}
+
+static int invalidQueryWarnings = 0;
+
+static void countInvalidQueryWarnings(QtMsgType type, const QMessageLogContext &, const QString &message)
+{
+    if (type == QtWarningMsg && message.contains(QLatin1String("invalid predicate")))
+        ++invalidQueryWarnings;
+}
+
+void tst_xmllistmodel::queryPlanReuse()
+{
+    // A query with an invalid predicate is reported each time it is compiled
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("feed.xml")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(feed({ "One", "Two", "Three" }));
+    file.close();
+
+    invalidQueryWarnings = 0;
+    const QtMessageHandler previousHandler = qInstallMessageHandler(countInvalidQueryWarnings);
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, QUrl::fromLocalFile(file.fileName())));
+    QVERIFY(model);
+    model->setQuery(QStringLiteral("/rss/channel/item[title]"));
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(invalidQueryWarnings, 1);
+
+    // Reloads reuse the plan
+    model->reload();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    model->reload();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(invalidQueryWarnings, 1);
+
+    // A change of the roles or of the query compiles it again
+    QQmlListReference roles(model.data(), "roles");
+    XmlListModelRole *role = qobject_cast<XmlListModelRole *>(roles.at(0));
+    QVERIFY(role);
+    role->setElementName(QStringLiteral("description"));
+    model->reload();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(invalidQueryWarnings, 2);
+
+    model->setQuery(QStringLiteral("/rss/channel/item[category]"));
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(invalidQueryWarnings, 3);
+    model->reload();
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QCOMPARE(invalidQueryWarnings, 3);
+
+    // The plan of a valid query is used as soon as it replaces the old one
+    role->setElementName(QStringLiteral("title"));
+    model->setQuery(QStringLiteral("/rss/channel/item"));
+    QTRY_COMPARE(model->status(), XmlListModel::Ready);
+    QTRY_COMPARE(model->count(), 3);
+    QCOMPARE(title(model.data(), 0), QStringLiteral("One"));
+    QCOMPARE(invalidQueryWarnings, 3);
+    qInstallMessageHandler(previousHandler);
+}
+
+QTEST_MAIN(tst_xmllistmodel)
+
+#include "tst_xmllistmodel.moc"
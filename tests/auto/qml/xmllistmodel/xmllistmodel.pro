@@ -0,0 +1,12 @@
+CONFIG += testcase
+TARGET = tst_xmllistmodel
+QT += qml network testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/shared \
+               ../../shared
+
+HEADERS += ../../shared/httpstandin.h \
+           ../../../../examples/demos/shared/xmllistmodel.h
+SOURCES += tst_xmllistmodel.cpp \
+           ../../../../examples/demos/shared/xmllistmodel.cpp
@@ -0,0 +1,10 @@
+CONFIG += testcase
+TARGET = tst_mipmapimage
+QT += quick testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/photosurface
+
+HEADERS += ../../../../examples/demos/photosurface/mipmapimage.h
+SOURCES += tst_mipmapimage.cpp \
+           ../../../../examples/demos/photosurface/mipmapimage.cpp
@@ -0,0 +1,207 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QQuickWindow>
+
+#include "mipmapimage.h"
+
+class tst_mipmapimage : public QObject
+{
+    Q_OBJECT
+public:
+    tst_mipmapimage() {}
+
+private slots:
+    void initTestCase();
+
+    void levelFor_data();
+    void levelFor();
+    void levelSize_data();
+    void levelSize();
+    void readLevel();
+    void zoom();
+    void swapSource();
+
+private:
+    QTemporaryDir dir;
+    QString fileName;
+};
+
+void tst_mipmapimage::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    QImage image(800, 600, QImage::Format_RGB32);
+    image.fill(Qt::darkRed);
+    fileName = dir.filePath(QStringLiteral("photo.png"));
+    QVERIFY(image.save(fileName));
+}
+
+void tst_mipmapimage::levelFor_data()
+{
+    QTest::addColumn<QSize>("sourceSize");
+    QTest::addColumn<QSizeF>("displaySize");
+    QTest::addColumn<int>("level");
+
+    QTest::newRow("thumbnail") << QSize(6000, 4000) << QSizeF(200, 133.3) << 4;
+    QTest::newRow("zoomed in") << QSize(6000, 4000) << QSizeF(2000, 1333.3) << 1;
+    QTest::newRow("actual size") << QSize(800, 600) << QSizeF(800, 600) << 0;
+    QTest::newRow("larger than actual size") << QSize(800, 600) << QSizeF(1600, 1200) << 0;
+    QTest::newRow("just under half") << QSize(800, 600) << QSizeF(399, 299) << 1;
+    QTest::newRow("other aspect ratio") << QSize(800, 600) << QSizeF(100, 300) << 1;
+    QTest::newRow("tiny") << QSize(800, 600) << QSizeF(1, 1) << 9;
+    QTest::newRow("not shown") << QSize(800, 600) << QSizeF() << 9;
+}
+
+void tst_mipmapimage::levelFor()
+{
+    QFETCH(QSize, sourceSize);
+    QFETCH(QSizeF, displaySize);
+    QFETCH(int, level);
+
+    QCOMPARE(MipmapImage::levelFor(sourceSize, displaySize), level);
+}
+
+void tst_mipmapimage::levelSize_data()
+{
+    QTest::addColumn<QSize>("sourceSize");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("full size") << QSize(800, 600) << 0 << QSize(800, 600);
+    QTest::newRow("quarter") << QSize(800, 600) << 2 << QSize(200, 150);
+    QTest::newRow("rounded up") << QSize(801, 601) << 1 << QSize(401, 301);
+    QTest::newRow("never empty") << QSize(3, 3) << 4 << QSize(1, 1);
+}
+
+void tst_mipmapimage::levelSize()
+{
+    QFETCH(QSize, sourceSize);
+    QFETCH(int, level);
+    QFETCH(QSize, size);
+
+    QCOMPARE(MipmapImage::levelSize(sourceSize, level), size);
+}
+
+void tst_mipmapimage::readLevel()
+{
+    int level = -1;
+    QSize sourceSize;
+    QImage image = MipmapImage::readLevel(fileName, QSizeF(200, 150), &level, &sourceSize);
+    QCOMPARE(level, 2);
+    QCOMPARE(sourceSize, QSize(800, 600));
+    QCOMPARE(image.size(), QSize(200, 150));
+    QCOMPARE(image.pixel(100, 75), QColor(Qt::darkRed).rgb());
+
+    level = 1;
+    image = MipmapImage::readLevel(fileName, QSizeF(200, 150), &level, &sourceSize);
+    QCOMPARE(level, 1);
+    QCOMPARE(image.size(), QSize(400, 300));
+
+    QString errorString;
+    level = -1;
+    image = MipmapImage::readLevel(dir.filePath(QStringLiteral("missing.png")), QSizeF(200, 150),
+                                   &level, &sourceSize, &errorString);
+    QVERIFY(image.isNull());
+    QVERIFY(!errorString.isEmpty());
+}
+
+void tst_mipmapimage::zoom()
+{
+    QQuickWindow window;
+    window.resize(400, 300);
+    MipmapImage *image = new MipmapImage(window.contentItem());
+    image->setTransformOrigin(QQuickItem::TopLeft);
+    image->setSize(QSizeF(800, 600));
+    image->setScale(0.25);
+    image->setSource(QUrl::fromLocalFile(fileName));
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    QTRY_COMPARE(image->status(), MipmapImage::Ready);
+    QCOMPARE(image->sourceSize(), QSize(800, 600));
+    QTRY_COMPARE(image->level(), 2);
+
+    // Finer levels are loaded right away
+    image->setScale(1);
+    QTRY_COMPARE(image->level(), 0);
+
+    // Coarser ones only once the item stays zoomed out
+    QSignalSpy levelChanged(image, &MipmapImage::levelChanged);
+    image->setScale(0.5);
+    QTest::qWait(100);
+    QCOMPARE(levelChanged.count(), 0);
+    QTRY_COMPARE(image->level(), 1);
+
+    image->setSource(QUrl());
+    QCOMPARE(image->status(), MipmapImage::Null);
+    QCOMPARE(image->level(), -1);
+}
+
+void tst_mipmapimage::swapSource()
+{
+    QImage other(400, 200, QImage::Format_RGB32);
+    other.fill(Qt::darkBlue);
+    const QString otherFileName = dir.filePath(QStringLiteral("other.png"));
+    QVERIFY(other.save(otherFileName));
+
+    QQuickWindow window;
+    window.resize(400, 300);
+    MipmapImage *image = new MipmapImage(window.contentItem());
+    image->setSize(QSizeF(400, 300));
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    QList<QSize> sourceSizes;
+    connect(image, &MipmapImage::sourceSizeChanged, this, [&sourceSizes, image]() {
+        sourceSizes.append(image->sourceSize());
+    });
+
+    // The first level is decoded, and queued for the item, before the
+    // source changes; it must not be shown for the new source.
+    image->setSource(QUrl::fromLocalFile(fileName));
+    QCOMPARE(image->status(), MipmapImage::Loading);
+    QThreadPool::globalInstance()->waitForDone();
+    image->setSource(QUrl::fromLocalFile(otherFileName));
+
+    QTRY_COMPARE(image->status(), MipmapImage::Ready);
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+    QCOMPARE(image->sourceSize(), QSize(400, 200));
+    QCOMPARE(sourceSizes, QList<QSize>({ QSize(400, 200) }));
+    image->disconnect(this);
+}
+
+QTEST_MAIN(tst_mipmapimage)
+
+#include "tst_mipmapimage.moc"
@@ -0,0 +1,14 @@
+CONFIG += testcase
+TARGET = tst_photoprovider
+QT += quick network testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/photoviewer \
+               ../../shared
+
+HEADERS += ../../shared/httpstandin.h \
+           ../../../../examples/demos/photoviewer/photoprovider.h \
+           ../../../../examples/demos/photoviewer/photovisibility.h
+SOURCES += tst_photoprovider.cpp \
+           ../../../../examples/demos/photoviewer/photoprovider.cpp \
+           ../../../../examples/demos/photoviewer/photovisibility.cpp
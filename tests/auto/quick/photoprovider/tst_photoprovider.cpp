@@ -0,0 +1,370 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QBuffer>
+#include <QImageWriter>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "httpstandin.h"
+#include "photoprovider.h"
+#include "photovisibility.h"
+
+class tst_photoprovider : public QObject
+{
+    Q_OBJECT
+public:
+    tst_photoprovider() {}
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void fittedSize_data();
+    void fittedSize();
+    void thumbnail_data();
+    void thumbnail();
+    void fullResolution();
+    void localFile();
+    void cacheLimit();
+    void errors();
+    void cancel();
+    void priority_data();
+    void priority();
+    void scheduling();
+    void cancelPending();
+
+private:
+    static QByteArray encode(const QImage &image, const char *format);
+    static QString id(const char *kind, const QUrl &url);
+    static QImage result(QQuickImageResponse *response, QString *errorString = nullptr);
+
+    HttpStandIn server;
+};
+
+void tst_photoprovider::initTestCase()
+{
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+}
+
+void tst_photoprovider::init()
+{
+    server.documents.clear();
+    server.reset();
+}
+
+QByteArray tst_photoprovider::encode(const QImage &image, const char *format)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, format);
+    if (!writer.write(image))
+        qWarning() << writer.errorString();
+    return buffer.data();
+}
+
+QString tst_photoprovider::id(const char *kind, const QUrl &url)
+{
+    return QLatin1String(kind) + QLatin1Char('/') + QString::fromLatin1(QUrl::toPercentEncoding(url.toString()));
+}
+
+/*
+Waits for the response and returns the image it produced. The response
+is deleted afterwards, as the pixmap reader would.
+*/
+QImage tst_photoprovider::result(QQuickImageResponse *response, QString *errorString)
+{
+    QScopedPointer<QQuickImageResponse> guard(response);
+    QSignalSpy finished(response, &QQuickImageResponse::finished);
+    if (!finished.wait())
+        return QImage();
+    if (errorString)
+        *errorString = response->errorString();
+    QScopedPointer<QQuickTextureFactory> factory(response->textureFactory());
+    return factory ? factory->image() : QImage();
+}
+
+void tst_photoprovider::fittedSize_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QSize>("bounds");
+    QTest::addColumn<QSize>("fitted");
+
+    QTest::newRow("landscape") << QSize(800, 600) << QSize(100, 100) << QSize(100, 75);
+    QTest::newRow("portrait") << QSize(600, 800) << QSize(100, 100) << QSize(75, 100);
+    QTest::newRow("width only") << QSize(800, 600) << QSize(200, 0) << QSize(200, 150);
+    QTest::newRow("height only") << QSize(800, 600) << QSize(-1, 300) << QSize(400, 300);
+    QTest::newRow("unbounded") << QSize(800, 600) << QSize() << QSize(800, 600);
+    QTest::newRow("never upscaled") << QSize(80, 60) << QSize(100, 100) << QSize(80, 60);
+    QTest::newRow("thin") << QSize(1000, 1) << QSize(10, 10) << QSize(10, 1);
+}
+
+void tst_photoprovider::fittedSize()
+{
+    QFETCH(QSize, size);
+    QFETCH(QSize, bounds);
+    QFETCH(QSize, fitted);
+
+    QCOMPARE(PhotoProvider::fittedSize(size, bounds), fitted);
+}
+
+void tst_photoprovider::thumbnail_data()
+{
+    QTest::addColumn<QByteArray>("format");
+
+    QTest::newRow("png") << QByteArray("png");
+    QTest::newRow("jpeg") << QByteArray("jpeg");
+}
+
+void tst_photoprovider::thumbnail()
+{
+    QFETCH(QByteArray, format);
+    if (!QImageWriter::supportedImageFormats().contains(format))
+        QSKIP("Image format not supported");
+
+    QImage photo(800, 600, QImage::Format_RGB32);
+    photo.fill(Qt::darkGreen);
+    server.documents.insert("photo", encode(photo, format));
+
+    PhotoProvider provider;
+    QImage thumbnail = result(provider.requestImageResponse(id("thumbnail", server.url("photo")), QSize(100, 100)));
+    QCOMPARE(thumbnail.size(), QSize(100, 75));
+    QCOMPARE(server.requestCounts.value("photo"), 1);
+    QCOMPARE(provider.thumbnailCacheUsage(), qint64(thumbnail.sizeInBytes()));
+
+    // Served from the cache
+    thumbnail = result(provider.requestImageResponse(id("thumbnail", server.url("photo")), QSize(100, 100)));
+    QCOMPARE(thumbnail.size(), QSize(100, 75));
+    QCOMPARE(server.requestCounts.value("photo"), 1);
+
+    // Other sizes are decoded again
+    thumbnail = result(provider.requestImageResponse(id("thumbnail", server.url("photo")), QSize(0, 60)));
+    QCOMPARE(thumbnail.size(), QSize(80, 60));
+    QCOMPARE(server.requestCounts.value("photo"), 2);
+}
+
+void tst_photoprovider::fullResolution()
+{
+    QImage photo(800, 600, QImage::Format_RGB32);
+    photo.fill(Qt::darkBlue);
+    server.documents.insert("photo", encode(photo, "png"));
+
+    PhotoProvider provider;
+    QImage image = result(provider.requestImageResponse(id("full", server.url("photo")), QSize()));
+    QCOMPARE(image.size(), QSize(800, 600));
+    QCOMPARE(image.pixel(400, 300), photo.pixel(400, 300));
+    QCOMPARE(provider.thumbnailCacheUsage(), qint64(0));
+
+    image = result(provider.requestImageResponse(id("full", server.url("photo")), QSize()));
+    QCOMPARE(image.size(), QSize(800, 600));
+    QCOMPARE(server.requestCounts.value("photo"), 2);
+}
+
+void tst_photoprovider::localFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QImage photo(400, 400, QImage::Format_RGB32);
+    photo.fill(Qt::red);
+    const QString fileName = dir.filePath(QStringLiteral("photo.png"));
+    QVERIFY(photo.save(fileName));
+
+    PhotoProvider provider;
+    const QImage thumbnail = result(provider.requestImageResponse(
+            id("thumbnail", QUrl::fromLocalFile(fileName)), QSize(50, 50)));
+    QCOMPARE(thumbnail.size(), QSize(50, 50));
+}
+
+void tst_photoprovider::cacheLimit()
+{
+    QImage photo(800, 600, QImage::Format_RGB32);
+    photo.fill(Qt::gray);
+    server.documents.insert("first", encode(photo, "png"));
+    server.documents.insert("second", encode(photo, "png"));
+
+    PhotoProvider provider;
+    QImage thumbnail = result(provider.requestImageResponse(id("thumbnail", server.url("first")), QSize(100, 100)));
+    QCOMPARE(thumbnail.size(), QSize(100, 75));
+    // Room for one thumbnail only
+    provider.setThumbnailCacheSize(thumbnail.sizeInBytes() * 3 / 2);
+    QCOMPARE(provider.thumbnailCacheSize(), qint64(thumbnail.sizeInBytes() * 3 / 2));
+
+    result(provider.requestImageResponse(id("thumbnail", server.url("second")), QSize(100, 100)));
+    QCOMPARE(provider.thumbnailCacheUsage(), qint64(thumbnail.sizeInBytes()));
+    result(provider.requestImageResponse(id("thumbnail", server.url("second")), QSize(100, 100)));
+    QCOMPARE(server.requestCounts.value("second"), 1);
+
+    // The first one was evicted
+    result(provider.requestImageResponse(id("thumbnail", server.url("first")), QSize(100, 100)));
+    QCOMPARE(server.requestCounts.value("first"), 2);
+}
+
+void tst_photoprovider::errors()
+{
+    server.documents.insert("broken", "not an image");
+
+    PhotoProvider provider;
+    QString errorString;
+    QImage image = result(provider.requestImageResponse(id("thumbnail", server.url("missing")), QSize(100, 100)), &errorString);
+    QVERIFY(image.isNull());
+    QVERIFY(!errorString.isEmpty());
+
+    errorString.clear();
+    image = result(provider.requestImageResponse(id("full", server.url("broken")), QSize()), &errorString);
+    QVERIFY(image.isNull());
+    QVERIFY(!errorString.isEmpty());
+
+    errorString.clear();
+    image = result(provider.requestImageResponse(QStringLiteral("unknown"), QSize()), &errorString);
+    QVERIFY(image.isNull());
+    QVERIFY(!errorString.isEmpty());
+    QCOMPARE(provider.thumbnailCacheUsage(), qint64(0));
+}
+
+void tst_photoprovider::cancel()
+{
+    QImage photo(800, 600, QImage::Format_RGB32);
+    photo.fill(Qt::yellow);
+    server.documents.insert("photo", encode(photo, "png"));
+    server.holdResponses = true;
+
+    PhotoProvider provider;
+    QScopedPointer<QQuickImageResponse> response(
+            provider.requestImageResponse(id("thumbnail", server.url("photo")), QSize(100, 100)));
+    QSignalSpy finished(response.data(), &QQuickImageResponse::finished);
+    QTRY_COMPARE(server.requestCounts.value("photo"), 1);
+    response->cancel();
+    server.release();
+
+    QVERIFY(!finished.wait(200));
+    QCOMPARE(provider.thumbnailCacheUsage(), qint64(0));
+}
+
+void tst_photoprovider::priority_data()
+{
+    QTest::addColumn<QRectF>("rect");
+    QTest::addColumn<QRectF>("previous");
+    QTest::addColumn<int>("priority");
+
+    // In a 800x480 window
+    QTest::newRow("visible") << QRectF(100, 100, 140, 133) << QRectF() << 0;
+    QTest::newRow("partly visible") << QRectF(-50, 400, 140, 133) << QRectF() << 0;
+    QTest::newRow("below") << QRectF(100, 580, 140, 133) << QRectF() << 100;
+    QTest::newRow("below, still") << QRectF(100, 580, 140, 133) << QRectF(100, 580, 140, 133) << 100;
+    QTest::newRow("below, approaching") << QRectF(100, 580, 140, 133) << QRectF(100, 600, 140, 133) << 100;
+    QTest::newRow("below, receding") << QRectF(100, 580, 140, 133) << QRectF(100, 560, 140, 133)
+                                     << PhotoProvider::Deferred;
+    QTest::newRow("below, past one screen") << QRectF(100, 1000, 140, 133) << QRectF() << PhotoProvider::Deferred;
+    QTest::newRow("beside") << QRectF(1400, 100, 140, 133) << QRectF() << 600;
+    QTest::newRow("beside, past one screen") << QRectF(1700, 100, 140, 133) << QRectF() << PhotoProvider::Deferred;
+}
+
+void tst_photoprovider::priority()
+{
+    QFETCH(QRectF, rect);
+    QFETCH(QRectF, previous);
+    QFETCH(int, priority);
+
+    QCOMPARE(PhotoVisibility::priorityFor(rect, previous, QRectF(0, 0, 800, 480)), priority);
+}
+
+void tst_photoprovider::scheduling()
+{
+    QImage photo(200, 200, QImage::Format_RGB32);
+    photo.fill(Qt::cyan);
+    const QByteArray data = encode(photo, "png");
+    const QList<QByteArray> names = { "first", "far", "deferred", "near", "visible" };
+    for (const QByteArray &name : names)
+        server.documents.insert(name, data);
+    server.holdResponses = true;
+
+    PhotoProvider provider;
+    provider.setMaximumDownloads(1);
+    QCOMPARE(provider.maximumDownloads(), 1);
+    provider.setMaximumDecodes(1);
+    QCOMPARE(provider.maximumDecodes(), 1);
+
+    // Photos nobody reports on count as visible
+    QObject owner;
+    provider.setPriority(id("thumbnail", server.url("far")), &owner, 600);
+    provider.setPriority(id("thumbnail", server.url("deferred")), &owner, PhotoProvider::Deferred);
+    provider.setPriority(id("thumbnail", server.url("near")), &owner, 300);
+
+    QList<QQuickImageResponse *> responses;
+    QList<QSignalSpy *> spies;
+    for (const QByteArray &name : names) {
+        responses.append(provider.requestImageResponse(id("thumbnail", server.url(QString::fromLatin1(name))),
+                                                       QSize(50, 50)));
+        spies.append(new QSignalSpy(responses.last(), &QQuickImageResponse::finished));
+    }
+    QTRY_COMPARE(server.order.size(), 1);
+    server.release();
+
+    QTRY_COMPARE(spies.at(names.indexOf("far"))->count(), 1);
+    QCOMPARE(server.order, QList<QByteArray>({ "first", "visible", "near", "far" }));
+    QCOMPARE(spies.at(names.indexOf("deferred"))->count(), 0);
+
+    // Coming closer starts it
+    provider.setPriority(id("thumbnail", server.url("deferred")), &owner, 400);
+    QTRY_COMPARE(spies.at(names.indexOf("deferred"))->count(), 1);
+    QCOMPARE(server.order.size(), names.size());
+
+    qDeleteAll(spies);
+    qDeleteAll(responses);
+}
+
+void tst_photoprovider::cancelPending()
+{
+    QImage photo(200, 200, QImage::Format_RGB32);
+    photo.fill(Qt::magenta);
+    server.documents.insert("first", encode(photo, "png"));
+    server.documents.insert("second", encode(photo, "png"));
+    server.holdResponses = true;
+
+    PhotoProvider provider;
+    provider.setMaximumDownloads(1);
+    QScopedPointer<QQuickImageResponse> first(
+            provider.requestImageResponse(id("thumbnail", server.url("first")), QSize(50, 50)));
+    QScopedPointer<QQuickImageResponse> second(
+            provider.requestImageResponse(id("thumbnail", server.url("second")), QSize(50, 50)));
+    QSignalSpy firstFinished(first.data(), &QQuickImageResponse::finished);
+    QTRY_COMPARE(server.requestCounts.value("first"), 1);
+
+    // Cancelled while waiting for a download slot, so it is never requested
+    second->cancel();
+    server.release();
+    QTRY_COMPARE(firstFinished.count(), 1);
+    QTest::qWait(100);
+    QCOMPARE(server.requestCounts.value("second"), 0);
+}
+
+QTEST_MAIN(tst_photoprovider)
+
+#include "tst_photoprovider.moc"
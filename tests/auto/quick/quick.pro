@@ -5,3 +5,9 @@ TEMPLATE = subdirs
 qtConfig(private_tests) {
     SUBDIRS += $$PRIVATETESTS
 }
+
+SUBDIRS += mipmapimage \
+           stockplot
+
+qtHaveModule(network): \
+    SUBDIRS += photoprovider
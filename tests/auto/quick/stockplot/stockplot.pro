@@ -0,0 +1,12 @@
+CONFIG += testcase
+TARGET = tst_stockplot
+QT += quick testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/stocqt
+
+HEADERS += ../../../../examples/demos/stocqt/stockmodel.h \
+           ../../../../examples/demos/stocqt/stockplot.h
+SOURCES += tst_stockplot.cpp \
+           ../../../../examples/demos/stocqt/stockmodel.cpp \
+           ../../../../examples/demos/stocqt/stockplot.cpp
@@ -0,0 +1,264 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <qtest.h>
+#include <QFile>
+#include <QQuickWindow>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <cmath>
+
+#include "stockmodel.h"
+#include "stockplot.h"
+
+class tst_stockplot : public QObject
+{
+    Q_OBJECT
+public:
+    tst_stockplot() {}
+
+private slots:
+    void initTestCase();
+    void lineGeometry();
+    void barGeometry();
+    void decimate();
+    void range();
+    void render();
+
+private:
+    static QDateTime date(int day);
+
+    QTemporaryDir dir;
+    StockModel model;
+};
+
+QDateTime tst_stockplot::date(int day)
+{
+    return QDateTime(QDate(2020, 4, day), QTime(0, 0), Qt::UTC);
+}
+
+void tst_stockplot::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath(QStringLiteral("TEST.csv")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Date,Open,High,Low,Close,Volume\n");
+    // Ten days, newest first, with the extremes on the 3rd and 7th
+    for (int day = 10; day >= 1; --day) {
+        const double high = day == 7 ? 50 : 20 + day;
+        const double low = day == 3 ? 1 : 10 + day;
+        const int volume = day == 3 ? 9000 : 1000 * day;
+        file.write(QStringLiteral("2020-04-%1,%2,%3,%4,%5,%6\n").arg(day, 2, 10, QLatin1Char('0'))
+                   .arg(15 + day).arg(high).arg(low).arg(16 + day).arg(volume).toLatin1());
+    }
+    file.close();
+
+    QSignalSpy dataReady(&model, &StockModel::dataReady);
+    model.setDataFolder(QUrl::fromLocalFile(dir.path()));
+    model.setStockId(QStringLiteral("TEST"));
+    model.updateStock();
+    QTRY_COMPARE(dataReady.count(), 1);
+    QCOMPARE(model.count(), 10);
+}
+
+void tst_stockplot::lineGeometry()
+{
+    QSGGeometry geometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+
+    StockPlot::setLineGeometry(&geometry, { QPointF(0, 10), QPointF(10, 10), QPointF(20, 10) }, 2);
+    QCOMPARE(geometry.vertexCount(), 6);
+    const QSGGeometry::Point2D *vertices = geometry.vertexDataAsPoint2D();
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(vertices[2 * i].x, float(10 * i));
+        QCOMPARE(vertices[2 * i + 1].x, float(10 * i));
+        QCOMPARE(qAbs(vertices[2 * i].y - vertices[2 * i + 1].y), 2.0f);
+        QCOMPARE(vertices[2 * i].y + vertices[2 * i + 1].y, 20.0f);
+    }
+
+    // A right angle keeps the width of both segments
+    StockPlot::setLineGeometry(&geometry, { QPointF(0, 0), QPointF(10, 0), QPointF(10, 10) }, 2);
+    QCOMPARE(geometry.vertexCount(), 6);
+    vertices = geometry.vertexDataAsPoint2D();
+    const QPointF corner(vertices[2].x - vertices[3].x, vertices[2].y - vertices[3].y);
+    QVERIFY(qAbs(qAbs(corner.x()) - 2) < 1e-4);
+    QVERIFY(qAbs(qAbs(corner.y()) - 2) < 1e-4);
+
+    StockPlot::setLineGeometry(&geometry, { QPointF(0, 0) }, 2);
+    QCOMPARE(geometry.vertexCount(), 0);
+}
+
+void tst_stockplot::barGeometry()
+{
+    QSGGeometry geometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+    StockPlot::setBarGeometry(&geometry, { QRectF(0, 5, 4, 10), QRectF(6, 0, 4, 15) });
+    QCOMPARE(geometry.vertexCount(), 12);
+    const QSGGeometry::Point2D *vertices = geometry.vertexDataAsPoint2D();
+    float left = 100, top = 100, right = -100, bottom = -100;
+    for (int i = 6; i < 12; ++i) {
+        left = qMin(left, vertices[i].x);
+        top = qMin(top, vertices[i].y);
+        right = qMax(right, vertices[i].x);
+        bottom = qMax(bottom, vertices[i].y);
+    }
+    QCOMPARE(QRectF(left, top, right - left, bottom - top), QRectF(6, 0, 4, 15));
+}
+
+void tst_stockplot::decimate()
+{
+    // A thousand rows with a spike in every hundred
+    QList<double> values;
+    for (int row = 0; row < 1000; ++row)
+        values.append(row % 100 == 37 ? 1000 : row % 100 == 61 ? -1000 : std::sin(row / 10.0));
+
+    const QList<int> rows = StockPlot::decimate(values, 999, 0, 10);
+    QVERIFY(rows.size() <= 40);
+    QCOMPARE(rows.first(), 999);
+    QCOMPARE(rows.last(), 0);
+    for (int i = 1; i < rows.size(); ++i)
+        QVERIFY(rows.at(i) < rows.at(i - 1));
+    for (int bucket = 0; bucket < 10; ++bucket) {
+        QVERIFY(rows.contains(bucket * 100 + 37));
+        QVERIFY(rows.contains(bucket * 100 + 61));
+    }
+
+    // A part of the rows
+    const QList<int> part = StockPlot::decimate(values, 499, 300, 5);
+    QCOMPARE(part.first(), 499);
+    QCOMPARE(part.last(), 300);
+    QVERIFY(part.contains(437));
+    QVERIFY(part.contains(361));
+    QVERIFY(!part.contains(537));
+
+    // Few enough rows are all kept
+    QCOMPARE(StockPlot::decimate(values, 9, 2, 2), QList<int>({ 9, 8, 7, 6, 5, 4, 3, 2 }));
+    QVERIFY(StockPlot::decimate(values, 2, 3, 2).isEmpty());
+
+    QList<qint64> volumes(1000, 10);
+    volumes[100] = 50;
+    volumes[600] = 70;
+    const QList<int> bars = StockPlot::decimateMaximum(volumes, 999, 0, 4);
+    QCOMPARE(bars.size(), 4);
+    QCOMPARE(bars.at(1), 600);
+    QCOMPARE(bars.at(3), 100);
+    QCOMPARE(StockPlot::decimateMaximum(volumes, 3, 0, 4), QList<int>({ 3, 2, 1, 0 }));
+}
+
+void tst_stockplot::range()
+{
+    StockPlot plot;
+    QSignalSpy rangeChanged(&plot, &StockPlot::rangeChanged);
+    QCOMPARE(plot.count(), 0);
+
+    plot.setModel(&model);
+    plot.setStartDate(date(5));
+    plot.setEndDate(date(10));
+    // From the row after the 5th, the 4th, to the 10th
+    QCOMPARE(plot.count(), 6);
+    QCOMPARE(plot.highestPrice(), 50.0);
+    QCOMPARE(plot.lowestPrice(), 14.0);
+    QCOMPARE(plot.highestVolume(), qint64(10000));
+    QVERIFY(rangeChanged.count() > 0);
+
+    plot.setStartDate(date(1));
+    QCOMPARE(plot.count(), 9);
+    QCOMPARE(plot.lowestPrice(), 1.0);
+
+    plot.setEndDate(date(6));
+    QCOMPARE(plot.count(), 5);
+    QCOMPARE(plot.highestPrice(), 26.0);
+    QCOMPARE(plot.highestVolume(), qint64(9000));
+
+    // Showing and hiding a series leaves the range alone
+    rangeChanged.clear();
+    plot.setDrawOpenPrice(false);
+    plot.setVolumeColor(Qt::red);
+    plot.setLineWidth(3);
+    QCOMPARE(rangeChanged.count(), 0);
+
+    plot.setModel(nullptr);
+    QCOMPARE(plot.count(), 0);
+    QCOMPARE(rangeChanged.count(), 1);
+}
+
+void tst_stockplot::render()
+{
+    QQuickWindow window;
+    window.resize(400, 300);
+    StockPlot *plot = new StockPlot(window.contentItem());
+    plot->setSize(QSizeF(400, 300));
+    plot->setModel(&model);
+    plot->setStartDate(date(1));
+    plot->setEndDate(date(10));
+    plot->setPriceTop(10);
+    plot->setPriceBottom(200);
+    plot->setVolumeHeight(80);
+    plot->setHighColor(Qt::green);
+    plot->setVolumeColor(Qt::blue);
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    const quint32 prices = (1 << StockPlot::HighSeries) | (1 << StockPlot::LowSeries)
+            | (1 << StockPlot::OpenSeries) | (1 << StockPlot::CloseSeries);
+    const quint32 volume = 1 << StockPlot::VolumeSeries;
+    QTRY_COMPARE(plot->m_dirtyGeometry, 0u);
+    QTRY_COMPARE(plot->m_dirtyMaterial, 0u);
+
+    // Toggling a series only rebuilds its own geometry
+    plot->setDrawHighPrice(false);
+    QCOMPARE(plot->m_dirtyGeometry, quint32(1 << StockPlot::HighSeries));
+    QCOMPARE(plot->m_dirtyMaterial, 0u);
+    QTRY_COMPARE(plot->m_dirtyGeometry, 0u);
+
+    // Recoloring a series only updates its material
+    plot->setHighColor(Qt::red);
+    plot->setVolumeColor(Qt::yellow);
+    QCOMPARE(plot->m_dirtyGeometry, 0u);
+    QCOMPARE(plot->m_dirtyMaterial, quint32(1 << StockPlot::HighSeries) | volume);
+    QTRY_COMPARE(plot->m_dirtyMaterial, 0u);
+
+    // Layout changes rebuild the series they apply to
+    plot->setBarSpacing(8);
+    QCOMPARE(plot->m_dirtyGeometry, volume);
+    QTRY_COMPARE(plot->m_dirtyGeometry, 0u);
+    plot->setLineWidth(3);
+    QCOMPARE(plot->m_dirtyGeometry, prices);
+    QCOMPARE(plot->m_dirtyMaterial, 0u);
+    QTRY_COMPARE(plot->m_dirtyGeometry, 0u);
+
+    // A new range rebuilds them all
+    plot->setStartDate(date(3));
+    QCOMPARE(plot->m_dirtyGeometry, prices | volume);
+    QCOMPARE(plot->m_dirtyMaterial, 0u);
+    QTRY_COMPARE(plot->m_dirtyGeometry, 0u);
+}
+
+QTEST_MAIN(tst_stockplot)
+
+#include "tst_stockplot.moc"
@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef HTTPSTANDIN_H
+#define HTTPSTANDIN_H
+
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+/*
+A minimal HTTP server for tests. It serves documents by path, and answers
+anything else with 404 Not Found. If eTag is set, it is sent with each
+document, and conditional requests for it are answered with 304 Not
+Modified. Responses can be held back until release(), and bodies can be
+cut short after partialBytes until finish().
+*/
+class HttpStandIn : public QTcpServer
+{
+public:
+    HttpStandIn()
+    {
+        connect(this, &QTcpServer::newConnection, this, &HttpStandIn::acceptConnections);
+    }
+
+    QUrl url(const QString &path) const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1/%2").arg(serverPort()).arg(path));
+    }
+
+    // Forgets the requests received, and serves responses right away again
+    void reset()
+    {
+        requests.clear();
+        requestCounts.clear();
+        order.clear();
+        fullResponses = 0;
+        notModifiedResponses = 0;
+        holdResponses = false;
+        partialBytes = 0;
+    }
+
+    void release()
+    {
+        holdResponses = false;
+        for (QTcpSocket *socket : qAsConst(heldSockets)) {
+            if (socket && socket->state() == QAbstractSocket::ConnectedState)
+                respond(socket);
+        }
+        heldSockets.clear();
+    }
+
+    // Sends the rest of the bodies cut short after partialBytes
+    void finish()
+    {
+        partialBytes = 0;
+        for (QTcpSocket *socket : qAsConst(partialSockets)) {
+            if (socket && socket->state() == QAbstractSocket::ConnectedState) {
+                socket->write(socket->property("rest").toByteArray());
+                socket->disconnectFromHost();
+            }
+        }
+        partialSockets.clear();
+    }
+
+    QHash<QByteArray, QByteArray> documents;
+    QByteArray contentType;
+    QByteArray eTag;
+    bool holdResponses = false;
+    int partialBytes = 0;
+
+    // The requests received, whole, and the paths they asked for
+    QList<QByteArray> requests;
+    QHash<QByteArray, int> requestCounts;
+    QList<QByteArray> order;
+    int fullResponses = 0;
+    int notModifiedResponses = 0;
+
+private:
+    void acceptConnections()
+    {
+        while (QTcpSocket *socket = nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                const QByteArray buffer = socket->property("buffer").toByteArray() + socket->readAll();
+                socket->setProperty("buffer", buffer);
+                if (!buffer.contains("\r\n\r\n"))
+                    return;
+                requests.append(buffer);
+                ++requestCounts[path(buffer)];
+                order.append(path(buffer));
+                if (holdResponses)
+                    heldSockets.append(socket);
+                else
+                    respond(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+    static QByteArray path(const QByteArray &request)
+    {
+        // "GET /name HTTP/1.1"
+        return request.left(request.indexOf("\r\n")).split(' ').value(1).mid(1);
+    }
+
+    void respond(QTcpSocket *socket)
+    {
+        const QByteArray request = socket->property("buffer").toByteArray();
+        const QByteArray name = path(request);
+        if (!documents.contains(name)) {
+            socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+
+        QByteArray headers;
+        if (!contentType.isEmpty())
+            headers += "Content-Type: " + contentType + "\r\n";
+        if (!eTag.isEmpty())
+            headers += "ETag: " + eTag + "\r\n";
+        if (!eTag.isEmpty() && request.contains("If-None-Match: " + eTag)) {
+            ++notModifiedResponses;
+            socket->write("HTTP/1.1 304 Not Modified\r\n" + headers
+                          + "Content-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            return;
+        }
+
+        ++fullResponses;
+        const QByteArray body = documents.value(name);
+        socket->write("HTTP/1.1 200 OK\r\n" + headers + "Content-Length: " + QByteArray::number(body.size())
+                      + "\r\nConnection: close\r\n\r\n");
+        if (partialBytes > 0 && partialBytes < body.size()) {
+            socket->write(body.left(partialBytes));
+            socket->setProperty("rest", body.mid(partialBytes));
+            partialSockets.append(socket);
+            return;
+        }
+        socket->write(body);
+        socket->disconnectFromHost();
+    }
+
+    QList<QPointer<QTcpSocket>> heldSockets;
+    QList<QPointer<QTcpSocket>> partialSockets;
+};
+
+#endif // HTTPSTANDIN_H
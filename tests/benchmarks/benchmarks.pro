@@ -0,0 +1,4 @@
+TEMPLATE=subdirs
+qtHaveModule(qml) {
+    SUBDIRS += qml
+}
@@ -0,0 +1,4 @@
+TEMPLATE = subdirs
+
+qtHaveModule(network): \
+    SUBDIRS += xmllistmodel
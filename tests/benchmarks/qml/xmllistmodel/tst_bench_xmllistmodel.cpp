@@ -0,0 +1,532 @@
+/****************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+
+// Run with "-o results.csv,csv" or "-o results.xml,xml" to get the results in
+// a machine-readable form for regression tracking.
+
+#include <qtest.h>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QTemporaryDir>
+
+#include <limits>
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "xmllistmodel.h"
+
+enum class FeedFormat { Rss, Atom };
+Q_DECLARE_METATYPE(FeedFormat)
+
+static const qint64 documentSizes[] = {
+    1024,
+    64 * 1024,
+    1024 * 1024,
+    10 * 1024 * 1024,
+    100 * 1024 * 1024
+};
+
+class tst_bench_xmllistmodel : public QObject
+{
+    Q_OBJECT
+public:
+    tst_bench_xmllistmodel() {}
+
+private slots:
+    void initTestCase();
+
+    void parse_data();
+    void parse();
+    void parseElementCost_data();
+    void parseElementCost();
+    void reloadLatency_data();
+    void reloadLatency();
+    void dataCost_data();
+    void dataCost();
+    void peakMemory_data();
+    void peakMemory();
+    void storageMemory_data();
+    void storageMemory();
+
+private:
+    void addDocumentRows(qint64 maxSize = std::numeric_limits<qint64>::max());
+    QString document(FeedFormat format, qint64 size);
+    XmlListModel *createModel(QQmlEngine *engine, FeedFormat format, const QString &fileName);
+    static QSharedPointer<const XmlListModelQueryPlan> queryPlan(FeedFormat format);
+    static XmlListModelData runQuery(QQmlEngine *engine, const QSharedPointer<const XmlListModelQueryPlan> &plan,
+                                     const QByteArray &data,
+                                     const XmlListModelQueryOptions &options = XmlListModelQueryOptions());
+
+    QTemporaryDir m_documents;
+    QHash<QString, QString> m_documentFiles;
+};
+
+static QString sizeName(qint64 size)
+{
+    if (size >= 1024 * 1024)
+        return QString::number(size / (1024 * 1024)) + QLatin1String("MB");
+    return QString::number(size / 1024) + QLatin1String("KB");
+}
+
+// Synthetic feeds: a few authors and categories that repeat, like in real
+// feeds, and texts of varying length.
+static QByteArray rssItem(int i)
+{
+    return "<item><title>Item " + QByteArray::number(i) + " of the synthetic feed</title>"
+           "<link>http://www.example.com/news/" + QByteArray::number(i) + ".html</link>"
+           "<description>" + QByteArray("Lorem ipsum dolor sit amet. ").repeated(4 * (1 + i % 8)) + "</description>"
+           "<pubDate>Mon, " + QByteArray::number(1 + i % 28) + " Dec 2020 12:00:00 GMT</pubDate>"
+           "<category>Category " + QByteArray::number(i % 12) + "</category>"
+           "<author>author" + QByteArray::number(i % 20) + "@example.com</author></item>\n";
+}
+
+static QByteArray atomEntry(int i)
+{
+    return "<entry><id>urn:uuid:" + QByteArray::number(i) + "</id>"
+           "<title>Entry " + QByteArray::number(i) + " of the synthetic feed</title>"
+           "<link rel=\"alternate\" href=\"http://www.example.com/news/" + QByteArray::number(i) + ".html\"/>"
+           "<updated>2020-12-" + QByteArray::number(10 + i % 18) + "T12:00:00Z</updated>"
+           "<summary>" + QByteArray("Lorem ipsum dolor sit amet. ").repeated(4 * (1 + i % 8)) + "</summary>"
+           "<category term=\"category" + QByteArray::number(i % 12) + "\"/></entry>\n";
+}
+
+QString tst_bench_xmllistmodel::document(FeedFormat format, qint64 size)
+{
+    const QString name = (format == FeedFormat::Rss ? QLatin1String("rss-") : QLatin1String("atom-")) + sizeName(size);
+    const QString fileName = m_documentFiles.value(name);
+    if (!fileName.isEmpty())
+        return fileName;
+
+    QFile file(m_documents.filePath(name + QLatin1String(".xml")));
+    if (!file.open(QIODevice::WriteOnly))
+        return QString();
+
+    QByteArray header;
+    QByteArray footer;
+    if (format == FeedFormat::Rss) {
+        header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<rss version=\"2.0\"><channel>"
+                 "<title>Synthetic feed</title>\n";
+        footer = "</channel></rss>\n";
+    } else {
+        header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<feed xmlns=\"http://www.w3.org/2005/Atom\">"
+                 "<title>Synthetic feed</title>\n";
+        footer = "</feed>\n";
+    }
+
+    qint64 written = file.write(header);
+    for (int i = 0; ; ++i) {
+        const QByteArray item = format == FeedFormat::Rss ? rssItem(i) : atomEntry(i);
+        if (i > 0 && written + item.size() + footer.size() > size)
+            break;
+        written += file.write(item);
+    }
+    file.write(footer);
+    file.close();
+
+    m_documentFiles.insert(name, file.fileName());
+    return file.fileName();
+}
+
+QSharedPointer<const XmlListModelQueryPlan> tst_bench_xmllistmodel::queryPlan(FeedFormat format)
+{
+    const char *const rssRoles[][2] = {
+        { "title", "" }, { "link", "" }, { "description", "" },
+        { "pubDate", "" }, { "category", "" }, { "author", "" }
+    };
+    const char *const atomRoles[][2] = {
+        { "id", "" }, { "title", "" }, { "link", "href" },
+        { "updated", "" }, { "summary", "" }, { "category", "term" }
+    };
+
+    QList<XmlListModelRole *> roles;
+    for (int i = 0; i < 6; ++i) {
+        XmlListModelRole *role = new XmlListModelRole;
+        role->setElementName(QLatin1String(format == FeedFormat::Rss ? rssRoles[i][0] : atomRoles[i][0]));
+        role->setAttributeName(QLatin1String(format == FeedFormat::Rss ? rssRoles[i][1] : atomRoles[i][1]));
+        roles.append(role);
+    }
+    QSharedPointer<const XmlListModelQueryPlan> plan = XmlListModelQueryEngine::compileQuery(
+            format == FeedFormat::Rss ? QStringLiteral("/rss/channel/item") : QStringLiteral("/feed/entry"),
+            roles);
+    qDeleteAll(roles);
+    return plan;
+}
+
+XmlListModelData tst_bench_xmllistmodel::runQuery(QQmlEngine *engine,
+                                                  const QSharedPointer<const XmlListModelQueryPlan> &plan,
+                                                  const QByteArray &data,
+                                                  const XmlListModelQueryOptions &options)
+{
+    XmlListModelQueryEngine *queryEngine = XmlListModelQueryEngine::instance(engine);
+    XmlListModelData rows(plan->roles.count());
+    QEventLoop loop;
+    int queryId = -1;
+
+    // Rows are published in batches while the document is parsed
+    QObject::connect(queryEngine, &XmlListModelQueryEngine::rowsAvailable, &loop,
+                     [&](const XmlListModelQueryResult &result) {
+        if (result.queryId == queryId)
+            rows.append(result.data);
+    });
+    QObject::connect(queryEngine, &XmlListModelQueryEngine::queryCompleted, &loop,
+                     [&](const XmlListModelQueryResult &result) {
+        if (result.queryId != queryId)
+            return;
+        rows.append(result.data);
+        loop.quit();
+    });
+    queryId = queryEngine->doQuery(plan, data, options);
+    loop.exec();
+    return rows;
+}
+
+XmlListModel *tst_bench_xmllistmodel::createModel(QQmlEngine *engine, FeedFormat format, const QString &fileName)
+{
+    QQmlComponent component(engine);
+    const QString roles = format == FeedFormat::Rss
+            ? QStringLiteral("XmlListModelRole { elementName: \"title\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"link\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"description\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"pubDate\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"category\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"author\"; attributeName: \"\" }")
+            : QStringLiteral("XmlListModelRole { elementName: \"id\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"title\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"link\"; attributeName: \"href\" },"
+                             "XmlListModelRole { elementName: \"updated\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"summary\"; attributeName: \"\" },"
+                             "XmlListModelRole { elementName: \"category\"; attributeName: \"term\" }");
+    component.setData(QStringLiteral(
+            "import XmlListModel\n"
+            "XmlListModel {\n"
+            "    source: \"%1\"\n"
+            "    query: \"%2\"\n"
+            "    roles: [ %3 ]\n"
+            "}\n").arg(QUrl::fromLocalFile(fileName).toString(),
+                       format == FeedFormat::Rss ? QLatin1String("/rss/channel/item") : QLatin1String("/feed/entry"),
+                       roles).toUtf8(), QUrl());
+    if (component.isError())
+        qWarning() << component.errors();
+    return qobject_cast<XmlListModel *>(component.create());
+}
+
+static bool waitForReady(XmlListModel *model)
+{
+    while (model->status() == XmlListModel::Loading)
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    return model->status() == XmlListModel::Ready;
+}
+
+void tst_bench_xmllistmodel::initTestCase()
+{
+    qmlRegisterType<XmlListModel>("XmlListModel", 1, 0, "XmlListModel");
+    qmlRegisterType<XmlListModelRole>("XmlListModel", 1, 0, "XmlListModelRole");
+    QVERIFY(m_documents.isValid());
+}
+
+void tst_bench_xmllistmodel::addDocumentRows(qint64 maxSize)
+{
+    QTest::addColumn<FeedFormat>("format");
+    QTest::addColumn<qint64>("size");
+
+    for (FeedFormat format : { FeedFormat::Rss, FeedFormat::Atom }) {
+        for (qint64 size : documentSizes) {
+            if (size > maxSize)
+                break;
+            const QString name = (format == FeedFormat::Rss ? QLatin1String("rss-") : QLatin1String("atom-"))
+                    + sizeName(size);
+            QTest::newRow(qPrintable(name)) << format << size;
+        }
+    }
+}
+
+void tst_bench_xmllistmodel::parse_data()
+{
+    QTest::addColumn<FeedFormat>("format");
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<bool>("lazyDecoding");
+
+    for (FeedFormat format : { FeedFormat::Rss, FeedFormat::Atom }) {
+        for (qint64 size : documentSizes) {
+            const QString name = (format == FeedFormat::Rss ? QLatin1String("rss-") : QLatin1String("atom-"))
+                    + sizeName(size);
+            QTest::newRow(qPrintable(name)) << format << size << false;
+            QTest::newRow(qPrintable(name + QLatin1String("-lazy"))) << format << size << true;
+        }
+    }
+}
+
+void tst_bench_xmllistmodel::parse()
+{
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+    QFETCH(bool, lazyDecoding);
+
+    QFile file(document(format, size));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    const QSharedPointer<const XmlListModelQueryPlan> plan = queryPlan(format);
+    XmlListModelQueryOptions options;
+    options.lazyDecoding = lazyDecoding;
+    QQmlEngine engine;
+
+    QBENCHMARK {
+        runQuery(&engine, plan, data, options);
+    }
+}
+
+void tst_bench_xmllistmodel::parseElementCost_data()
+{
+    addDocumentRows();
+}
+
+void tst_bench_xmllistmodel::parseElementCost()
+{
+    // Reported as nanoseconds per element; 1e9 divided by the result is the
+    // number of elements parsed per second.
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+
+    QFile file(document(format, size));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    const QSharedPointer<const XmlListModelQueryPlan> plan = queryPlan(format);
+    QQmlEngine engine;
+
+    // Every row is one item element with one child element per role
+    runQuery(&engine, plan, data);
+    QElapsedTimer timer;
+    timer.start();
+    const XmlListModelData rows = runQuery(&engine, plan, data);
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    QVERIFY(!rows.isEmpty());
+    const qint64 elements = qint64(rows.count()) * (plan->roles.count() + 1);
+    QTest::setBenchmarkResult(qreal(elapsed) / elements, QTest::WalltimeNanoseconds);
+}
+
+void tst_bench_xmllistmodel::reloadLatency_data()
+{
+    addDocumentRows();
+}
+
+void tst_bench_xmllistmodel::reloadLatency()
+{
+    // From reload() until the model reports Ready with all rows applied
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, format, document(format, size)));
+    QVERIFY(model);
+    QVERIFY(waitForReady(model.data()));
+
+    QBENCHMARK {
+        model->reload();
+        waitForReady(model.data());
+    }
+    QCOMPARE(model->status(), XmlListModel::Ready);
+    QVERIFY(model->count() > 0);
+}
+
+void tst_bench_xmllistmodel::dataCost_data()
+{
+    addDocumentRows(10 * 1024 * 1024);
+}
+
+void tst_bench_xmllistmodel::dataCost()
+{
+    // Reported as nanoseconds per data() call, as made by delegates when the
+    // view scrolls through the whole model.
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+
+    QQmlEngine engine;
+    QScopedPointer<XmlListModel> model(createModel(&engine, format, document(format, size)));
+    QVERIFY(model);
+    QVERIFY(waitForReady(model.data()));
+
+    const QList<int> roles = model->roleNames().keys();
+    const int rows = model->rowCount(QModelIndex());
+    QVERIFY(rows > 0);
+
+    qint64 calls = 0;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        for (int row = 0; row < rows; ++row) {
+            const QModelIndex index = model->index(row, 0, QModelIndex());
+            for (int role : roles)
+                model->data(index, role);
+        }
+        calls += qint64(rows) * roles.count();
+    } while (timer.elapsed() < 500);
+    QTest::setBenchmarkResult(qreal(timer.nsecsElapsed()) / calls, QTest::WalltimeNanoseconds);
+}
+
+#if defined(Q_OS_LINUX)
+static qint64 procStatus(const QByteArray &field)
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return -1;
+    for (QByteArray line = file.readLine(); !line.isEmpty(); line = file.readLine()) {
+        if (line.startsWith(field + ':'))
+            return line.mid(field.size() + 1).trimmed().split(' ').first().toLongLong() * 1024;
+    }
+    return -1;
+}
+
+static bool resetPeakMemory()
+{
+    QFile file(QStringLiteral("/proc/self/clear_refs"));
+    return file.open(QIODevice::WriteOnly) && file.write("5") == 1;
+}
+#endif
+
+void tst_bench_xmllistmodel::peakMemory_data()
+{
+    addDocumentRows();
+}
+
+void tst_bench_xmllistmodel::peakMemory()
+{
+    // Growth of the resident set, at its highest, while a document that is
+    // already in memory is parsed and its rows are kept.
+#if defined(Q_OS_LINUX)
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+
+    QFile file(document(format, size));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    const QSharedPointer<const XmlListModelQueryPlan> plan = queryPlan(format);
+    QQmlEngine engine;
+    XmlListModelQueryEngine::instance(&engine);
+
+    if (!resetPeakMemory())
+        QSKIP("The peak resident set size cannot be reset");
+    const qint64 baseline = procStatus("VmRSS");
+    const XmlListModelData rows = runQuery(&engine, plan, data);
+    const qint64 peak = procStatus("VmHWM");
+    QVERIFY(baseline > 0 && peak > 0);
+    QVERIFY(!rows.isEmpty());
+
+    QTest::setBenchmarkResult(qMax<qint64>(0, peak - baseline), QTest::BytesAllocated);
+#else
+    QSKIP("Peak memory is only measured on Linux");
+#endif
+}
+
+// The same rows stored as they were before the columnar layout: a QHash<int,
+// QString> per row, each holding its own copy of every value.
+static QList<QHash<int, QString> > rowHashes(const XmlListModelData &rows)
+{
+    QList<QHash<int, QString> > hashes;
+    hashes.reserve(rows.count());
+    for (int row = 0; row < rows.count(); ++row) {
+        QHash<int, QString> hash;
+        for (int role = 0; role < rows.roleCount(); ++role) {
+            const QString value = rows.text(row, role);
+            if (!value.isNull())
+                hash.insert(Qt::UserRole + role, QString(value.constData(), value.size()));
+        }
+        hashes.append(hash);
+    }
+    return hashes;
+}
+
+void tst_bench_xmllistmodel::storageMemory_data()
+{
+    QTest::addColumn<FeedFormat>("format");
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<bool>("columnar");
+    QTest::addColumn<bool>("lazyDecoding");
+
+    for (qint64 size : documentSizes) {
+        const QString name = QLatin1String("rss-") + sizeName(size);
+        QTest::newRow(qPrintable(name + QLatin1String("-columnar"))) << FeedFormat::Rss << size << true << false;
+        QTest::newRow(qPrintable(name + QLatin1String("-columnar-lazy"))) << FeedFormat::Rss << size << true << true;
+        QTest::newRow(qPrintable(name + QLatin1String("-rowhashes"))) << FeedFormat::Rss << size << false << false;
+    }
+}
+
+void tst_bench_xmllistmodel::storageMemory()
+{
+    // Bytes held by the model for the parsed rows, in the current columnar
+    // layout, with long values left in the retained source, and in the
+    // per-row hashes it replaced. The hashes are built for real, and their
+    // size is the growth of the resident set, as in peakMemory().
+    QFETCH(FeedFormat, format);
+    QFETCH(qint64, size);
+    QFETCH(bool, columnar);
+    QFETCH(bool, lazyDecoding);
+
+    QFile file(document(format, size));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    XmlListModelQueryOptions options;
+    options.lazyDecoding = lazyDecoding;
+    QQmlEngine engine;
+    const XmlListModelData rows = runQuery(&engine, queryPlan(format), file.readAll(), options);
+    QVERIFY(!rows.isEmpty());
+
+    if (columnar) {
+        QTest::setBenchmarkResult(rows.memoryUsage(), QTest::BytesAllocated);
+        return;
+    }
+
+#if defined(Q_OS_LINUX)
+    // Memory freed by the parse would otherwise be reused by the hashes
+    // without showing in the resident set.
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+    if (!resetPeakMemory())
+        QSKIP("The peak resident set size cannot be reset");
+    const qint64 baseline = procStatus("VmRSS");
+    const QList<QHash<int, QString> > hashes = rowHashes(rows);
+    const qint64 peak = procStatus("VmHWM");
+    QVERIFY(baseline > 0 && peak > 0);
+    QCOMPARE(hashes.count(), rows.count());
+
+    QTest::setBenchmarkResult(qMax<qint64>(0, peak - baseline), QTest::BytesAllocated);
+#else
+    QSKIP("Memory of the row hashes is only measured on Linux");
+#endif
+}
+
+QTEST_MAIN(tst_bench_xmllistmodel)
+
+#include "tst_bench_xmllistmodel.moc"
@@ -0,0 +1,10 @@
+CONFIG += benchmark
+TARGET = tst_bench_xmllistmodel
+QT += qml network testlib
+macos:CONFIG -= app_bundle
+
+INCLUDEPATH += ../../../../examples/demos/shared
+
+HEADERS += ../../../../examples/demos/shared/xmllistmodel.h
+SOURCES += tst_bench_xmllistmodel.cpp \
+           ../../../../examples/demos/shared/xmllistmodel.cpp